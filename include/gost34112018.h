@@ -20,11 +20,17 @@ typedef enum {
     GOST34112018_Hash512 = 64,
 } GOST34112018_HashSize_t;
 
+typedef enum {
+    GOST34112018_WarmupTouch = 0,      // only fault in and cache the tables
+    GOST34112018_WarmupLock  = 1 << 0, // also lock them in memory with mlock
+} GOST34112018_WarmupFlags_t;
+
 /**
     @brief      Context of the algorithm, as described in ch. 8.1 of the Standard.
-                It has to be 32-byte aligned.
+                It is aligned to the cache line (64 bytes), so contexts of different
+                threads stored next to each other in an array never share a line.
  */
-struct GOST34112018_AlignAttribute(32) GOST34112018_Context
+struct GOST34112018_AlignAttribute(64) GOST34112018_Context
 {
     unsigned char           h    [64];
     unsigned char           N    [64];
@@ -33,6 +39,138 @@ struct GOST34112018_AlignAttribute(32) GOST34112018_Context
     unsigned char           prev_block_size;
 };
 
+/**
+    @brief      Context computing both 256- and 512-bit digests of the same message in a
+                single pass. Like GOST34112018_Context, it is cache-line aligned.
+ */
+struct GOST34112018_AlignAttribute(64) GOST34112018_DualContext
+{
+    unsigned char           h256 [64];
+    unsigned char           h512 [64];
+    unsigned char           N    [64];
+    unsigned char           sigma[64];
+    unsigned char           prev_block_size;
+};
+
+typedef enum {
+    GOST34112018_EngineNoFlags = 0,
+    GOST34112018_EngineUseEventFd = 1 << 0, // signal completed jobs on an eventfd
+} GOST34112018_EngineFlags_t;
+
+struct GOST34112018_Job;
+
+/**
+    @brief      Asynchronous hashing engine, see GOST34112018_EngineCreate.
+ */
+struct GOST34112018_Engine;
+
+typedef void (*GOST34112018_JobCallback_t)(struct GOST34112018_Job *job);
+
+/**
+    @brief      Job of the asynchronous engine. It is allocated by the caller and must
+                stay valid, together with the message, until it is completed.
+ */
+struct GOST34112018_Job
+{
+    const unsigned char        *message;      // message bytes, if fd is negative
+    unsigned long long          message_size;
+    int                         fd;           // if not negative, the descriptor is hashed
+                                              // from its current offset to its end
+    GOST34112018_HashSize_t     hash_size;
+    GOST34112018_JobCallback_t  callback;     // called on a worker thread on completion;
+                                              // if NULL the job is returned by
+                                              // GOST34112018_EnginePoll
+    void                       *user_data;
+    int                         status;       // on completion: 0 or errno
+    unsigned char               hash[64];     // on completion: the digest
+    struct GOST34112018_Job    *next;         // internal
+};
+
+/**
+    @brief      Store of the hashing contexts of many streams, see
+                GOST34112018_StoreCreate.
+ */
+struct GOST34112018_Store;
+
+/**
+    @brief      Next 64-byte block of a stream of a store, see GOST34112018_StoreUpdate.
+ */
+struct GOST34112018_StoreBlock
+{
+    unsigned int         stream;    // stream returned by GOST34112018_StoreOpen
+    const unsigned char *block;     // 64 bytes
+};
+
+/**
+    @brief      Parameters of content-defined chunking, see GOST34112018_ChunkerInit.
+ */
+struct GOST34112018_Chunker
+{
+    unsigned long long min_size;
+    unsigned long long avg_size;
+    unsigned long long max_size;
+    unsigned long long mask_small;  // internal
+    unsigned long long mask_large;  // internal
+};
+
+/**
+    @brief      Chunk of a message, see GOST34112018_ChunkAndHash.
+ */
+struct GOST34112018_Chunk
+{
+    unsigned long long offset;
+    unsigned long long size;
+    unsigned char      hash[64];    // hash_size bytes
+};
+
+/**
+    @brief      Checksums of one block of a basis, see GOST34112018_DeltaSignature.
+ */
+struct GOST34112018_BlockSignature
+{
+    unsigned int  weak;         // rolling checksum of the block
+    unsigned char strong[32];   // first strong_size bytes of the 256-bit digest
+};
+
+/**
+    @brief      Signature of a basis, see GOST34112018_DeltaCompute.
+ */
+struct GOST34112018_Signature
+{
+    unsigned long long                        basis_size;
+    unsigned long long                        block_size;
+    unsigned int                              strong_size;
+    const struct GOST34112018_BlockSignature *blocks;   // one per block, the last may be short
+};
+
+/**
+    @brief      Instruction of a delta: a range of the basis, or literal bytes.
+ */
+struct GOST34112018_DeltaOp
+{
+    const unsigned char *literal;   // the bytes, or NULL for a range of the basis
+    unsigned long long   offset;    // of the range in the basis
+    unsigned long long   size;
+};
+
+/**
+    @brief      Receives the instructions of a delta in order, see GOST34112018_DeltaCompute.
+    @return     0 to continue, errno to stop.
+ */
+typedef int (*GOST34112018_DeltaCallback_t)(const struct GOST34112018_DeltaOp *op,
+                                            void                              *user_data);
+
+/**
+    @brief      Profile of one internal function, see GOST34112018_ProfileSnapshot.
+ */
+struct GOST34112018_ProfileEntry
+{
+    const char         *func_name;
+    unsigned long long  calls;
+    unsigned long long  ticks;       // TSC ticks on x86, nanoseconds elsewhere
+    unsigned long long  nanoseconds;
+};
+
 /**
     @brief      Computes a cryptographic digest of the given bytes array, using the hashing
                 algorithm defined in Russian National Standard GOST 34.11-2018
@@ -49,6 +187,70 @@ void GOST34112018_HashBytes(const unsigned char      *message,
                        const GOST34112018_HashSize_t  hash_size,
                        unsigned char                 *hash_out);
 
+/**
+    @brief      Computes a digest of a file descriptor, from its current offset to its end.
+                Reads with read(2), retrying on EINTR; the descriptor is not closed.
+    @param      fd - file descriptor, readable.
+    @param      hash_size - size of the message digest.
+    @param      hash_out - output pointer, message digest.
+    @return     0 on success, EINVAL if hash_size is invalid, errno of a failed read
+                otherwise.
+ */
+int GOST34112018_HashFd(const int                     fd,
+                        const GOST34112018_HashSize_t hash_size,
+                        unsigned char                *hash_out);
+
+/**
+    @brief      Computes a digest of exactly 32 bytes. Produces the same digest as
+                GOST34112018_HashBytes, but N, sigma and the padding are known in
+                advance, so the generic stage 2/stage 3 bookkeeping is skipped.
+    @param      message - message bytes, 32 bytes long.
+    @param      hash_size - size of the message digest.
+    @param      hash_out - output pointer, message digest.
+ */
+void GOST34112018_HashBytes32(const unsigned char          *message,
+                              const GOST34112018_HashSize_t hash_size,
+                              unsigned char                *hash_out);
+
+/**
+    @brief      Computes a digest of exactly 64 bytes. See GOST34112018_HashBytes32.
+    @param      message - message bytes, 64 bytes long.
+    @param      hash_size - size of the message digest.
+    @param      hash_out - output pointer, message digest.
+ */
+void GOST34112018_HashBytes64(const unsigned char          *message,
+                              const GOST34112018_HashSize_t hash_size,
+                              unsigned char                *hash_out);
+
+/**
+    @brief      Computes a digest of exactly 128 bytes. See GOST34112018_HashBytes32.
+    @param      message - message bytes, 128 bytes long.
+    @param      hash_size - size of the message digest.
+    @param      hash_out - output pointer, message digest.
+ */
+void GOST34112018_HashBytes128(const unsigned char          *message,
+                               const GOST34112018_HashSize_t hash_size,
+                               unsigned char                *hash_out);
+
+/**
+    @brief      2-to-1 compression: computes a digest of the concatenation of two child
+                digests (left first), e.g. a parent node of a Merkle tree. The result is
+                the same as GOST34112018_HashBytes of the concatenated children, but the
+                children are not copied into an intermediate buffer.
+    @param      left - first child digest.
+    @param      right - second child digest.
+    @param      children_size - size of each of the children (32 or 64 bytes).
+    @param      hash_size - size of the parent digest.
+    @param      hash_out - output pointer, parent digest.
+    @return     0 on success, EINVAL if children_size is neither 32 nor 64 (hash_out is
+                not written).
+ */
+int GOST34112018_HashPair(const unsigned char          *left,
+                           const unsigned char          *right,
+                           const GOST34112018_HashSize_t children_size,
+                           const GOST34112018_HashSize_t hash_size,
+                           unsigned char                *hash_out);
+
 /**
     @brief      Initialize algorithm context with initial values defined in The Standard.
                 Context should be allocated by user and initialized before use in the
@@ -86,6 +288,311 @@ void GOST34112018_HashBlockEnd(struct GOST34112018_Context *ctx);
 void GOST34112018_GetHashFromContext(const struct GOST34112018_Context *ctx,
                                      unsigned char                     *out);
 
+/**
+    @brief      Computes both the 256-bit and the 512-bit digests of the message in a
+                single pass: every block is loaded once, and the two compression chains
+                are interleaved.
+    @param      message - message bytes in the big-endian (MSB-first) order.
+    @param      message_size - size of the message in bytes.
+    @param      hash256_out - output pointer, 32-byte digest.
+    @param      hash512_out - output pointer, 64-byte digest.
+ */
+void GOST34112018_HashBytesDual(const unsigned char      *message,
+                                const unsigned long long  message_size,
+                                unsigned char            *hash256_out,
+                                unsigned char            *hash512_out);
+
+/**
+    @brief      Initializes the dual context (see GOST34112018_HashBytesDual).
+    @param      ctx - context to be initialized.
+ */
+void GOST34112018_InitDualContext(struct GOST34112018_DualContext *ctx);
+
+/**
+    @brief      Same as GOST34112018_HashBlock, for the dual context.
+    @param      block - block of data to be hashed in big-endian order.
+    @param      block_size - size of the block.
+    @param      ctx - current dual context.
+ */
+void GOST34112018_HashBlockDual(const unsigned char             *block,
+                                const unsigned long long         block_size,
+                                struct GOST34112018_DualContext *ctx);
+
+/**
+    @brief      Same as GOST34112018_HashBlockEnd, for the dual context.
+    @param      ctx - current dual context.
+ */
+void GOST34112018_HashBlockEndDual(struct GOST34112018_DualContext *ctx);
+
+/**
+    @brief      Extracts both digests from the dual context.
+    @param      ctx - context with the digests in it.
+    @param      hash256_out - output pointer, 32-byte digest.
+    @param      hash512_out - output pointer, 64-byte digest.
+ */
+void GOST34112018_GetHashesFromDualContext(const struct GOST34112018_DualContext *ctx,
+                                           unsigned char                         *hash256_out,
+                                           unsigned char                         *hash512_out);
+
+/**
+    @brief      Creates a store of the contexts of many concurrent streams, e.g. one per
+                connection of a proxy. The contexts are kept in the structure-of-arrays
+                layout and take about half of the memory of GOST34112018_Context. The
+                store is not thread-safe.
+    @param      capacity - maximum number of open streams.
+    @return     store, or NULL with errno set.
+ */
+struct GOST34112018_Store *GOST34112018_StoreCreate(const unsigned int capacity);
+
+/**
+    @brief      Frees the store with all of its streams.
+    @param      store - store.
+ */
+void GOST34112018_StoreDestroy(struct GOST34112018_Store *store);
+
+/**
+    @brief      Opens a new stream, like GOST34112018_InitContext does for a context.
+    @param      store - store.
+    @param      hash_size - size of the digest of the stream.
+    @return     stream, or -1 with errno set (ENOSPC if the store is full).
+ */
+int GOST34112018_StoreOpen(struct GOST34112018_Store     *store,
+                           const GOST34112018_HashSize_t  hash_size);
+
+/**
+    @brief      Closes the stream without computing its digest. The stream may be
+                returned by GOST34112018_StoreOpen again.
+    @param      store - store.
+    @param      stream - stream; a stream which is not open is ignored.
+ */
+void GOST34112018_StoreClose(struct GOST34112018_Store *store,
+                             const unsigned int         stream);
+
+/**
+    @brief      Hashes full 64-byte blocks of any open streams of the store, like
+                GOST34112018_HashBlock does for a context. Blocks of the same stream are
+                hashed in the order of the array. Blocks of different streams are
+                compressed in pairs, with the two computations interleaved, so the more
+                streams a batch has, the better.
+    @param      store - store.
+    @param      blocks - array of (stream, block) pairs; pairs of streams which are not
+                open are skipped.
+    @param      count - number of the pairs.
+ */
+void GOST34112018_StoreUpdate(struct GOST34112018_Store            *store,
+                              const struct GOST34112018_StoreBlock *blocks,
+                              const unsigned long long              count);
+
+/**
+    @brief      Hashes the last, incomplete block of the stream, computes its digest and
+                closes the stream. The message of the stream is everything passed to
+                GOST34112018_StoreUpdate followed by the tail. If the stream is not open
+                or the tail is not shorter than 64 bytes, nothing is done: hash_out is
+                not written and the stream stays as it is.
+    @param      store - store.
+    @param      stream - stream.
+    @param      tail - last bytes of the message, may be empty.
+    @param      tail_size - size of the tail, less than 64 bytes.
+    @param      hash_out - output pointer, digest of the stream.
+ */
+void GOST34112018_StoreFinish(struct GOST34112018_Store *store,
+                              const unsigned int         stream,
+                              const unsigned char       *tail,
+                              const unsigned long long   tail_size,
+                              unsigned char             *hash_out);
+
+/**
+    @brief      Touches all of the lookup tables and constants of the algorithm, so the
+                first hash after a period of inactivity does not pay for page faults
+                and cache misses. Optionally the tables are locked in memory, so they
+                can not be paged out. Building the library with ENABLE_PREFAULT does this
+                automatically when the library is loaded.
+    @param      flags - GOST34112018_WarmupTouch or GOST34112018_WarmupLock.
+    @return     0 on success, or errno of the failed mlock. The tables are touched
+                even if locking is not permitted.
+ */
+int GOST34112018_Warmup(const GOST34112018_WarmupFlags_t flags);
+
+/**
+    @brief      Computes digests of an array of independent messages. If the library is
+                built with ENABLE_OPENMP, large batches are split between threads by the
+                number of bytes rather than the number of messages, so messages of very
+                different sizes are spread evenly. Small batches are hashed on the
+                calling thread.
+    @param      messages - array of messages.
+    @param      sizes - array of message sizes in bytes.
+    @param      count - number of messages.
+    @param      hash_size - size of the digests.
+    @param      hashes_out - output pointer, count * hash_size bytes: digest of the i-th
+                message at i * hash_size.
+ */
+void GOST34112018_HashBatch(const unsigned char *const    messages[],
+                            const unsigned long long      sizes[],
+                            const unsigned long long      count,
+                            const GOST34112018_HashSize_t hash_size,
+                            unsigned char                *hashes_out);
+
+/**
+    @brief      Sets the number of threads used by GOST34112018_HashBatch. Has no effect
+                if the library is built without ENABLE_OPENMP.
+    @param      threads - number of threads, 1 to always hash on the calling thread, 0
+                (the default) for the OpenMP default (OMP_NUM_THREADS or all of the
+                processors).
+ */
+void GOST34112018_SetBatchThreads(const int threads);
+
+/**
+    @brief      Sets up content-defined chunking (FastCDC with normalized chunking) for
+                deduplication. Chunk boundaries depend on the content only, so they
+                survive insertions and deletions elsewhere in the data.
+    @param      chunker - output pointer, the parameters.
+    @param      min_size - minimum size of a chunk, except the last one.
+    @param      avg_size - average size of a chunk, a power of two from 64 to 2^40.
+    @param      max_size - maximum size of a chunk.
+    @return     0 on success, EINVAL if the sizes are not min <= avg <= max.
+ */
+int GOST34112018_ChunkerInit(struct GOST34112018_Chunker *chunker,
+                             const unsigned long long     min_size,
+                             const unsigned long long     avg_size,
+                             const unsigned long long     max_size);
+
+/**
+    @brief      Finds the end of the chunk which starts at 'data'.
+    @param      chunker - parameters.
+    @param      data - data from the start of the chunk.
+    @param      size - size of the data.
+    @return     size of the chunk. If it is 'size' and less than max_size, no boundary
+                has been found: the chunk continues past the data, unless the data is
+                the end of the message.
+ */
+unsigned long long GOST34112018_ChunkBoundary(const struct GOST34112018_Chunker *chunker,
+                                              const unsigned char               *data,
+                                              const unsigned long long           size);
+
+/**
+    @brief      Splits a message into content-defined chunks and hashes every chunk, like
+                GOST34112018_HashBatch does (in parallel if the library is built with
+                ENABLE_OPENMP).
+    @param      chunker - parameters.
+    @param      message - message.
+    @param      size - size of the message.
+    @param      hash_size - size of the chunk digests.
+    @param      chunks_out - output array, at least size / min_size + 1 chunks.
+    @return     number of the chunks (0 for an empty message, nothing is allocated), or
+                -1 with errno set.
+ */
+long long GOST34112018_ChunkAndHash(const struct GOST34112018_Chunker *chunker,
+                                   const unsigned char               *message,
+                                   const unsigned long long           size,
+                                   const GOST34112018_HashSize_t      hash_size,
+                                   struct GOST34112018_Chunk         *chunks_out);
+
+/**
+    @brief      Computes the signature of a basis for the rsync algorithm: for every block
+                a rolling checksum and a truncated 256-bit digest. The blocks are hashed
+                in batches, like GOST34112018_HashBatch does (in parallel if the library
+                is built with ENABLE_OPENMP).
+    @param      basis - the basis.
+    @param      size - size of the basis.
+    @param      block_size - size of a block, the last one may be shorter.
+    @param      strong_size - bytes of the digest kept per block, from 1 to 32.
+    @param      blocks_out - output array, (size + block_size - 1) / block_size blocks.
+    @return     number of the blocks, or -1 with errno set.
+ */
+long long GOST34112018_DeltaSignature(const unsigned char                *basis,
+                                      const unsigned long long            size,
+                                      const unsigned long long            block_size,
+                                      const unsigned int                  strong_size,
+                                      struct GOST34112018_BlockSignature *blocks_out);
+
+/**
+    @brief      Computes the delta of a message against the signature of a basis: the
+                message is the concatenation of the instructions. Blocks of the basis are
+                found at any offset of the message with the rolling checksum, and are
+                confirmed with the digest, so a block which has not changed costs one
+                Streebog hash. Adjacent ranges of the basis are merged into one
+                instruction.
+    @param      signature - signature of the basis.
+    @param      message - message.
+    @param      size - size of the message.
+    @param      callback - receives the instructions.
+    @param      user_data - passed to the callback.
+    @return     0 on success, EINVAL for a bad signature, ENOMEM, or the error returned
+                by the callback.
+ */
+int GOST34112018_DeltaCompute(const struct GOST34112018_Signature *signature,
+                              const unsigned char                 *message,
+                              const unsigned long long             size,
+                              const GOST34112018_DeltaCallback_t   callback,
+                              void                                *user_data);
+
+/**
+    @brief      Collects the number of calls and the time spent in the internal
+                functions, summed over all threads since the last
+                GOST34112018_ProfileReset. Only available if the library is built with
+                ENABLE_TIMING, otherwise nothing is collected.
+    @param      entries - output array, one entry per called function.
+    @param      max_entries - size of the output array.
+    @return     number of called functions, it can be greater than max_entries. 0 if
+                the library is built without ENABLE_TIMING.
+ */
+int GOST34112018_ProfileSnapshot(struct GOST34112018_ProfileEntry *entries,
+                                 const int                         max_entries);
+
+/**
+    @brief      Resets the profile collected so far.
+ */
+void GOST34112018_ProfileReset(void);
+
+/**
+    @brief      Creates an asynchronous hashing engine with its own worker threads. Jobs
+                are submitted with GOST34112018_EngineSubmit and completed either by a
+                callback (called on a worker thread) or by GOST34112018_EnginePoll.
+    @param      workers - number of worker threads.
+    @param      flags - GOST34112018_EngineUseEventFd to signal completions on an eventfd.
+    @return     engine, or NULL with errno set.
+ */
+struct GOST34112018_Engine *GOST34112018_EngineCreate(const int                        workers,
+                                                      const GOST34112018_EngineFlags_t flags);
+
+/**
+    @brief      Waits for all submitted jobs, stops the workers and frees the engine.
+                Completed jobs which have not been polled are not returned anymore.
+    @param      engine - engine.
+ */
+void GOST34112018_EngineDestroy(struct GOST34112018_Engine *engine);
+
+/**
+    @brief      Submits a job. Does not block: the job is appended to the queue of the
+                least loaded worker without locks. Can be called from any thread.
+    @param      engine - engine.
+    @param      job - job, owned by the engine until it is completed.
+    @return     0 on success, errno otherwise.
+ */
+int GOST34112018_EngineSubmit(struct GOST34112018_Engine *engine,
+                              struct GOST34112018_Job    *job);
+
+/**
+    @brief      Takes completed jobs without a callback, in the order of completion.
+                Does not block. Must not be called from several threads at once.
+    @param      engine - engine.
+    @param      jobs - output array of completed jobs.
+    @param      max_jobs - size of the output array.
+    @return     number of jobs written to the output array.
+ */
+int GOST34112018_EnginePoll(struct GOST34112018_Engine *engine,
+                            struct GOST34112018_Job   **jobs,
+                            const int                   max_jobs);
+
+/**
+    @brief      Eventfd which becomes readable when there are jobs to poll, for
+                epoll/poll based event loops. GOST34112018_EnginePoll resets it.
+    @param      engine - engine.
+    @return     descriptor, or -1 if the engine is created without
+                GOST34112018_EngineUseEventFd.
+ */
+int GOST34112018_EngineEventFd(const struct GOST34112018_Engine *engine);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
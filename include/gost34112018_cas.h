@@ -0,0 +1,123 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+#ifndef __GOST34112018_CAS_H__
+#define __GOST34112018_CAS_H__
+
+#include "gost34112018.h"
+#include "stddef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+    @brief      Content-addressable store of blobs keyed by their 256-bit digests. A blob
+                is the file STORE/objects/XX/YYYY..., where XXYYYY... is the hex of its
+                digest (in the byte order of GOST34112018_GetHashFromContext, the same as
+                gost34112018_cli prints by default). A store can be used by any number
+                of threads and processes at once.
+ */
+struct GOST34112018_Cas;
+
+/**
+    @brief      Called by GOST34112018_CasFsck for every damaged object, never
+                concurrently.
+    @param      object - path of the object relative to the store.
+    @param      status - EBADMSG if the contents do not match the name, EINVAL if the
+                name is not a digest, errno of a failed read otherwise.
+    @param      user_data - user_data of GOST34112018_CasFsck.
+ */
+typedef void (*GOST34112018_CasFsckCallback_t)(const char *object, int status, void *user_data);
+
+/**
+    @brief      Opens a store.
+    @param      root - directory of the store.
+    @param      create - non-zero to create the directories of the store if they do
+                not exist; otherwise a missing store fails with ENOENT.
+    @return     store, or NULL with errno set.
+ */
+struct GOST34112018_Cas *GOST34112018_CasOpen(const char *root, const int create);
+
+/**
+    @brief      Closes the store.
+    @param      cas - store.
+ */
+void GOST34112018_CasClose(struct GOST34112018_Cas *cas);
+
+/**
+    @brief      Stores the contents of a file descriptor, from its current offset to its
+                end. The data is hashed while it is written to a temporary file, which is
+                then renamed into place, so it is read only once and a blob is either
+                complete or absent. Storing a blob which is already there only costs the
+                hashing.
+    @param      cas - store.
+    @param      fd - file descriptor, readable.
+    @param      digest_out - output pointer, 32-byte digest of the blob.
+    @return     0 on success, errno otherwise.
+ */
+int GOST34112018_CasPutFd(struct GOST34112018_Cas *cas, const int fd, unsigned char *digest_out);
+
+/**
+    @brief      Same as GOST34112018_CasPutFd, for bytes in memory.
+    @param      cas - store.
+    @param      data - blob.
+    @param      size - size of the blob.
+    @param      digest_out - output pointer, 32-byte digest of the blob.
+    @return     0 on success, errno otherwise.
+ */
+int GOST34112018_CasPut(struct GOST34112018_Cas *cas,
+                        const unsigned char     *data,
+                        const size_t             size,
+                        unsigned char           *digest_out);
+
+/**
+    @brief      Opens a blob for reading.
+    @param      cas - store.
+    @param      digest - 32-byte digest of the blob.
+    @return     file descriptor, or -1 with errno set (ENOENT if there is no such blob).
+ */
+int GOST34112018_CasGet(struct GOST34112018_Cas *cas, const unsigned char *digest);
+
+/**
+    @brief      Checks whether a blob is in the store, without opening it.
+    @param      cas - store.
+    @param      digest - 32-byte digest of the blob.
+    @return     1 if it is, 0 if it is not.
+ */
+int GOST34112018_CasHas(struct GOST34112018_Cas *cas, const unsigned char *digest);
+
+/**
+    @brief      Path of a blob, whether it exists or not.
+    @param      cas - store.
+    @param      digest - 32-byte digest of the blob.
+    @param      path_out - output buffer.
+    @param      path_size - size of the output buffer.
+    @return     0 on success, ENAMETOOLONG if the buffer is too small.
+ */
+int GOST34112018_CasPath(const struct GOST34112018_Cas *cas,
+                         const unsigned char           *digest,
+                         char                          *path_out,
+                         const size_t                   path_size);
+
+/**
+    @brief      Hashes every object of the store again with a GOST34112018_Engine and
+                reports the ones which do not match their names.
+    @param      cas - store.
+    @param      workers - number of threads, at most 256 are started.
+    @param      callback - called for every damaged object, may be NULL.
+    @param      user_data - passed to the callback.
+    @param      checked_out - output pointer, number of the objects checked, may be NULL.
+    @return     number of the damaged objects, or -1 with errno set.
+ */
+long long GOST34112018_CasFsck(struct GOST34112018_Cas              *cas,
+                               const int                             workers,
+                               const GOST34112018_CasFsckCallback_t  callback,
+                               void                                 *user_data,
+                               unsigned long long                   *checked_out);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // __GOST34112018_CAS_H__
@@ -0,0 +1,97 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+#ifndef __GOST34112018_CLIENT_H__
+#define __GOST34112018_CLIENT_H__
+
+#include "gost34112018.h"
+#include "stddef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+    @brief      Connection to a hashing daemon (gost34112018_cli --daemon). A connection
+                is used by one thread at a time; threads hashing concurrently should
+                have a connection each.
+ */
+struct GOST34112018_Client;
+
+/**
+    @brief      Connects to the daemon and shares a buffer with it.
+    @param      socket_path - path of the Unix socket of the daemon.
+    @param      shared_size - size of the buffer shared with the daemon, the largest
+                message GOST34112018_ClientHash can send without a file descriptor.
+    @return     connection, or NULL with errno set.
+ */
+struct GOST34112018_Client *GOST34112018_ClientConnect(const char  *socket_path,
+                                                       const size_t shared_size);
+
+/**
+    @brief      Closes the connection and unmaps the shared buffer.
+    @param      client - connection.
+ */
+void GOST34112018_ClientClose(struct GOST34112018_Client *client);
+
+/**
+    @brief      Buffer shared with the daemon. Messages written into it are hashed by the
+                daemon in place with GOST34112018_ClientHashShared, without a copy.
+    @param      client - connection.
+    @param      size - output pointer, size of the buffer.
+    @return     the buffer.
+ */
+unsigned char *GOST34112018_ClientBuffer(struct GOST34112018_Client *client, size_t *size);
+
+/**
+    @brief      Hashes bytes of the shared buffer.
+    @param      client - connection.
+    @param      offset - offset of the message in the shared buffer.
+    @param      length - size of the message.
+    @param      hash_size - size of the message digest.
+    @param      hash_out - output pointer, message digest.
+    @return     0 on success, errno otherwise.
+ */
+int GOST34112018_ClientHashShared(struct GOST34112018_Client   *client,
+                                  const size_t                  offset,
+                                  const size_t                  length,
+                                  const GOST34112018_HashSize_t hash_size,
+                                  unsigned char                *hash_out);
+
+/**
+    @brief      Hashes a message: it is copied into the shared buffer if it fits there,
+                otherwise it is passed to the daemon in a memfd.
+    @param      client - connection.
+    @param      message - message bytes.
+    @param      message_size - size of the message.
+    @param      hash_size - size of the message digest.
+    @param      hash_out - output pointer, message digest.
+    @return     0 on success, errno otherwise.
+ */
+int GOST34112018_ClientHash(struct GOST34112018_Client   *client,
+                            const unsigned char          *message,
+                            const size_t                  message_size,
+                            const GOST34112018_HashSize_t hash_size,
+                            unsigned char                *hash_out);
+
+/**
+    @brief      Hashes the contents of a file descriptor from its current offset to its
+                end. The descriptor is passed to the daemon (SCM_RIGHTS), the data is not
+                copied through the socket.
+    @param      client - connection.
+    @param      fd - file descriptor of a regular file, readable; EINVAL for pipes,
+                sockets and devices.
+    @param      hash_size - size of the message digest.
+    @param      hash_out - output pointer, message digest.
+    @return     0 on success, errno otherwise.
+ */
+int GOST34112018_ClientHashFd(struct GOST34112018_Client   *client,
+                              const int                     fd,
+                              const GOST34112018_HashSize_t hash_size,
+                              unsigned char                *hash_out);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // __GOST34112018_CLIENT_H__
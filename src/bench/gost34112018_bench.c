@@ -0,0 +1,502 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    gost34112018_bench - throughput and latency of the library over a sweep of message
+    sizes (0 B ... 1 GiB), for the one-shot (GOST34112018_HashBytes) and the streaming
+    (GOST34112018_HashBlock) interfaces and for both digest sizes.
+
+    Results are printed as JSON, one result per line. A previous run can be given as a
+    baseline: every result whose fastest iteration (ns_min) is slower than the baseline
+    by more than the threshold is reported, and the exit code is non-zero.
+
+    With --generate the tool only writes the pattern used as the message to stdout, so
+    scripts can create reproducible input files (see gost34112018_cli_bench.sh).
+ */
+
+#include "gost34112018.h"
+#include "gost34112018_bench_common.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "string.h"
+#include "errno.h"
+#include "argp.h"
+
+const char *argp_application_version = "gost34112018_bench ver. 0.1";
+const char *argp_application_bug_address = "anufriewwi@rambler.ru";
+
+enum
+{
+    BLOCK_SIZE          = 64,
+    MIN_ITERATIONS      = 3,
+    EXIT_REGRESSION     = 2,
+    MAX_BASELINE_ITEMS  = 1024,
+};
+
+typedef enum
+{
+    MODE_ONESHOT,
+    MODE_STREAMING,
+    MODE_COUNT,
+} Mode_t;
+
+static const char *g_mode_names[MODE_COUNT] = { "oneshot", "streaming" };
+
+static const uint64_t g_sizes[] = {
+    0, 1, 32, 63, 64, 65, 128, 256, 512,
+    1ull << 10, 4ull << 10, 16ull << 10, 64ull << 10, 256ull << 10,
+    1ull << 20, 4ull << 20, 16ull << 20, 64ull << 20, 256ull << 20,
+    1ull << 30,
+};
+
+struct BenchResult
+{
+    char     mode[16];
+    int      hash_bits;
+    uint64_t size;
+    uint64_t iterations;
+    double   ns_per_op;
+    double   ns_min;
+    double   cycles_per_byte;
+    double   mb_per_s;
+};
+
+uint64_t g_opt_max_size     = 1ull << 30;
+uint64_t g_opt_min_time_ms  = 200;
+int      g_opt_mode         = -1; // all
+int      g_opt_hash_bits    = 0;  // all
+char    *g_opt_output       = NULL;
+char    *g_opt_baseline     = NULL;
+double   g_opt_threshold    = 5.0;
+uint64_t g_opt_generate     = 0;
+bool     g_opt_generate_set = false;
+uint64_t g_opt_seed         = 0x5742534f47ull;
+
+static struct argp_option options[] = {
+    {
+        "max-size",
+        'm',
+        "BYTES",
+        0,
+        "Largest message size of the sweep (K, M and G suffixes are accepted). 1G by default.",
+        0
+    },
+    {
+        "min-time",
+        't',
+        "MS",
+        0,
+        "Minimal time spent on every measurement, in milliseconds. 200 by default.",
+        0
+    },
+    {
+        "mode",
+        'M',
+        "MODE",
+        0,
+        "oneshot, streaming or all (default).",
+        0
+    },
+    {
+        "hash-size",
+        's',
+        "HASH_SIZE",
+        0,
+        "256, 512 or 0 for both (default).",
+        0
+    },
+    {
+        "output",
+        'o',
+        "FILE",
+        0,
+        "Write JSON results to FILE instead of stdout.",
+        0
+    },
+    {
+        "baseline",
+        'B',
+        "FILE",
+        0,
+        "Compare results against a JSON file produced by a previous run.",
+        0
+    },
+    {
+        "threshold",
+        'T',
+        "PERCENT",
+        0,
+        "Slowdown of the fastest iteration against the baseline which is reported as a "
+        "regression. 5 by default.",
+        0
+    },
+    {
+        "generate",
+        'g',
+        "BYTES",
+        0,
+        "Do not benchmark, write BYTES of the message pattern to stdout.",
+        0
+    },
+    {
+        "seed",
+        'S',
+        "SEED",
+        0,
+        "Seed of the message pattern.",
+        0
+    },
+    {0}
+};
+
+static uint64_t ParseSize(const char *arg)
+{
+    char *end = NULL;
+    uint64_t value = strtoull(arg, &end, 10);
+
+    switch (end ? *end : '\0')
+    {
+        case 'k': case 'K': return value << 10;
+        case 'm': case 'M': return value << 20;
+        case 'g': case 'G': return value << 30;
+        default:            return value;
+    }
+}
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+    switch (key) {
+        case 'm':
+            g_opt_max_size = ParseSize(arg);
+            break;
+        case 't':
+            g_opt_min_time_ms = strtoull(arg, NULL, 10);
+            break;
+        case 'M':
+            if (strcmp(arg, "all") == 0)
+                g_opt_mode = -1;
+            else if (strcmp(arg, g_mode_names[MODE_ONESHOT]) == 0)
+                g_opt_mode = MODE_ONESHOT;
+            else if (strcmp(arg, g_mode_names[MODE_STREAMING]) == 0)
+                g_opt_mode = MODE_STREAMING;
+            else
+                argp_error(state, "Unknown mode %s", arg);
+            break;
+        case 's':
+            sscanf(arg, "%d", &g_opt_hash_bits);
+            if (g_opt_hash_bits != 0 && g_opt_hash_bits != 256 && g_opt_hash_bits != 512)
+                argp_error(state, "Unsupported hash size %s", arg);
+            break;
+        case 'o':
+            g_opt_output = arg;
+            break;
+        case 'B':
+            g_opt_baseline = arg;
+            break;
+        case 'g':
+            g_opt_generate     = ParseSize(arg);
+            g_opt_generate_set = true;
+            break;
+        case 'S':
+            g_opt_seed = strtoull(arg, NULL, 0);
+            break;
+        case 'T':
+            sscanf(arg, "%lf", &g_opt_threshold);
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+/**
+    Hashes the message through the streaming interface, the way gost34112018_cli does.
+ */
+static void HashStreaming(const uint8_t                *message,
+                          const uint64_t                size,
+                          const GOST34112018_HashSize_t hash_size,
+                          uint8_t                      *hash)
+{
+    struct GOST34112018_Context ctx;
+    uint64_t i = 0;
+
+    GOST34112018_InitContext(&ctx, hash_size);
+
+    for (; i + BLOCK_SIZE <= size; i += BLOCK_SIZE)
+    {
+        GOST34112018_HashBlock(message + i, BLOCK_SIZE, &ctx);
+    }
+
+    if (i < size)
+    {
+        GOST34112018_HashBlock(message + i, size - i, &ctx);
+    }
+
+    GOST34112018_HashBlockEnd(&ctx);
+    GOST34112018_GetHashFromContext(&ctx, hash);
+}
+
+static void Measure(const Mode_t        mode,
+                    const int           hash_bits,
+                    const uint8_t      *message,
+                    const uint64_t      size,
+                    struct BenchResult *result)
+{
+    const GOST34112018_HashSize_t hash_size = (hash_bits == 512)
+                                            ? GOST34112018_Hash512
+                                            : GOST34112018_Hash256;
+    const uint64_t min_time_ns = g_opt_min_time_ms * 1000000ull;
+
+    uint8_t  hash[GOST34112018_Hash512];
+    uint64_t iterations   = 0;
+    uint64_t total_ns     = 0;
+    uint64_t total_cycles = 0;
+    uint64_t min_ns       = UINT64_MAX;
+
+    while (iterations < MIN_ITERATIONS || total_ns < min_time_ns)
+    {
+        const uint64_t start_ns     = Bench_NowNs();
+        const uint64_t start_cycles = Bench_NowCycles();
+
+        if (mode == MODE_ONESHOT)
+            GOST34112018_HashBytes(message, size, hash_size, hash);
+        else
+            HashStreaming(message, size, hash_size, hash);
+
+        const uint64_t cycles = Bench_NowCycles() - start_cycles;
+        const uint64_t ns     = Bench_NowNs() - start_ns;
+
+        total_ns     += ns;
+        total_cycles += cycles;
+        min_ns        = ns < min_ns ? ns : min_ns;
+        iterations++;
+
+        // a single pass over huge messages is enough
+        if (size >= (256ull << 20) && total_ns >= min_time_ns)
+            break;
+    }
+
+    snprintf(result->mode, sizeof(result->mode), "%s", g_mode_names[mode]);
+    result->hash_bits       = hash_bits;
+    result->size            = size;
+    result->iterations      = iterations;
+    result->ns_per_op       = (double) total_ns / iterations;
+    result->ns_min          = (double) min_ns;
+    result->cycles_per_byte = size ? (double) total_cycles / iterations / size : 0.0;
+    result->mb_per_s        = size ? (size / 1e6) / (result->ns_per_op / 1e9) : 0.0;
+}
+
+/**
+    Writes 'size' bytes of the pattern to stdout, in chunks.
+ */
+static int Generate(const uint64_t size)
+{
+    enum { CHUNK_SIZE = 1 << 20 };
+
+    // the output is the same as Bench_FillPattern of the whole size
+    static uint8_t chunk[CHUNK_SIZE];
+    uint64_t       state = g_opt_seed;
+
+    for (uint64_t done = 0; done < size; )
+    {
+        const uint64_t n = size - done < CHUNK_SIZE ? size - done : CHUNK_SIZE;
+
+        Bench_FillPatternNext(chunk, n, &state);
+
+        if (fwrite(chunk, 1, n, stdout) != n)
+        {
+            log_err("Could not write: %s", strerror(errno));
+            return EIO;
+        }
+        done += n;
+    }
+
+    return 0;
+}
+
+static void PrintResult(FILE *out, const struct BenchResult *r)
+{
+    fprintf(out,
+            "    {\"mode\": \"%s\", \"hash_bits\": %d, \"size\": %llu, \"iterations\": %llu, "
+            "\"ns_per_op\": %.1f, \"ns_min\": %.1f, \"cycles_per_byte\": %.3f, "
+            "\"mb_per_s\": %.3f}",
+            r->mode, r->hash_bits, (unsigned long long) r->size,
+            (unsigned long long) r->iterations, r->ns_per_op, r->ns_min,
+            r->cycles_per_byte, r->mb_per_s);
+}
+
+/**
+    Reads results written by PrintResult. Anything else in the file is ignored.
+ */
+static int LoadBaseline(const char *filename, struct BenchResult *out, const int max)
+{
+    char  line[512];
+    int   count = 0;
+    FILE *fin   = fopen(filename, "r");
+
+    if (!fin)
+    {
+        log_err("Could not open baseline %s: %s", filename, strerror(errno));
+        return -1;
+    }
+
+    while (count < max && fgets(line, sizeof(line), fin))
+    {
+        struct BenchResult *r = &out[count];
+        unsigned long long  size, iterations;
+
+        const int fields = sscanf(line,
+                                  " {\"mode\": \"%15[^\"]\", \"hash_bits\": %d, \"size\": %llu, "
+                                  "\"iterations\": %llu, \"ns_per_op\": %lf, \"ns_min\": %lf",
+                                  r->mode, &r->hash_bits, &size, &iterations, &r->ns_per_op,
+                                  &r->ns_min);
+        if (fields >= 5)
+        {
+            // baselines written before ns_min was recorded only have the mean
+            if (fields == 5)
+                r->ns_min = r->ns_per_op;
+
+            r->size       = size;
+            r->iterations = iterations;
+            count++;
+        }
+    }
+
+    fclose(fin);
+    return count;
+}
+
+/**
+    Compares the fastest iterations: the mean absorbs every preemption and frequency
+    drop of a loaded host, the minimum is much steadier from run to run.
+    @return     true if the result is a regression against the baseline.
+ */
+static bool CompareToBaseline(const struct BenchResult *r,
+                              const struct BenchResult *baseline,
+                              const int                 baseline_count)
+{
+    for (int i = 0; i < baseline_count; i++)
+    {
+        const struct BenchResult *b = &baseline[i];
+
+        if (strcmp(b->mode, r->mode) != 0 || b->hash_bits != r->hash_bits ||
+            b->size != r->size || b->ns_min <= 0.0)
+        {
+            continue;
+        }
+
+        const double change = (r->ns_min / b->ns_min - 1.0) * 100.0;
+        const bool   regressed = change > g_opt_threshold;
+
+        fprintf(stderr, "%-9s %3d %11llu: %12.1f ns -> %12.1f ns (%+6.1f%%)%s\n",
+                r->mode, r->hash_bits, (unsigned long long) r->size,
+                b->ns_min, r->ns_min, change, regressed ? "  REGRESSION" : "");
+
+        return regressed;
+    }
+
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    struct argp argp = { options, parse_opt, 0,
+                         "Throughput and latency of GOST 34.11-2018 over a sweep of sizes.",
+                         0, 0, 0 };
+    error_t argp_error = argp_parse(&argp, argc, argv, 0, 0, 0);
+    if (argp_error != 0)
+    {
+        exit(EINVAL);
+    }
+
+    if (g_opt_generate_set)
+    {
+        return Generate(g_opt_generate);
+    }
+
+    struct BenchResult *baseline = NULL;
+    int baseline_count = 0;
+
+    if (g_opt_baseline)
+    {
+        baseline = calloc(MAX_BASELINE_ITEMS, sizeof(struct BenchResult));
+        if (!baseline)
+        {
+            log_err("Out of memory");
+            exit(ENOMEM);
+        }
+
+        baseline_count = LoadBaseline(g_opt_baseline, baseline, MAX_BASELINE_ITEMS);
+        if (baseline_count < 0)
+        {
+            exit(ENOENT);
+        }
+    }
+
+    uint8_t *message = malloc(g_opt_max_size ? g_opt_max_size : 1);
+    if (!message)
+    {
+        log_err("Could not allocate %llu bytes", (unsigned long long) g_opt_max_size);
+        exit(ENOMEM);
+    }
+
+    Bench_FillPattern(message, g_opt_max_size, g_opt_seed);
+
+    FILE *out = stdout;
+    if (g_opt_output)
+    {
+        out = fopen(g_opt_output, "w");
+        if (!out)
+        {
+            log_err("Could not open %s: %s", g_opt_output, strerror(errno));
+            exit(ENOENT);
+        }
+    }
+
+    const int hash_bits[] = { 256, 512 };
+    const int sizes_count = sizeof(g_sizes) / sizeof(g_sizes[0]);
+    bool      regression  = false;
+    bool      first       = true;
+
+    fprintf(out, "{\n  \"benchmark\": \"gost34112018_bench\",\n  \"results\": [\n");
+
+    for (int mode = 0; mode < MODE_COUNT; mode++)
+    {
+        if (g_opt_mode >= 0 && mode != g_opt_mode)
+            continue;
+
+        for (int h = 0; h < 2; h++)
+        {
+            if (g_opt_hash_bits != 0 && hash_bits[h] != g_opt_hash_bits)
+                continue;
+
+            for (int s = 0; s < sizes_count && g_sizes[s] <= g_opt_max_size; s++)
+            {
+                struct BenchResult result;
+                Measure((Mode_t) mode, hash_bits[h], message, g_sizes[s], &result);
+
+                // results are separated by commas, so the previous line is finished here
+                if (!first)
+                    fprintf(out, ",\n");
+                first = false;
+
+                PrintResult(out, &result);
+                fflush(out);
+
+                if (baseline)
+                    regression |= CompareToBaseline(&result, baseline, baseline_count);
+            }
+        }
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+
+    if (g_opt_output)
+        fclose(out);
+
+    free(message);
+    free(baseline);
+
+    return regression ? EXIT_REGRESSION : 0;
+}
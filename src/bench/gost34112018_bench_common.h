@@ -0,0 +1,70 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+#ifndef __GOST34112018_BENCH_COMMON_H__
+#define __GOST34112018_BENCH_COMMON_H__
+
+#include "stdio.h"
+#include "stdint.h"
+#include "time.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include "x86intrin.h"
+#endif
+
+#define log_err(__fmt, ...) \
+    fprintf(stderr, "[ERROR, %s] " __fmt "\n", __func__, ##__VA_ARGS__)
+
+/**
+    @brief      Monotonic time in nanoseconds.
+ */
+static inline uint64_t Bench_NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+/**
+    @brief      Timestamp counter. On x86 it is the TSC (reference cycles, not core
+                cycles, so frequency scaling shows up in the numbers), on other
+                architectures - nanoseconds.
+ */
+static inline uint64_t Bench_NowCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return Bench_NowNs();
+#endif
+}
+
+/**
+    @brief      Continues the pseudo-random pattern from 'state', so a long pattern can be
+                produced in pieces.
+ */
+static inline void Bench_FillPatternNext(uint8_t *buffer, const uint64_t size, uint64_t *state)
+{
+    uint64_t seed = *state ? *state : 1;
+
+    for (uint64_t i = 0; i < size; i++)
+    {
+        // xorshift64
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        buffer[i] = (uint8_t) seed;
+    }
+
+    *state = seed;
+}
+
+/**
+    @brief      Fills the buffer with a reproducible pseudo-random pattern.
+ */
+static inline void Bench_FillPattern(uint8_t *buffer, const uint64_t size, uint64_t seed)
+{
+    Bench_FillPatternNext(buffer, size, &seed);
+}
+
+#endif // __GOST34112018_BENCH_COMMON_H__
@@ -0,0 +1,186 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    gost34112018_bench_daemon - latency of hashing a small message through a running
+    gost34112018_cli --daemon, compared to hashing it in-process:
+    * inproc - GOST34112018_HashBytes;
+    * shared - GOST34112018_ClientHashShared, the message is already in the shared buffer;
+    * copy   - GOST34112018_ClientHash, the message is copied into the shared buffer;
+    * fd     - GOST34112018_ClientHashFd, the message is passed in a memfd.
+ */
+
+#define _GNU_SOURCE
+
+#include "gost34112018.h"
+#include "gost34112018_client.h"
+#include "gost34112018_bench_common.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "stdint.h"
+#include "string.h"
+#include "errno.h"
+#include "argp.h"
+#include "unistd.h"
+#include "sys/mman.h"
+
+const char *argp_application_version = "gost34112018_bench_daemon ver. 0.1";
+const char *argp_application_bug_address = "anufriewwi@rambler.ru";
+
+typedef enum
+{
+    MODE_INPROC,
+    MODE_SHARED,
+    MODE_COPY,
+    MODE_FD,
+    MODE_COUNT,
+} Mode_t;
+
+static const char *g_mode_names[MODE_COUNT] = { "inproc", "shared", "copy", "fd" };
+
+char     *g_opt_socket       = NULL;
+uint64_t  g_opt_message_size = 4096;
+uint64_t  g_opt_iterations   = 10000;
+
+static struct argp_option options[] = {
+    {
+        "socket",
+        'S',
+        "PATH",
+        0,
+        "Socket of the daemon (gost34112018_cli --daemon PATH). Required.",
+        0
+    },
+    {
+        "message-size",
+        'm',
+        "BYTES",
+        0,
+        "Size of the message. 4096 by default.",
+        0
+    },
+    {
+        "iterations",
+        'i',
+        "N",
+        0,
+        "Number of hashes per mode. 10000 by default.",
+        0
+    },
+    {0}
+};
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+    (void) state;
+
+    switch (key) {
+        case 'S':
+            g_opt_socket = arg;
+            break;
+        case 'm':
+            g_opt_message_size = strtoull(arg, NULL, 10);
+            break;
+        case 'i':
+            g_opt_iterations = strtoull(arg, NULL, 10);
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static int HashOnce(const Mode_t mode, struct GOST34112018_Client *client, const uint8_t *message,
+                    const int memfd, uint8_t *hash)
+{
+    switch (mode)
+    {
+        case MODE_INPROC:
+            GOST34112018_HashBytes(message, g_opt_message_size, GOST34112018_Hash256, hash);
+            return 0;
+        case MODE_SHARED:
+            return GOST34112018_ClientHashShared(client, 0, g_opt_message_size,
+                                                 GOST34112018_Hash256, hash);
+        case MODE_COPY:
+            return GOST34112018_ClientHash(client, message, g_opt_message_size,
+                                           GOST34112018_Hash256, hash);
+        default:
+            lseek(memfd, 0, SEEK_SET);
+            return GOST34112018_ClientHashFd(client, memfd, GOST34112018_Hash256, hash);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct argp argp = { options, parse_opt, 0,
+                         "Latency of GOST 34.11-2018 through gost34112018_cli --daemon.",
+                         0, 0, 0 };
+    error_t argp_error = argp_parse(&argp, argc, argv, 0, 0, 0);
+    if (argp_error != 0 || !g_opt_socket || g_opt_iterations == 0)
+    {
+        log_err("Invalid arguments");
+        exit(EINVAL);
+    }
+
+    struct GOST34112018_Client *client = GOST34112018_ClientConnect(g_opt_socket,
+                                                                    g_opt_message_size);
+    if (!client)
+    {
+        log_err("Could not connect to %s: %s", g_opt_socket, strerror(errno));
+        exit(errno);
+    }
+
+    uint8_t *message = malloc(g_opt_message_size + 1);
+    size_t   shared_size;
+    uint8_t *shared  = GOST34112018_ClientBuffer(client, &shared_size);
+    int      memfd   = memfd_create("gost34112018_bench_daemon", MFD_CLOEXEC);
+
+    if (!message || memfd < 0)
+    {
+        log_err("Out of resources");
+        exit(ENOMEM);
+    }
+
+    Bench_FillPattern(message, g_opt_message_size, 1);
+    memcpy(shared, message, g_opt_message_size);
+    if (write(memfd, message, g_opt_message_size) != (ssize_t) g_opt_message_size)
+    {
+        log_err("Could not fill the memfd");
+        exit(EIO);
+    }
+
+    uint8_t reference[32];
+    GOST34112018_HashBytes(message, g_opt_message_size, GOST34112018_Hash256, reference);
+
+    printf("%-7s %12s %12s  (%llu-byte messages)\n", "mode", "ns/hash", "hashes/s",
+           (unsigned long long) g_opt_message_size);
+
+    for (int mode = 0; mode < MODE_COUNT; mode++)
+    {
+        uint8_t hash[32];
+
+        const uint64_t start = Bench_NowNs();
+        for (uint64_t i = 0; i < g_opt_iterations; i++)
+        {
+            const int rc = HashOnce((Mode_t) mode, client, message, memfd, hash);
+            if (rc != 0)
+            {
+                log_err("%s failed: %s", g_mode_names[mode], strerror(rc));
+                exit(rc);
+            }
+        }
+        const double ns = (double) (Bench_NowNs() - start) / g_opt_iterations;
+
+        if (memcmp(hash, reference, sizeof(hash)) != 0)
+        {
+            log_err("%s: digest mismatch", g_mode_names[mode]);
+            exit(EPROTO);
+        }
+
+        printf("%-7s %12.0f %12.0f\n", g_mode_names[mode], ns, 1e9 / ns);
+    }
+
+    close(memfd);
+    free(message);
+    GOST34112018_ClientClose(client);
+    return 0;
+}
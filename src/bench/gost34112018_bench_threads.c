@@ -0,0 +1,284 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    gost34112018_bench_threads - scaling of the streaming interface over 1..N threads.
+
+    Every thread hashes its own message with its own context, so the only things the
+    threads share are the read-only tables of the library and, depending on the layout,
+    cache lines of the contexts:
+    * packed - contexts are elements of one array (struct GOST34112018_Context[N]);
+    * padded - every context sits in its own 128-byte slot, so neither the contexts nor
+               the lines fetched by the adjacent-line prefetcher are shared.
+    If packed scales worse than padded, the contexts share cache lines (false sharing).
+
+    Efficiency is the throughput of N threads divided by N times the throughput of a
+    single thread.
+ */
+
+#include "gost34112018.h"
+#include "gost34112018_bench_common.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdatomic.h"
+#include "string.h"
+#include "errno.h"
+#include "argp.h"
+#include "unistd.h"
+#include "pthread.h"
+#include "sched.h"
+
+const char *argp_application_version = "gost34112018_bench_threads ver. 0.1";
+const char *argp_application_bug_address = "anufriewwi@rambler.ru";
+
+enum
+{
+    BLOCK_SIZE     = 64,
+    PADDED_SLOT    = 128,
+    MAX_THREADS    = 256,
+};
+
+typedef enum
+{
+    LAYOUT_PACKED,
+    LAYOUT_PADDED,
+    LAYOUT_COUNT,
+} Layout_t;
+
+static const char *g_layout_names[LAYOUT_COUNT] = { "packed", "padded" };
+
+struct Worker
+{
+    pthread_t                    thread;
+    struct GOST34112018_Context *ctx;
+    uint8_t                     *message;
+    uint64_t                     bytes;
+};
+
+int      g_opt_threads      = 0; // number of online CPUs
+uint64_t g_opt_message_size = 64 * 1024;
+uint64_t g_opt_duration_ms  = 500;
+int      g_opt_layout       = -1; // all
+
+static atomic_int  g_ready;
+static atomic_bool g_go;
+static atomic_bool g_stop;
+
+static struct argp_option options[] = {
+    {
+        "threads",
+        't',
+        "N",
+        0,
+        "Largest number of threads. The number of online CPUs by default.",
+        0
+    },
+    {
+        "message-size",
+        'm',
+        "BYTES",
+        0,
+        "Size of the message of every thread, hashed over and over. 65536 by default.",
+        0
+    },
+    {
+        "duration",
+        'd',
+        "MS",
+        0,
+        "Duration of every measurement, in milliseconds. 500 by default.",
+        0
+    },
+    {
+        "layout",
+        'l',
+        "LAYOUT",
+        0,
+        "packed, padded or all (default).",
+        0
+    },
+    {0}
+};
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+    (void) state;
+
+    switch (key) {
+        case 't':
+            sscanf(arg, "%d", &g_opt_threads);
+            break;
+        case 'm':
+            g_opt_message_size = strtoull(arg, NULL, 10);
+            break;
+        case 'd':
+            g_opt_duration_ms = strtoull(arg, NULL, 10);
+            break;
+        case 'l':
+            if (strcmp(arg, "all") == 0)
+                g_opt_layout = -1;
+            else if (strcmp(arg, "packed") == 0)
+                g_opt_layout = LAYOUT_PACKED;
+            else if (strcmp(arg, "padded") == 0)
+                g_opt_layout = LAYOUT_PADDED;
+            else
+                return EINVAL;
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static void *WorkerThread(void *arg)
+{
+    struct Worker *w = arg;
+    uint64_t       bytes = 0;
+
+    GOST34112018_InitContext(w->ctx, GOST34112018_Hash512);
+
+    atomic_fetch_add(&g_ready, 1);
+    while (!atomic_load_explicit(&g_go, memory_order_acquire))
+        sched_yield();
+
+    while (!atomic_load_explicit(&g_stop, memory_order_relaxed))
+    {
+        for (uint64_t i = 0; i + BLOCK_SIZE <= g_opt_message_size; i += BLOCK_SIZE)
+        {
+            GOST34112018_HashBlock(w->message + i, BLOCK_SIZE, w->ctx);
+        }
+        bytes += g_opt_message_size - g_opt_message_size % BLOCK_SIZE;
+    }
+
+    w->bytes = bytes;
+    return NULL;
+}
+
+static size_t ContextStride(const Layout_t layout)
+{
+    const size_t size = sizeof(struct GOST34112018_Context);
+
+    if (layout == LAYOUT_PACKED)
+        return size;
+
+    return PADDED_SLOT * ((size + PADDED_SLOT - 1) / PADDED_SLOT);
+}
+
+/**
+    Thread counts are 1, 2, 4, ... and the largest one.
+ */
+static int NextThreadCount(const int n)
+{
+    if (n >= g_opt_threads)
+        return n + 1;
+
+    return n * 2 < g_opt_threads ? n * 2 : g_opt_threads;
+}
+
+/**
+    Runs 'count' threads for the configured duration.
+    @return     total throughput, MB/s.
+ */
+static double Run(const Layout_t layout, const int count, uint8_t *contexts, uint8_t *messages)
+{
+    struct Worker workers[MAX_THREADS];
+    const size_t  stride = ContextStride(layout);
+
+    atomic_store(&g_ready, 0);
+    atomic_store(&g_go, false);
+    atomic_store(&g_stop, false);
+
+    for (int i = 0; i < count; i++)
+    {
+        workers[i].ctx     = (struct GOST34112018_Context *) (contexts + i * stride);
+        workers[i].message = messages + i * g_opt_message_size;
+        workers[i].bytes   = 0;
+
+        if (pthread_create(&workers[i].thread, NULL, WorkerThread, &workers[i]) != 0)
+        {
+            log_err("Could not create thread %d", i);
+            exit(EAGAIN);
+        }
+    }
+
+    while (atomic_load(&g_ready) != count)
+        sched_yield();
+
+    const uint64_t start = Bench_NowNs();
+    atomic_store_explicit(&g_go, true, memory_order_release);
+
+    usleep(g_opt_duration_ms * 1000);
+
+    atomic_store(&g_stop, true);
+    const uint64_t elapsed = Bench_NowNs() - start;
+
+    uint64_t bytes = 0;
+    for (int i = 0; i < count; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        bytes += workers[i].bytes;
+    }
+
+    return (double) bytes / ((double) elapsed / 1e9) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    struct argp argp = { options, parse_opt, 0,
+                         "Multi-thread scaling of GOST 34.11-2018 with packed and padded "
+                         "contexts.",
+                         0, 0, 0 };
+    error_t argp_error = argp_parse(&argp, argc, argv, 0, 0, 0);
+    if (argp_error != 0)
+    {
+        exit(EINVAL);
+    }
+
+    if (g_opt_threads <= 0)
+    {
+        g_opt_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    if (g_opt_threads > MAX_THREADS || g_opt_message_size < BLOCK_SIZE || g_opt_duration_ms == 0)
+    {
+        log_err("Invalid arguments");
+        exit(EINVAL);
+    }
+
+    uint8_t *contexts = aligned_alloc(PADDED_SLOT, g_opt_threads * ContextStride(LAYOUT_PADDED));
+    uint8_t *messages = malloc(g_opt_threads * g_opt_message_size);
+    if (!contexts || !messages)
+    {
+        log_err("Out of memory");
+        exit(ENOMEM);
+    }
+
+    Bench_FillPattern(messages, g_opt_threads * g_opt_message_size, 1);
+
+    printf("%-7s %7s %12s %12s %10s  (%llu-byte messages, %llu ms)\n",
+           "layout", "threads", "total MB/s", "thread MB/s", "efficiency",
+           (unsigned long long) g_opt_message_size, (unsigned long long) g_opt_duration_ms);
+
+    for (int l = 0; l < LAYOUT_COUNT; l++)
+    {
+        if (g_opt_layout >= 0 && l != g_opt_layout)
+            continue;
+
+        double single = 0.0;
+
+        for (int n = 1; n <= g_opt_threads; n = NextThreadCount(n))
+        {
+            const double total = Run((Layout_t) l, n, contexts, messages);
+            if (n == 1)
+                single = total;
+
+            printf("%-7s %7d %12.2f %12.2f %9.1f%%\n", g_layout_names[l], n, total, total / n,
+                   single > 0.0 ? 100.0 * total / (n * single) : 0.0);
+        }
+    }
+
+    free(contexts);
+    free(messages);
+    return 0;
+}
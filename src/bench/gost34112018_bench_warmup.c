@@ -0,0 +1,236 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    gost34112018_bench_warmup - measures latency of the first hash in a fresh process,
+    with and without GOST34112018_Warmup.
+
+    Every sample is taken in a freshly forked child, which has not touched the tables
+    of the library yet. Scenarios:
+    * cold  - caches are flushed, the first hash pays for page faults and cache misses;
+    * warm  - GOST34112018_Warmup is called on start up, then caches are flushed (as if
+              the process was idle for a while), then the first hash;
+    * hot   - GOST34112018_Warmup is called right before the first hash.
+ */
+
+#include "gost34112018.h"
+#include "gost34112018_bench_common.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "string.h"
+#include "errno.h"
+#include "argp.h"
+#include "time.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+const char *argp_application_version = "gost34112018_bench_warmup ver. 0.1";
+const char *argp_application_bug_address = "anufriewwi@rambler.ru";
+
+enum
+{
+    EVICTION_BUFFER_SIZE = 64 * 1024 * 1024,
+    MAX_MESSAGE_SIZE     = 1024 * 1024,
+};
+
+typedef enum
+{
+    SCENARIO_COLD,
+    SCENARIO_WARM,
+    SCENARIO_HOT,
+    SCENARIO_COUNT,
+} Scenario_t;
+
+static const char *g_scenario_names[SCENARIO_COUNT] = { "cold", "warm", "hot" };
+
+int  g_opt_samples      = 200;
+int  g_opt_message_size = 64;
+bool g_opt_lock         = false;
+
+static struct argp_option options[] = {
+    {
+        "samples",
+        'n',
+        "SAMPLES",
+        0,
+        "Number of processes to sample per scenario. 200 by default.",
+        0
+    },
+    {
+        "message-size",
+        'm',
+        "BYTES",
+        0,
+        "Size of the hashed message. 64 by default.",
+        0
+    },
+    {
+        "lock",
+        'l',
+        0,
+        0,
+        "Lock the tables in memory (GOST34112018_WarmupLock) in the warm scenarios.",
+        0
+    },
+    {0}
+};
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+    (void) state;
+
+    switch (key) {
+        case 'n':
+            sscanf(arg, "%d", &g_opt_samples);
+            break;
+        case 'm':
+            sscanf(arg, "%d", &g_opt_message_size);
+            break;
+        case 'l':
+            g_opt_lock = true;
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+/**
+    Writes a buffer much larger than the last level cache, so the tables of the library
+    are evicted from it.
+ */
+static void EvictCaches(void)
+{
+    static volatile uint8_t buffer[EVICTION_BUFFER_SIZE];
+
+    for (size_t i = 0; i < EVICTION_BUFFER_SIZE; i += 64)
+    {
+        buffer[i] += 1;
+    }
+}
+
+/**
+    Runs one sample of the scenario in the calling (freshly forked) process.
+ */
+static uint64_t RunSample(const Scenario_t scenario, const uint8_t *message)
+{
+    const GOST34112018_WarmupFlags_t flags = g_opt_lock
+                                           ? GOST34112018_WarmupLock
+                                           : GOST34112018_WarmupTouch;
+    uint8_t hash[GOST34112018_Hash512];
+
+    switch (scenario)
+    {
+        case SCENARIO_COLD:
+            EvictCaches();
+            break;
+        case SCENARIO_WARM:
+            GOST34112018_Warmup(flags);
+            EvictCaches();
+            break;
+        case SCENARIO_HOT:
+            EvictCaches();
+            GOST34112018_Warmup(flags);
+            break;
+        default:
+            break;
+    }
+
+    const uint64_t start = Bench_NowNs();
+    GOST34112018_HashBytes(message, g_opt_message_size, GOST34112018_Hash512, hash);
+    return Bench_NowNs() - start;
+}
+
+static int CompareU64(const void *lhs, const void *rhs)
+{
+    const uint64_t a = *(const uint64_t *) lhs;
+    const uint64_t b = *(const uint64_t *) rhs;
+    return (a > b) - (a < b);
+}
+
+static uint64_t Percentile(const uint64_t *sorted, const int count, const int pct)
+{
+    int index = (count * pct) / 100;
+    return sorted[index < count ? index : count - 1];
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t message[MAX_MESSAGE_SIZE];
+
+    struct argp argp = { options, parse_opt, 0,
+                         "Cold versus warm latency of the first hash in a process.",
+                         0, 0, 0 };
+    error_t argp_error = argp_parse(&argp, argc, argv, 0, 0, 0);
+    if (argp_error != 0)
+    {
+        exit(EINVAL);
+    }
+
+    if (g_opt_samples <= 0 || g_opt_message_size < 0 || g_opt_message_size > MAX_MESSAGE_SIZE)
+    {
+        log_err("Invalid arguments");
+        exit(EINVAL);
+    }
+
+    Bench_FillPattern(message, g_opt_message_size, 1);
+
+    uint64_t *latencies = calloc(g_opt_samples, sizeof(uint64_t));
+    if (!latencies)
+    {
+        log_err("Out of memory");
+        exit(ENOMEM);
+    }
+
+    printf("%-6s %10s %10s %10s %10s  (ns, %d samples, %d-byte message)\n",
+           "", "min", "p50", "p99", "max", g_opt_samples, g_opt_message_size);
+
+    for (int s = 0; s < SCENARIO_COUNT; s++)
+    {
+        for (int i = 0; i < g_opt_samples; i++)
+        {
+            int fds[2];
+            if (pipe(fds) != 0)
+            {
+                log_err("pipe: %s", strerror(errno));
+                exit(EIO);
+            }
+
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                log_err("fork: %s", strerror(errno));
+                exit(EIO);
+            }
+
+            if (pid == 0)
+            {
+                uint64_t latency = RunSample((Scenario_t) s, message);
+                ssize_t  written = write(fds[1], &latency, sizeof(latency));
+                _exit(written == sizeof(latency) ? 0 : 1);
+            }
+
+            close(fds[1]);
+            if (read(fds[0], &latencies[i], sizeof(latencies[i])) != sizeof(latencies[i]))
+            {
+                log_err("Sample %d of scenario %s failed", i, g_scenario_names[s]);
+                exit(EIO);
+            }
+
+            close(fds[0]);
+            waitpid(pid, NULL, 0);
+        }
+
+        qsort(latencies, g_opt_samples, sizeof(uint64_t), CompareU64);
+
+        printf("%-6s %10llu %10llu %10llu %10llu\n", g_scenario_names[s],
+               (unsigned long long) latencies[0],
+               (unsigned long long) Percentile(latencies, g_opt_samples, 50),
+               (unsigned long long) Percentile(latencies, g_opt_samples, 99),
+               (unsigned long long) latencies[g_opt_samples - 1]);
+    }
+
+    free(latencies);
+    return 0;
+}
@@ -0,0 +1,187 @@
+#!/usr/bin/env bash
+# Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+# SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+# gost34112018_cli_bench.sh - end-to-end throughput of gost34112018_cli.
+#
+# Generates a reproducible corpus (with gost34112018_bench --generate) on disk and on
+# tmpfs, then runs the CLI over it:
+# * input   - stdin pipe ("cat FILE | cli") or --file;
+# * storage - disk (--corpus directory) or tmpfs (--tmpfs directory);
+# * size    - tiny (4 KiB), medium (1 MiB) and huge (--huge-size, 256 MiB by default)
+#             files, and a scan of many small files (one process per file);
+# * cache   - warm (the file was read right before) or cold (the file is dropped from
+#             the page cache with "dd iflag=nocache", disk only).
+#
+# Every scenario is run --runs times, the fastest run is reported. Results are JSON, one
+# object per line:
+# {"scenario":"huge","storage":"disk","input":"file","cache":"cold","files":1,
+#  "bytes":268435456,"seconds":1.234,"mb_per_s":217.5,"files_per_s":0.81}
+#
+# Usage: gost34112018_cli_bench.sh --cli PATH --bench PATH [--corpus DIR] [--tmpfs DIR]
+#                                  [--huge-size BYTES] [--many-files N] [--runs N]
+#                                  [--output FILE]
+
+set -euo pipefail
+
+CLI=""
+BENCH=""
+CORPUS_DIR="${TMPDIR:-/tmp}/gost34112018_cli_bench"
+TMPFS_DIR="/dev/shm/gost34112018_cli_bench"
+HUGE_SIZE=$((256 * 1024 * 1024))
+MANY_FILES=1000
+RUNS=3
+OUTPUT="/dev/stdout"
+
+usage()
+{
+    sed -n '/^# Usage:/,/^$/p' "$0" | sed 's/^# \{0,1\}//' >&2
+    exit 22 # EINVAL
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --cli)        CLI="$2";        shift 2 ;;
+        --bench)      BENCH="$2";      shift 2 ;;
+        --corpus)     CORPUS_DIR="$2"; shift 2 ;;
+        --tmpfs)      TMPFS_DIR="$2";  shift 2 ;;
+        --huge-size)  HUGE_SIZE="$2";  shift 2 ;;
+        --many-files) MANY_FILES="$2"; shift 2 ;;
+        --runs)       RUNS="$2";       shift 2 ;;
+        --output)     OUTPUT="$2";     shift 2 ;;
+        *)            usage ;;
+    esac
+done
+
+[ -x "$CLI" ] && [ -x "$BENCH" ] || usage
+
+log()
+{
+    echo "[gost34112018_cli_bench] $*" >&2
+}
+
+now_ns()
+{
+    date +%s%N
+}
+
+# generate DIR - writes the corpus into DIR, unless it is already there
+generate()
+{
+    local dir="$1"
+
+    mkdir -p "$dir/many"
+
+    [ -f "$dir/.complete" ] && [ "$(cat "$dir/.complete")" = "$HUGE_SIZE $MANY_FILES" ] \
+        && return 0
+
+    log "generating corpus in $dir"
+    "$BENCH" --generate 4K   --seed 1 > "$dir/tiny.bin"
+    "$BENCH" --generate 1M   --seed 2 > "$dir/medium.bin"
+    "$BENCH" --generate "$HUGE_SIZE" --seed 3 > "$dir/huge.bin"
+
+    rm -f "$dir"/many/*
+    for i in $(seq 1 "$MANY_FILES"); do
+        "$BENCH" --generate 4K --seed $((100 + i)) > "$dir/many/$i.bin"
+    done
+
+    echo "$HUGE_SIZE $MANY_FILES" > "$dir/.complete"
+}
+
+# prepare_cache CACHE FILES... - warms the files up or drops them from the page cache
+prepare_cache()
+{
+    local cache="$1"
+    shift
+
+    for f in "$@"; do
+        if [ "$cache" = "cold" ]; then
+            dd if="$f" iflag=nocache count=0 status=none
+        else
+            cat "$f" > /dev/null
+        fi
+    done
+}
+
+# hash INPUT FILES... - runs the CLI once per file
+hash_files()
+{
+    local input="$1"
+    shift
+
+    for f in "$@"; do
+        if [ "$input" = "pipe" ]; then
+            cat "$f" | "$CLI" > /dev/null
+        else
+            "$CLI" --file "$f" > /dev/null
+        fi
+    done
+}
+
+# run SCENARIO STORAGE INPUT CACHE FILES... - prints one JSON result
+run()
+{
+    local scenario="$1" storage="$2" input="$3" cache="$4"
+    shift 4
+
+    local bytes
+    bytes=$(cat "$@" | wc -c)
+
+    local best=""
+    for _ in $(seq 1 "$RUNS"); do
+        prepare_cache "$cache" "$@"
+
+        local start end
+        start=$(now_ns)
+        hash_files "$input" "$@"
+        end=$(now_ns)
+
+        local elapsed=$((end - start))
+        if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+            best=$elapsed
+        fi
+    done
+
+    awk -v s="$scenario" -v st="$storage" -v inp="$input" -v c="$cache" \
+        -v files="$#" -v bytes="$bytes" -v ns="$best" 'BEGIN {
+        secs = ns / 1e9
+        printf "{\"scenario\":\"%s\",\"storage\":\"%s\",\"input\":\"%s\",\"cache\":\"%s\",", s, st, inp, c
+        printf "\"files\":%d,\"bytes\":%d,\"seconds\":%.6f,", files, bytes, secs
+        printf "\"mb_per_s\":%.2f,\"files_per_s\":%.2f}\n", bytes / secs / 1e6, files / secs
+    }'
+}
+
+STORAGES="disk"
+generate "$CORPUS_DIR"
+
+if [ -d "$(dirname "$TMPFS_DIR")" ] && \
+   [ "$(stat -f -c %T "$(dirname "$TMPFS_DIR")")" = "tmpfs" ]; then
+    generate "$TMPFS_DIR"
+    STORAGES="disk tmpfs"
+else
+    log "$(dirname "$TMPFS_DIR") is not tmpfs, tmpfs scenarios are skipped"
+fi
+
+{
+    for storage in $STORAGES; do
+        if [ "$storage" = "disk" ]; then
+            dir="$CORPUS_DIR"
+            caches="warm cold"
+        else
+            dir="$TMPFS_DIR"
+            caches="warm" # tmpfs is the page cache
+        fi
+
+        for cache in $caches; do
+            for input in pipe file; do
+                for scenario in tiny medium huge; do
+                    log "$scenario $storage $input $cache"
+                    run "$scenario" "$storage" "$input" "$cache" "$dir/$scenario.bin"
+                done
+
+                log "many $storage $input $cache"
+                run many "$storage" "$input" "$cache" "$dir"/many/*.bin
+            done
+        done
+    done
+} > "$OUTPUT"
@@ -0,0 +1,411 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    gost34112018_microbench - calls every internal transformation of one implementation
+    in isolation and reads hardware performance counters (cycles, instructions, L1D read
+    misses, branch misses) around it.
+
+    The internal transformations are static, so the source file of the implementation
+    is included right here (see MICROBENCH_SOURCE in CMakeLists.txt). One executable is
+    built per implementation: gost34112018_microbench_reference, _optimized and _avx2.
+
+    Each transformation is called through a wrapper, which feeds its output back as the
+    next input, so the numbers are latencies of a dependent chain of calls.
+ */
+
+#include MICROBENCH_SOURCE
+
+#include "gost34112018_bench_common.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "argp.h"
+#include "unistd.h"
+#include "sys/ioctl.h"
+#include "sys/syscall.h"
+#include "linux/perf_event.h"
+
+const char *argp_application_version = "gost34112018_microbench ver. 0.1";
+const char *argp_application_bug_address = "anufriewwi@rambler.ru";
+
+enum
+{
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_L1D_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTERS_COUNT,
+};
+
+struct Counters
+{
+    int      fds[COUNTERS_COUNT];
+    GostBool available;
+};
+
+struct Transform
+{
+    const char *name;
+    void      (*call)(union Vec512 *state);
+};
+
+unsigned long long g_opt_iterations = 200000;
+char              *g_opt_filter     = NULL;
+
+static struct argp_option options[] = {
+    {
+        "iterations",
+        'i',
+        "COUNT",
+        0,
+        "Number of calls of every transformation. 200000 by default.",
+        0
+    },
+    {
+        "filter",
+        'f',
+        "NAME",
+        0,
+        "Run only transformations whose name contains NAME.",
+        0
+    },
+    {0}
+};
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+    (void) state;
+
+    switch (key) {
+        case 'i':
+            g_opt_iterations = strtoull(arg, NULL, 10);
+            break;
+        case 'f':
+            g_opt_filter = arg;
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+/*
+    Wrappers. 'state' is both the input and the output of every call.
+ */
+
+static void Call_Vec512_Xor(union Vec512 *state)
+{
+    union Vec512 r;
+    Vec512_Xor(state, C[0], &r);
+    *state = r;
+}
+
+static void Call_Vec512_Add(union Vec512 *state)
+{
+    union Vec512 r;
+    Vec512_Add(state, C[1], &r);
+    *state = r;
+}
+
+#if defined(MICROBENCH_REFERENCE)
+static void Call_STransform(union Vec512 *state)
+{
+    union Vec512 r;
+    STransform(state, &r);
+    *state = r;
+}
+
+static void Call_LTransform(union Vec512 *state)
+{
+    union Vec512 r;
+    LTransform(state, &r);
+    *state = r;
+}
+#endif // MICROBENCH_REFERENCE
+
+#if defined(MICROBENCH_REFERENCE) || !defined(__ENABLE_UNROLLED_ROUNDS__)
+static void Call_XTransform(union Vec512 *state)
+{
+    union Vec512 r;
+    XTransform(state, C[2], &r);
+    *state = r;
+}
+#endif
+
+static void Call_PTransform(union Vec512 *state)
+{
+    union Vec512 r;
+    PTransform(state, &r);
+    *state = r;
+}
+
+#if !defined(MICROBENCH_REFERENCE)
+static void Call_SLCombinedTransform(union Vec512 *state)
+{
+    union Vec512 r;
+    SLCombinedTransform(state, &r);
+    *state = r;
+}
+#endif
+
+#if !defined(MICROBENCH_REFERENCE) && defined(__ENABLE_UNROLLED_ROUNDS__)
+static void Call_LPSX_Unrolled(union Vec512 *state)
+{
+    LPSX_Unrolled(state, C[2], state);
+}
+#endif
+
+static void Call_K_i(union Vec512 *state)
+{
+    union Vec512 r;
+    K_i(5, state, &r);
+    *state = r;
+}
+
+static void Call_KeySchedule(union Vec512 *state)
+{
+    union Vec512 K[C_SIZE + 1];
+    KeySchedule(state, &ZERO_VECTOR_512, K);
+    *state = K[C_SIZE];
+}
+
+static void Call_E(union Vec512 *state)
+{
+    union Vec512 r;
+    E(C[3], state, &r);
+    *state = r;
+}
+
+static void Call_E_Scheduled(union Vec512 *state)
+{
+    static union Vec512 K[C_SIZE + 1];
+    static GostBool     initialized = false;
+    union  Vec512       r;
+
+    if (!initialized)
+    {
+        KeySchedule(&INIT_VECTOR_512, &ZERO_VECTOR_512, K);
+        initialized = true;
+    }
+
+    E_Scheduled(K, state, &r);
+    *state = r;
+}
+
+static void Call_G_N(union Vec512 *state)
+{
+    union Vec512 r;
+    G_N(C[4], state, C[5], &r);
+    *state = r;
+}
+
+static void Call_G_N_x2(union Vec512 *state)
+{
+    union Vec512 r;
+    G_N_x2(C[4], state, C[5], C[6], state, C[5], &r, state);
+}
+
+static const struct Transform g_transforms[] = {
+    { "Vec512_Xor",          Call_Vec512_Xor          },
+    { "Vec512_Add",          Call_Vec512_Add          },
+#if defined(MICROBENCH_REFERENCE) || !defined(__ENABLE_UNROLLED_ROUNDS__)
+    { "XTransform",          Call_XTransform          },
+#endif
+#if defined(MICROBENCH_REFERENCE)
+    { "STransform",          Call_STransform          },
+#endif
+    { "PTransform",          Call_PTransform          },
+#if defined(MICROBENCH_REFERENCE)
+    { "LTransform",          Call_LTransform          },
+#else
+    { "SLCombinedTransform", Call_SLCombinedTransform },
+#endif
+#if !defined(MICROBENCH_REFERENCE) && defined(__ENABLE_UNROLLED_ROUNDS__)
+    { "LPSX_Unrolled",       Call_LPSX_Unrolled       },
+#endif
+    { "K_i",                 Call_K_i                 },
+    { "KeySchedule",         Call_KeySchedule         },
+    { "E",                   Call_E                   },
+    { "E_Scheduled",         Call_E_Scheduled         },
+    { "G_N",                 Call_G_N                 },
+    { "G_N_x2",              Call_G_N_x2              },
+};
+
+static int PerfEventOpen(const uint32_t type, const uint64_t config, const int group_fd)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.disabled       = (group_fd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP;
+
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static void Counters_Open(struct Counters *counters)
+{
+    const uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D
+                                 | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                 | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    counters->fds[COUNTER_CYCLES] =
+        PerfEventOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+
+    counters->available = counters->fds[COUNTER_CYCLES] >= 0;
+    if (!counters->available)
+    {
+        fprintf(stderr, "Hardware counters are not available (%s), only time is measured. "
+                        "Check /proc/sys/kernel/perf_event_paranoid.\n", strerror(errno));
+        return;
+    }
+
+    const int leader = counters->fds[COUNTER_CYCLES];
+
+    counters->fds[COUNTER_INSTRUCTIONS] =
+        PerfEventOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader);
+    counters->fds[COUNTER_L1D_MISSES] =
+        PerfEventOpen(PERF_TYPE_HW_CACHE, l1d_read_miss, leader);
+    counters->fds[COUNTER_BRANCH_MISSES] =
+        PerfEventOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, leader);
+
+    for (int i = 0; i < COUNTERS_COUNT; i++)
+    {
+        if (counters->fds[i] < 0)
+        {
+            fprintf(stderr, "Counter %d is not available: %s\n", i, strerror(errno));
+        }
+    }
+}
+
+static void Counters_Close(struct Counters *counters)
+{
+    if (!counters->available)
+        return;
+
+    for (int i = 0; i < COUNTERS_COUNT; i++)
+    {
+        if (counters->fds[i] >= 0)
+            close(counters->fds[i]);
+    }
+}
+
+/**
+    Reads the group of counters. Counters which could not be opened read as zero.
+ */
+static void Counters_Read(const struct Counters *counters, uint64_t values[COUNTERS_COUNT])
+{
+    uint64_t buffer[1 + COUNTERS_COUNT] = { 0 };
+
+    memset(values, 0, COUNTERS_COUNT * sizeof(uint64_t));
+    if (!counters->available)
+        return;
+
+    if (read(counters->fds[COUNTER_CYCLES], buffer, sizeof(buffer)) <= 0)
+        return;
+
+    // values come in the order the counters were added to the group
+    int index = 1;
+    for (int i = 0; i < COUNTERS_COUNT && index <= (int) buffer[0]; i++)
+    {
+        if (counters->fds[i] >= 0)
+            values[i] = buffer[index++];
+    }
+}
+
+static void RunTransform(const struct Transform *transform, struct Counters *counters)
+{
+    union Vec512 state = INIT_VECTOR_256;
+    uint64_t     before[COUNTERS_COUNT], after[COUNTERS_COUNT];
+
+    // warm up caches and branch predictors
+    for (unsigned long long i = 0; i < g_opt_iterations / 10 + 1; i++)
+        transform->call(&state);
+
+    if (counters->available)
+    {
+        ioctl(counters->fds[COUNTER_CYCLES], PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+        ioctl(counters->fds[COUNTER_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    Counters_Read(counters, before);
+    const uint64_t start = Bench_NowNs();
+
+    for (unsigned long long i = 0; i < g_opt_iterations; i++)
+        transform->call(&state);
+
+    const uint64_t elapsed = Bench_NowNs() - start;
+    Counters_Read(counters, after);
+
+    if (counters->available)
+        ioctl(counters->fds[COUNTER_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    const double calls = (double) g_opt_iterations;
+    const double cycles = (after[COUNTER_CYCLES] - before[COUNTER_CYCLES]) / calls;
+    const double instructions =
+        (after[COUNTER_INSTRUCTIONS] - before[COUNTER_INSTRUCTIONS]) / calls;
+
+    printf("%-20s %10.1f", transform->name, elapsed / calls);
+
+    if (counters->available)
+    {
+        printf(" %10.1f %10.1f %6.2f %10.3f %10.3f", cycles, instructions,
+               cycles > 0.0 ? instructions / cycles : 0.0,
+               (after[COUNTER_L1D_MISSES]    - before[COUNTER_L1D_MISSES])    / calls,
+               (after[COUNTER_BRANCH_MISSES] - before[COUNTER_BRANCH_MISSES]) / calls);
+    }
+
+    // keeps the chain of calls alive
+    printf("%s\n", state.bytes[0] == 0xFF && state.bytes[1] == 0xFF ? " " : "");
+}
+
+int main(int argc, char **argv)
+{
+    struct Counters counters;
+
+    struct argp argp = { options, parse_opt, 0,
+                         "Per-transformation microbenchmarks of " MICROBENCH_NAME
+                         " implementation.",
+                         0, 0, 0 };
+    error_t argp_error = argp_parse(&argp, argc, argv, 0, 0, 0);
+    if (argp_error != 0 || g_opt_iterations == 0)
+    {
+        exit(EINVAL);
+    }
+
+#if defined(MICROBENCH_AVX2)
+    if (!__builtin_cpu_supports("avx2"))
+    {
+        log_err("This CPU does not support AVX2");
+        exit(ENOTSUP);
+    }
+#endif
+
+    Counters_Open(&counters);
+
+    printf("%s implementation, %llu calls per transformation\n",
+           MICROBENCH_NAME, g_opt_iterations);
+    printf("%-20s %10s", "transformation", "ns/call");
+    if (counters.available)
+    {
+        printf(" %10s %10s %6s %10s %10s", "cycles", "instr", "IPC",
+               "L1D miss", "br miss");
+    }
+    printf("\n");
+
+    const int count = sizeof(g_transforms) / sizeof(g_transforms[0]);
+    for (int i = 0; i < count; i++)
+    {
+        if (g_opt_filter && !strstr(g_transforms[i].name, g_opt_filter))
+            continue;
+
+        RunTransform(&g_transforms[i], &counters);
+    }
+
+    Counters_Close(&counters);
+    return 0;
+}
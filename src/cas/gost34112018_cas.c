@@ -0,0 +1,653 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    Content-addressable store, see include/gost34112018_cas.h.
+
+    STORE/objects/XX/ holds the blobs whose digests start with the byte XX, so no
+    directory grows past 1/256 of the store, and a lookup is a single openat() relative
+    to the descriptor of objects/. A blob is written to STORE/tmp/ (on the same file
+    system), hashed on the way, synced, and renamed to its name: readers never see a
+    partial blob. Files left in tmp/ by an interrupted put can be removed at any time
+    when no put is running.
+ */
+
+#define _GNU_SOURCE
+
+#include "gost34112018_cas.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "stdbool.h"
+#include "stdint.h"
+#include "errno.h"
+#include "stdatomic.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "poll.h"
+#include "dirent.h"
+#include "sys/stat.h"
+
+enum
+{
+    DIGEST_SIZE    = GOST34112018_Hash256,
+    HEX_SIZE       = 2 * DIGEST_SIZE,
+    OBJECT_SIZE    = HEX_SIZE + 2,      // 'XX/YYYY...' with the NUL
+    BLOCK_SIZE     = 64,
+    BUFFER_SIZE    = 1 << 20,           // a multiple of BLOCK_SIZE
+    MAX_WORKERS    = 256,
+    FSCK_DEPTH     = 4,                 // objects open at a time per fsck worker
+    FSCK_POLL      = 64,                // completed jobs taken at a time
+    TEMP_ATTEMPTS  = 100,
+};
+
+struct GOST34112018_Cas
+{
+    char *root;
+    int   objects;                      // descriptor of STORE/objects
+    int   tmp;                          // descriptor of STORE/tmp
+};
+
+struct FsckObject
+{
+    char name[OBJECT_SIZE];
+};
+
+struct FsckJob
+{
+    struct GOST34112018_Job job;
+    size_t                  index;          // in Fsck.objects
+};
+
+struct Fsck
+{
+    struct GOST34112018_Cas       *cas;
+    struct FsckObject             *objects;
+    size_t                         count;
+    long long                      bad;
+    GOST34112018_CasFsckCallback_t callback;
+    void                          *user_data;
+};
+
+static _Atomic unsigned int g_temp_counter;
+
+static void ObjectName(const unsigned char *digest, char *name)
+{
+    static const char digits[] = "0123456789abcdef";
+    char             *out      = name;
+
+    for (int i = 0; i < DIGEST_SIZE; i++)
+    {
+        *out++ = digits[digest[i] >> 4];
+        *out++ = digits[digest[i] & 0x0f];
+        if (i == 0)
+            *out++ = '/';
+    }
+    *out = '\0';
+}
+
+static int HexDigit(const char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/**
+    Parses the name of an object, 'XX/YYYY...'.
+ */
+static bool ParseObjectName(const char *name, unsigned char *digest)
+{
+    if (strlen(name) != OBJECT_SIZE - 1 || name[2] != '/')
+        return false;
+
+    for (int i = 0, j = 0; i < DIGEST_SIZE; i++, j += 2)
+    {
+        if (j == 2)
+            j++;
+
+        const int high = HexDigit(name[j]);
+        const int low  = HexDigit(name[j + 1]);
+        if (high < 0 || low < 0)
+            return false;
+
+        digest[i] = (unsigned char) (high << 4 | low);
+    }
+
+    return true;
+}
+
+static int OpenDirectory(const int at, const char *path, const bool create)
+{
+    if (create && mkdirat(at, path, 0755) != 0 && errno != EEXIST)
+        return -1;
+
+    return openat(at, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+static int WriteAll(const int fd, const unsigned char *data, size_t size)
+{
+    while (size)
+    {
+        const ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return errno;
+
+        data += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+/**
+    Hashes 'size' bytes; all but the last call for a blob pass a multiple of BLOCK_SIZE.
+ */
+static void HashData(struct GOST34112018_Context *ctx, const unsigned char *data,
+                     const size_t size)
+{
+    size_t i = 0;
+
+    for (; i + BLOCK_SIZE <= size; i += BLOCK_SIZE)
+        GOST34112018_HashBlock(data + i, BLOCK_SIZE, ctx);
+
+    if (i < size)
+        GOST34112018_HashBlock(data + i, size - i, ctx);
+}
+
+static int CreateTemporary(struct GOST34112018_Cas *cas, char *name, const size_t size)
+{
+    for (int attempt = 0; attempt < TEMP_ATTEMPTS; attempt++)
+    {
+        snprintf(name, size, "put.%d.%u", (int) getpid(),
+                 atomic_fetch_add_explicit(&g_temp_counter, 1, memory_order_relaxed));
+
+        const int fd = openat(cas->tmp, name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0444);
+        if (fd >= 0 || errno != EEXIST)
+            return fd;
+    }
+
+    errno = EEXIST;
+    return -1;
+}
+
+/**
+    Syncs the temporary file and renames it to the name of its digest. If the blob is
+    already there, the temporary file is removed instead.
+ */
+static int Publish(struct GOST34112018_Cas *cas, const int fd, const char *temp,
+                   const unsigned char *digest)
+{
+    char object[OBJECT_SIZE];
+    char shard[3];
+    int  rc = 0;
+
+    ObjectName(digest, object);
+    memcpy(shard, object, 2);
+    shard[2] = '\0';
+
+    if (faccessat(cas->objects, object, F_OK, 0) == 0)
+    {
+        close(fd);
+        unlinkat(cas->tmp, temp, 0);
+        return 0;
+    }
+
+    if (fsync(fd) != 0)
+        rc = errno;
+    if (close(fd) != 0 && rc == 0)
+        rc = errno;
+
+    const int directory = rc == 0 ? OpenDirectory(cas->objects, shard, true) : -1;
+    if (rc == 0 && directory < 0)
+        rc = errno;
+
+    if (rc == 0 && renameat(cas->tmp, temp, cas->objects, object) != 0)
+        rc = errno;
+
+    // the rename itself is only durable once the directory is synced
+    if (rc == 0 && fsync(directory) != 0)
+        rc = errno;
+
+    if (directory >= 0)
+        close(directory);
+
+    if (rc != 0)
+        unlinkat(cas->tmp, temp, 0);
+
+    return rc;
+}
+
+struct GOST34112018_Cas *GOST34112018_CasOpen(const char *root, const int create)
+{
+    struct GOST34112018_Cas *cas = calloc(1, sizeof(*cas));
+    int                      rc  = 0;
+
+    if (!cas)
+        return NULL;
+
+    cas->objects = -1;
+    cas->tmp     = -1;
+    cas->root    = strdup(root);
+
+    const int directory = OpenDirectory(AT_FDCWD, root, create);
+    if (!cas->root || directory < 0)
+    {
+        rc = cas->root ? errno : ENOMEM;
+        goto error;
+    }
+
+    cas->objects = OpenDirectory(directory, "objects", create);
+    cas->tmp     = OpenDirectory(directory, "tmp", create);
+    if (cas->objects < 0 || cas->tmp < 0)
+        rc = errno;
+
+    close(directory);
+
+    if (rc == 0)
+        return cas;
+
+error:
+    GOST34112018_CasClose(cas);
+    errno = rc;
+    return NULL;
+}
+
+void GOST34112018_CasClose(struct GOST34112018_Cas *cas)
+{
+    if (!cas)
+        return;
+
+    if (cas->objects >= 0)
+        close(cas->objects);
+    if (cas->tmp >= 0)
+        close(cas->tmp);
+
+    free(cas->root);
+    free(cas);
+}
+
+int GOST34112018_CasPutFd(struct GOST34112018_Cas *cas, const int fd, unsigned char *digest_out)
+{
+    struct GOST34112018_Context ctx;
+    char                        temp[64];
+    size_t                      filled = 0;
+    bool                        eof    = false;
+    int                         rc     = 0;
+
+    unsigned char *buffer = malloc(BUFFER_SIZE);
+    if (!buffer)
+        return ENOMEM;
+
+    const int out = CreateTemporary(cas, temp, sizeof(temp));
+    if (out < 0)
+    {
+        free(buffer);
+        return errno;
+    }
+
+    GOST34112018_InitContext(&ctx, GOST34112018_Hash256);
+
+    while (rc == 0 && !eof)
+    {
+        const ssize_t n = read(fd, buffer + filled, BUFFER_SIZE - filled);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            rc = errno;
+            break;
+        }
+
+        filled += n;
+        eof     = n == 0;
+        if (!eof && filled < BUFFER_SIZE)
+            continue;
+
+        // the buffer is hashed while it is still in the cache, right before the write
+        HashData(&ctx, buffer, filled);
+        rc     = WriteAll(out, buffer, filled);
+        filled = 0;
+    }
+
+    free(buffer);
+
+    if (rc != 0)
+    {
+        close(out);
+        unlinkat(cas->tmp, temp, 0);
+        return rc;
+    }
+
+    GOST34112018_HashBlockEnd(&ctx);
+    GOST34112018_GetHashFromContext(&ctx, digest_out);
+
+    return Publish(cas, out, temp, digest_out);
+}
+
+int GOST34112018_CasPut(struct GOST34112018_Cas *cas,
+                        const unsigned char     *data,
+                        const size_t             size,
+                        unsigned char           *digest_out)
+{
+    char temp[64];
+
+    GOST34112018_HashBytes(data, size, GOST34112018_Hash256, digest_out);
+
+    // nothing is written for a blob which is already there
+    if (GOST34112018_CasHas(cas, digest_out))
+        return 0;
+
+    const int out = CreateTemporary(cas, temp, sizeof(temp));
+    if (out < 0)
+        return errno;
+
+    const int rc = WriteAll(out, data, size);
+    if (rc != 0)
+    {
+        close(out);
+        unlinkat(cas->tmp, temp, 0);
+        return rc;
+    }
+
+    return Publish(cas, out, temp, digest_out);
+}
+
+int GOST34112018_CasGet(struct GOST34112018_Cas *cas, const unsigned char *digest)
+{
+    char object[OBJECT_SIZE];
+
+    ObjectName(digest, object);
+    return openat(cas->objects, object, O_RDONLY | O_CLOEXEC);
+}
+
+int GOST34112018_CasHas(struct GOST34112018_Cas *cas, const unsigned char *digest)
+{
+    char object[OBJECT_SIZE];
+
+    ObjectName(digest, object);
+    return faccessat(cas->objects, object, F_OK, 0) == 0;
+}
+
+int GOST34112018_CasPath(const struct GOST34112018_Cas *cas,
+                         const unsigned char           *digest,
+                         char                          *path_out,
+                         const size_t                   path_size)
+{
+    char object[OBJECT_SIZE];
+
+    ObjectName(digest, object);
+
+    const int length = snprintf(path_out, path_size, "%s/objects/%s", cas->root, object);
+    return length < 0 || (size_t) length >= path_size ? ENAMETOOLONG : 0;
+}
+
+static void Report(struct Fsck *fsck, const char *name, const int status)
+{
+    // the longest name is a shard, a slash and a file name of up to 255 bytes
+    char object[sizeof("objects/") + OBJECT_SIZE + 256];
+
+    fsck->bad++;
+
+    if (!fsck->callback)
+        return;
+
+    snprintf(object, sizeof(object), "objects/%s", name);
+    fsck->callback(object, status, fsck->user_data);
+}
+
+/**
+    Opens the object and submits it to the engine.
+    @return     true if the job is submitted, false if the object could not be opened.
+ */
+static bool FsckSubmit(struct Fsck *fsck, struct GOST34112018_Engine *engine,
+                       struct FsckJob *job, const size_t index)
+{
+    const char *name = fsck->objects[index].name;
+
+    const int fd = openat(fsck->cas->objects, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        // removed by someone else since it was listed: not damaged
+        if (errno != ENOENT)
+            Report(fsck, name, errno);
+        return false;
+    }
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    memset(&job->job, 0, sizeof(job->job));
+    job->job.fd        = fd;
+    job->job.hash_size = GOST34112018_Hash256;
+    job->job.user_data = job;
+    job->index         = index;
+
+    const int rc = GOST34112018_EngineSubmit(engine, &job->job);
+    if (rc != 0)
+    {
+        close(fd);
+        Report(fsck, name, rc);
+        return false;
+    }
+
+    return true;
+}
+
+static void FsckComplete(struct Fsck *fsck, struct FsckJob *job)
+{
+    const char   *name = fsck->objects[job->index].name;
+    unsigned char expected[DIGEST_SIZE];
+    int           rc   = job->job.status;
+
+    close(job->job.fd);
+
+    // the name has been checked when the objects were listed
+    ParseObjectName(name, expected);
+    if (rc == 0 && memcmp(job->job.hash, expected, DIGEST_SIZE) != 0)
+        rc = EBADMSG;
+
+    if (rc != 0)
+        Report(fsck, name, rc);
+}
+
+/**
+    Hashes the listed objects with an engine of 'workers' threads. The calling thread
+    keeps FSCK_DEPTH objects per worker open, and reports the results itself, so
+    the callback is never called concurrently.
+ */
+static int FsckObjects(struct Fsck *fsck, const int workers)
+{
+    struct GOST34112018_Job *completed[FSCK_POLL];
+    struct pollfd            pfd     = { .fd = -1, .events = POLLIN };
+    size_t                   next    = 0;
+    int                      pending = 0;
+    int                      rc      = 0;
+
+    struct GOST34112018_Engine *engine =
+        GOST34112018_EngineCreate(workers, GOST34112018_EngineUseEventFd);
+    if (!engine)
+        return errno;
+
+    const int        capacity = workers * FSCK_DEPTH;
+    struct FsckJob  *jobs     = malloc(capacity * sizeof(*jobs));
+    struct FsckJob **idle     = malloc(capacity * sizeof(*idle));
+    int              idles    = 0;
+
+    if (!jobs || !idle)
+    {
+        rc = ENOMEM;
+        goto out;
+    }
+
+    for (; idles < capacity; idles++)
+        idle[idles] = &jobs[idles];
+
+    pfd.fd = GOST34112018_EngineEventFd(engine);
+
+    for (;;)
+    {
+        for (; next < fsck->count && idles > 0; next++)
+        {
+            if (FsckSubmit(fsck, engine, idle[idles - 1], next))
+            {
+                idles--;
+                pending++;
+            }
+        }
+
+        if (pending == 0)
+            break;
+
+        // a failed poll only costs a round of the loop, the jobs are polled anyway
+        poll(&pfd, 1, -1);
+
+        const int count = GOST34112018_EnginePoll(engine, completed, FSCK_POLL);
+        for (int i = 0; i < count; i++)
+        {
+            struct FsckJob *job = completed[i]->user_data;
+
+            FsckComplete(fsck, job);
+            idle[idles++] = job;
+        }
+        pending -= count;
+    }
+
+out:
+    GOST34112018_EngineDestroy(engine);
+    free(jobs);
+    free(idle);
+    return rc;
+}
+
+/**
+    Lists the objects of one shard. Files which are not named after a digest are
+    reported right away.
+ */
+static int ListShard(struct Fsck *fsck, const char *shard, size_t *capacity)
+{
+    const int at = openat(fsck->cas->objects, shard, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR      *dir = at >= 0 ? fdopendir(at) : NULL;
+
+    if (!dir)
+    {
+        if (at >= 0)
+            close(at);
+        return errno;
+    }
+
+    for (struct dirent *item; (item = readdir(dir));)
+    {
+        struct FsckObject object;
+        unsigned char     digest[DIGEST_SIZE];
+
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0)
+            continue;
+
+        const int length = snprintf(object.name, sizeof(object.name), "%s/%s", shard,
+                                    item->d_name);
+        if (length >= (int) sizeof(object.name) || !ParseObjectName(object.name, digest))
+        {
+            char name[sizeof(object.name) + 256];
+            snprintf(name, sizeof(name), "%s/%s", shard, item->d_name);
+            Report(fsck, name, EINVAL);
+            continue;
+        }
+
+        if (fsck->count == *capacity)
+        {
+            const size_t       grown   = *capacity ? 2 * *capacity : 4096;
+            struct FsckObject *objects = realloc(fsck->objects, grown * sizeof(*objects));
+            if (!objects)
+            {
+                closedir(dir);
+                return ENOMEM;
+            }
+
+            fsck->objects = objects;
+            *capacity     = grown;
+        }
+
+        fsck->objects[fsck->count++] = object;
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+long long GOST34112018_CasFsck(struct GOST34112018_Cas              *cas,
+                               const int                             workers,
+                               const GOST34112018_CasFsckCallback_t  callback,
+                               void                                 *user_data,
+                               unsigned long long                   *checked_out)
+{
+    struct Fsck fsck     = { .cas = cas, .callback = callback, .user_data = user_data };
+    size_t      capacity = 0;
+    int         rc       = 0;
+
+    if (workers < 1)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const int at  = dup(cas->objects);
+    DIR      *dir = at >= 0 ? fdopendir(at) : NULL;
+    if (!dir)
+    {
+        rc = errno;
+        if (at >= 0)
+            close(at);
+        goto out;
+    }
+
+    // fdopendir shares the position with objects/, start from its beginning
+    rewinddir(dir);
+
+    for (struct dirent *item; rc == 0 && (item = readdir(dir));)
+    {
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0)
+            continue;
+
+        if (strlen(item->d_name) != 2 || HexDigit(item->d_name[0]) < 0 ||
+            HexDigit(item->d_name[1]) < 0)
+        {
+            Report(&fsck, item->d_name, EINVAL);
+            continue;
+        }
+
+        rc = ListShard(&fsck, item->d_name, &capacity);
+    }
+
+    closedir(dir);
+
+    if (rc != 0)
+        goto out;
+
+    // no more workers than objects
+    size_t threads = workers < MAX_WORKERS ? workers : MAX_WORKERS;
+    if (threads > fsck.count)
+        threads = fsck.count;
+
+    if (threads > 0)
+        rc = FsckObjects(&fsck, (int) threads);
+    if (rc != 0)
+        goto out;
+
+    if (checked_out)
+        *checked_out = fsck.count;
+
+out:
+    free(fsck.objects);
+
+    if (rc != 0)
+    {
+        errno = rc;
+        return -1;
+    }
+
+    return fsck.bad;
+}
@@ -0,0 +1,255 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+#define _GNU_SOURCE
+
+#include "gost34112018_client.h"
+#include "gost34112018_protocol.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "sys/mman.h"
+#include "sys/socket.h"
+#include "sys/un.h"
+
+struct GOST34112018_Client
+{
+    int            socket;
+    unsigned char *shared;
+    size_t         shared_size;
+    uint64_t       next_id;
+};
+
+/**
+    Sends a request, with an optional file descriptor in SCM_RIGHTS.
+ */
+static int SendRequest(struct GOST34112018_Client *client, const struct DaemonRequest *request,
+                       const int fd)
+{
+    union
+    {
+        char           buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    struct iovec  iov = { (void *) request, sizeof(*request) };
+    struct msghdr msg = { 0 };
+
+    msg.msg_iov    = &iov;
+    msg.msg_iovlen = 1;
+
+    if (fd >= 0)
+    {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control    = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    while (sendmsg(client->socket, &msg, MSG_NOSIGNAL) < 0)
+    {
+        if (errno != EINTR)
+            return errno;
+    }
+
+    return 0;
+}
+
+/**
+    Sends a request and waits for its reply.
+ */
+static int Call(struct GOST34112018_Client *client, struct DaemonRequest *request, const int fd,
+                unsigned char *hash_out)
+{
+    struct DaemonReply reply;
+    ssize_t            received;
+
+    request->id = client->next_id++;
+
+    int rc = SendRequest(client, request, fd);
+    if (rc != 0)
+        return rc;
+
+    do
+    {
+        received = recv(client->socket, &reply, sizeof(reply), 0);
+    } while (received < 0 && errno == EINTR);
+
+    if (received < 0)
+        return errno;
+
+    if (received != sizeof(reply) || reply.id != request->id)
+        return EPROTO;
+
+    if (reply.status != 0)
+        return reply.status;
+
+    if (hash_out)
+        memcpy(hash_out, reply.hash, request->hash_size);
+
+    return 0;
+}
+
+struct GOST34112018_Client *GOST34112018_ClientConnect(const char  *socket_path,
+                                                       const size_t shared_size)
+{
+    struct sockaddr_un          address = { 0 };
+    struct GOST34112018_Client *client  = calloc(1, sizeof(*client));
+    int                         memfd   = -1;
+    int                         rc      = 0;
+
+    if (!client)
+        return NULL;
+
+    client->socket = -1;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        rc = ENAMETOOLONG;
+        goto error;
+    }
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    client->socket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (client->socket < 0 ||
+        connect(client->socket, (struct sockaddr *) &address, sizeof(address)) != 0)
+    {
+        rc = errno;
+        goto error;
+    }
+
+    // the daemon maps the buffer, so its size is sealed: a shrunk buffer would fault there
+    memfd = memfd_create("gost34112018_client", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd < 0 || ftruncate(memfd, shared_size) != 0 ||
+        fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0)
+    {
+        rc = errno;
+        goto error;
+    }
+
+    if (shared_size)
+    {
+        client->shared = mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+        if (client->shared == MAP_FAILED)
+        {
+            client->shared = NULL;
+            rc = errno;
+            goto error;
+        }
+    }
+    client->shared_size = shared_size;
+
+    struct DaemonRequest hello = { .type = DAEMON_HELLO, .length = shared_size };
+    rc = Call(client, &hello, memfd, NULL);
+    if (rc != 0)
+        goto error;
+
+    close(memfd);
+    return client;
+
+error:
+    if (memfd >= 0)
+        close(memfd);
+    GOST34112018_ClientClose(client);
+    errno = rc;
+    return NULL;
+}
+
+void GOST34112018_ClientClose(struct GOST34112018_Client *client)
+{
+    if (!client)
+        return;
+
+    if (client->shared)
+        munmap(client->shared, client->shared_size);
+
+    if (client->socket >= 0)
+        close(client->socket);
+
+    free(client);
+}
+
+unsigned char *GOST34112018_ClientBuffer(struct GOST34112018_Client *client, size_t *size)
+{
+    *size = client->shared_size;
+    return client->shared;
+}
+
+int GOST34112018_ClientHashShared(struct GOST34112018_Client   *client,
+                                  const size_t                  offset,
+                                  const size_t                  length,
+                                  const GOST34112018_HashSize_t hash_size,
+                                  unsigned char                *hash_out)
+{
+    struct DaemonRequest request = {
+        .type      = DAEMON_HASH_SHARED,
+        .hash_size = hash_size,
+        .offset    = offset,
+        .length    = length,
+    };
+
+    if (offset > client->shared_size || length > client->shared_size - offset)
+        return EINVAL;
+
+    return Call(client, &request, -1, hash_out);
+}
+
+int GOST34112018_ClientHash(struct GOST34112018_Client   *client,
+                            const unsigned char          *message,
+                            const size_t                  message_size,
+                            const GOST34112018_HashSize_t hash_size,
+                            unsigned char                *hash_out)
+{
+    if (message_size <= client->shared_size)
+    {
+        if (message_size)
+            memcpy(client->shared, message, message_size);
+        return GOST34112018_ClientHashShared(client, 0, message_size, hash_size, hash_out);
+    }
+
+    // does not fit into the shared buffer, a memfd is passed instead
+    int fd = memfd_create("gost34112018_message", MFD_CLOEXEC);
+    if (fd < 0)
+        return errno;
+
+    int rc = 0;
+    for (size_t written = 0; rc == 0 && written < message_size;)
+    {
+        const ssize_t n = write(fd, message + written, message_size - written);
+        if (n < 0 && errno != EINTR)
+            rc = errno;
+        else if (n > 0)
+            written += n;
+    }
+
+    if (rc == 0 && lseek(fd, 0, SEEK_SET) != 0)
+        rc = errno;
+
+    if (rc == 0)
+        rc = GOST34112018_ClientHashFd(client, fd, hash_size, hash_out);
+
+    close(fd);
+    return rc;
+}
+
+int GOST34112018_ClientHashFd(struct GOST34112018_Client   *client,
+                              const int                     fd,
+                              const GOST34112018_HashSize_t hash_size,
+                              unsigned char                *hash_out)
+{
+    struct DaemonRequest request = {
+        .type      = DAEMON_HASH_FD,
+        .hash_size = hash_size,
+    };
+
+    return Call(client, &request, fd, hash_out);
+}
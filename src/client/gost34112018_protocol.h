@@ -0,0 +1,49 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    Wire protocol between gost34112018_cli --daemon and the client library.
+
+    The transport is a SOCK_SEQPACKET Unix domain socket, so every request and every
+    reply is exactly one message. A connection starts with DAEMON_HELLO, which passes
+    a memfd (SCM_RIGHTS) with the shared buffer of the client; the daemon maps it
+    read-only. The memfd has to be sealed with F_SEAL_SHRINK, otherwise the request fails
+    with EPERM: a buffer shrunk under the mapping would crash the daemon. After that
+    DAEMON_HASH_SHARED requests refer to bytes of the shared buffer by offset and length,
+    and DAEMON_HASH_FD requests pass a descriptor of a regular file (EINVAL otherwise),
+    which is hashed from its current offset to its end. Replies carry the id of the
+    request, so requests of one connection can be pipelined. A request of an unknown
+    type, a second DAEMON_HELLO, a DAEMON_HASH_SHARED with a descriptor or another
+    request without one fails with EPROTO.
+ */
+
+#ifndef __GOST34112018_PROTOCOL_H__
+#define __GOST34112018_PROTOCOL_H__
+
+#include "stdint.h"
+
+typedef enum
+{
+    DAEMON_HELLO       = 1, // memfd of the shared buffer in SCM_RIGHTS
+    DAEMON_HASH_SHARED = 2, // bytes [offset, offset + length) of the shared buffer
+    DAEMON_HASH_FD     = 3, // file descriptor in SCM_RIGHTS
+} DaemonRequest_t;
+
+struct DaemonRequest
+{
+    uint32_t type;
+    uint32_t hash_size;     // 32 or 64
+    uint64_t id;
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct DaemonReply
+{
+    uint64_t id;
+    int32_t  status;        // 0 or errno
+    uint32_t hash_size;
+    uint8_t  hash[64];
+};
+
+#endif // __GOST34112018_PROTOCOL_H__
@@ -109,10 +109,5 @@ void DebugPrintVec(const union Vec512 *vec)
 
     printf("\n");
     fflush(stdout);
-}
-#else
-void DebugPrintVec(const union Vec512 *out)
-{
-
 }
 #endif // DEBUG
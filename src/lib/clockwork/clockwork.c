@@ -2,21 +2,214 @@
 // SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
 
 #include "clockwork.h"
+#include "stdlib.h"
+#include "pthread.h"
 
-void CLKW_TimingMetaData_Register(struct CLKW_TimingMetaDataListHead *llist, 
-                                  struct CLKW_TimingMetaData         *mdata)
+/*
+    Counters of one thread. Only the owning thread writes 'calls' and 'ticks' (relaxed
+    atomics, which are plain loads and stores on x86), other threads only read them.
+    When a thread exits its block is released and reused by the next new thread, so
+    the number of blocks is bounded by the peak number of threads. Blocks are never
+    freed.
+ */
+struct CLKW_ThreadBlock
 {
-    // it's a first element in the list
-    if (!llist->first && !llist->last)
+    _Atomic uint64_t                 calls[CLKW_MAX_SITES];
+    _Atomic uint64_t                 ticks[CLKW_MAX_SITES];
+    _Atomic uint64_t                 epoch;
+    _Atomic int                      in_use;
+    struct CLKW_ThreadBlock         *next;
+};
+
+static struct CLKW_Site *_Atomic        g_sites[CLKW_MAX_SITES];
+static _Atomic int                      g_sites_count = 1;
+static struct CLKW_ThreadBlock *_Atomic g_blocks;
+static _Atomic uint64_t                 g_epoch;
+
+static pthread_once_t                   g_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t                    g_key;
+static _Thread_local struct CLKW_ThreadBlock *tls_block;
+
+static uint64_t                         g_start_ticks;
+static struct timespec                  g_start_time;
+
+__attribute__((constructor))
+static
+void StartClock(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &g_start_time);
+    g_start_ticks = CLKW_Now();
+}
+
+static
+void ReleaseBlock(void *block)
+{
+    atomic_store_explicit(&((struct CLKW_ThreadBlock *) block)->in_use, 0,
+                          memory_order_release);
+}
+
+static
+void CreateKey(void)
+{
+    pthread_key_create(&g_key, ReleaseBlock);
+}
+
+static
+struct CLKW_ThreadBlock *AcquireBlock(void)
+{
+    struct CLKW_ThreadBlock *block = atomic_load_explicit(&g_blocks, memory_order_acquire);
+
+    // reuse a block of a finished thread
+    for (; block; block = block->next)
     {
-        llist->first = mdata;
-        llist->last  = mdata;
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&block->in_use, &expected, 1))
+            break;
     }
-    else
+
+    if (!block)
     {
-        llist->last->next = mdata;
-        llist->last = llist->last->next;
+        block = calloc(1, sizeof(*block));
+        if (!block)
+            return NULL;
+
+        atomic_init(&block->in_use, 1);
+        block->next = atomic_load_explicit(&g_blocks, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&g_blocks, &block->next, block,
+                                                      memory_order_release,
+                                                      memory_order_relaxed))
+            ;
     }
 
-    mdata->is_registered = 1;
-}
\ No newline at end of file
+    pthread_once(&g_key_once, CreateKey);
+    pthread_setspecific(g_key, block);
+    tls_block = block;
+
+    return block;
+}
+
+static
+int RegisterSite(struct CLKW_Site *site)
+{
+    int index = atomic_fetch_add(&g_sites_count, 1);
+    if (index >= CLKW_MAX_SITES)
+        index = -1;
+
+    // another thread could have registered the site in the meantime, then the
+    // reserved index is left unused
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&site->index, &expected, index))
+        return expected;
+
+    if (index > 0)
+        atomic_store_explicit(&g_sites[index], site, memory_order_release);
+
+    return index;
+}
+
+void CLKW_Record(struct CLKW_Site *site, const uint64_t ticks)
+{
+    struct CLKW_ThreadBlock *block = tls_block ? tls_block : AcquireBlock();
+    if (!block)
+        return;
+
+    const uint64_t epoch = atomic_load_explicit(&g_epoch, memory_order_relaxed);
+    if (atomic_load_explicit(&block->epoch, memory_order_relaxed) != epoch)
+    {
+        for (int i = 0; i < CLKW_MAX_SITES; i++)
+        {
+            atomic_store_explicit(&block->calls[i], 0, memory_order_relaxed);
+            atomic_store_explicit(&block->ticks[i], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&block->epoch, epoch, memory_order_release);
+    }
+
+    int index = atomic_load_explicit(&site->index, memory_order_relaxed);
+    if (index == 0)
+        index = RegisterSite(site);
+    if (index < 0)
+        return;
+
+    // single writer, no read-modify-write instructions are needed
+    atomic_store_explicit(&block->calls[index],
+        atomic_load_explicit(&block->calls[index], memory_order_relaxed) + 1,
+        memory_order_relaxed);
+    atomic_store_explicit(&block->ticks[index],
+        atomic_load_explicit(&block->ticks[index], memory_order_relaxed) + ticks,
+        memory_order_relaxed);
+}
+
+/**
+    Nanoseconds per tick, measured against CLOCK_MONOTONIC since the library was
+    loaded.
+ */
+static
+double NanosecondsPerTick(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    struct timespec now;
+    uint64_t        elapsed_ns;
+    uint64_t        elapsed_ticks;
+
+    // the longer the interval, the more accurate the ratio, 1 ms is enough
+    do
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed_ticks = CLKW_Now() - g_start_ticks;
+        elapsed_ns    = (uint64_t) (now.tv_sec - g_start_time.tv_sec) * 1000000000ull
+                      + now.tv_nsec - g_start_time.tv_nsec;
+    } while (elapsed_ns < 1000000);
+
+    return (double) elapsed_ns / (double) elapsed_ticks;
+#else
+    return 1.0;
+#endif
+}
+
+int CLKW_Snapshot(struct CLKW_Entry *entries, const int max_entries)
+{
+    uint64_t calls[CLKW_MAX_SITES] = { 0 };
+    uint64_t ticks[CLKW_MAX_SITES] = { 0 };
+
+    const uint64_t epoch = atomic_load_explicit(&g_epoch, memory_order_relaxed);
+
+    struct CLKW_ThreadBlock *block = atomic_load_explicit(&g_blocks, memory_order_acquire);
+    for (; block; block = block->next)
+    {
+        // the owner has not seen the last reset yet, its counters are stale
+        if (atomic_load_explicit(&block->epoch, memory_order_acquire) != epoch)
+            continue;
+
+        for (int i = 1; i < CLKW_MAX_SITES; i++)
+        {
+            calls[i] += atomic_load_explicit(&block->calls[i], memory_order_relaxed);
+            ticks[i] += atomic_load_explicit(&block->ticks[i], memory_order_relaxed);
+        }
+    }
+
+    const double ns_per_tick = NanosecondsPerTick();
+
+    int count = 0;
+    for (int i = 1; i < CLKW_MAX_SITES; i++)
+    {
+        struct CLKW_Site *site = atomic_load_explicit(&g_sites[i], memory_order_acquire);
+        if (!site || !calls[i])
+            continue;
+
+        if (count < max_entries)
+        {
+            entries[count].func_name   = site->func_name;
+            entries[count].calls       = calls[i];
+            entries[count].ticks       = ticks[i];
+            entries[count].nanoseconds = (uint64_t) (ticks[i] * ns_per_tick);
+        }
+        count++;
+    }
+
+    return count;
+}
+
+void CLKW_Reset(void)
+{
+    atomic_fetch_add(&g_epoch, 1);
+}
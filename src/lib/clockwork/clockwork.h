@@ -4,38 +4,84 @@
 #ifndef __CLOCKWORK_H__
 #define __CLOCKWORK_H__
 
+#include "stdint.h"
+#include "stdatomic.h"
 #include "time.h"
 
-#define CLKW_TimerStart(__timer, __md_list)                             \
-    static struct CLKW_TimingMetaData __timer##_mdata;                  \
-    if (!__timer##_mdata.is_registered)                                 \
-    {                                                                   \
-        __timer##_mdata.clk       = 0;                                  \
-        __timer##_mdata.func_name = __func__;                           \
-        __timer##_mdata.next      = NULL;                               \
-        CLKW_TimingMetaData_Register((__md_list), (&__timer##_mdata));  \
-    }                                                                   \
-    clock_t __timer##_start = clock();
-    
+#if defined(__x86_64__) || defined(__i386__)
+    #include "x86intrin.h"
+#endif
+
+/*
+    Every timed function owns a static CLKW_Site. On the first CLKW_TimerEnd the site
+    gets an index in the global registry (lock-free, with a compare-and-swap). The time
+    and the number of calls are accumulated in the counters of the calling thread, so
+    threads never write to the same memory. CLKW_Snapshot sums the counters of all
+    threads.
+ */
+
+#define CLKW_TimerStart(__timer)                                        \
+    static struct CLKW_Site __timer##_site = { __func__, 0 };           \
+    const uint64_t __timer##_start = CLKW_Now();
 
 #define CLKW_TimerEnd(__timer) \
-    __timer##_mdata.clk += (clock() - __timer##_start);
+    CLKW_Record(&__timer##_site, CLKW_Now() - __timer##_start);
+
+enum
+{
+    CLKW_MAX_SITES = 64, // the number of timed functions, index 0 is never used
+};
 
-struct CLKW_TimingMetaData
+struct CLKW_Site
 {
-    const char                 *func_name;
-    clock_t                     clk;
-    char                        is_registered;
-    struct CLKW_TimingMetaData *next;
+    const char  *func_name;
+    _Atomic int  index;     // 0 - not registered yet, -1 - the registry is full
 };
 
-struct CLKW_TimingMetaDataListHead
+struct CLKW_Entry
 {
-    struct CLKW_TimingMetaData *first;
-    struct CLKW_TimingMetaData *last;
+    const char *func_name;
+    uint64_t    calls;
+    uint64_t    ticks;
+    uint64_t    nanoseconds;
 };
 
-void CLKW_TimingMetaData_Register(struct CLKW_TimingMetaDataListHead *llist, 
-                                  struct CLKW_TimingMetaData         *mdata);
+/**
+    @brief      Timestamp in ticks. On x86 it is the TSC, elsewhere CLOCK_MONOTONIC
+                nanoseconds.
+ */
+static inline uint64_t CLKW_Now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+/**
+    @brief      Adds one call of the site, which took 'ticks', to the counters of the
+                calling thread.
+    @param      site - timed function.
+    @param      ticks - duration of the call.
+ */
+void CLKW_Record(struct CLKW_Site *site, const uint64_t ticks);
+
+/**
+    @brief      Sums the counters of all threads (including finished ones) since the
+                last CLKW_Reset.
+    @param      entries - output array, one entry per called site.
+    @param      max_entries - size of the output array.
+    @return     number of called sites, it can be greater than max_entries.
+ */
+int CLKW_Snapshot(struct CLKW_Entry *entries, const int max_entries);
+
+/**
+    @brief      Resets the counters of all threads. Each thread drops its counters on
+                its next timed call, and until then they are skipped by CLKW_Snapshot.
+ */
+void CLKW_Reset(void);
 
-#endif // __CLOCKWORK_H__
\ No newline at end of file
+#endif // __CLOCKWORK_H__
@@ -1,14 +1,106 @@
 // Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
 // SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
 
-#include "clockwork.h"
 #include "gost34112018.h"
 #include "gost34112018_interface.h"
 #include "gost34112018_common.h"
+#include "gost34112018_first_block_precomp.h"
 #include "gost34112018_types.h"
 #include "gost34112018_vec512.h"
+#include "errno.h"
+#include "limits.h"
+#include "stdlib.h"
+#include "string.h"
+#include "sys/mman.h"
 
-#define public_api
+/**
+    @brief      This function computes the key schedules of the first call of G_N for
+                both initialization vectors. It is not used in the computation itself,
+                rather it can be used to produce the arrays that are pasted into the
+                source code (see file 'gost34112018_first_block_precomp.h').
+    @param      out_256 - output pointer, C_SIZE + 1 keys for INIT_VECTOR_256.
+    @param      out_512 - output pointer, C_SIZE + 1 keys for INIT_VECTOR_512.
+ */
+void PRECOMPUTE_FIRST_BLOCK_KEYS(union Vec512 *out_256, union Vec512 *out_512)
+{
+    KeySchedule(&INIT_VECTOR_256, &ZERO_VECTOR_512, out_256);
+    KeySchedule(&INIT_VECTOR_512, &ZERO_VECTOR_512, out_512);
+}
+
+/**
+    @brief      Checks whether two vectors are equal.
+    @param      lhs - first operand.
+    @param      rhs - second operand.
+ */
+static
+GostBool Vec512_Equal(const union Vec512 *lhs, const union Vec512 *rhs)
+{
+    for (int i = 0; i < VEC512_QWORDS; i++)
+    {
+        if (lhs->qwords[i] != rhs->qwords[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+    @brief      Finds the precomputed key schedule for the call of G_N(h, m) with the
+                given h and N. Only the first block of the message has one: N is zero and
+                h is one of the initialization vectors.
+    @param      h - parameter 'h', according to The Standard.
+    @param      N - parameter 'N', according to The Standard.
+    @return     Array of C_SIZE + 1 keys or GostNull, if the keys have to be computed.
+ */
+static
+const union Vec512 *FirstBlockKeys(const union Vec512 *h, const union Vec512 *N)
+{
+    // N is not zero for every block but the first one, so this is where we leave
+    if (!Vec512_Equal(N, &ZERO_VECTOR_512))
+    {
+        return GostNull;
+    }
+
+    if (Vec512_Equal(h, &INIT_VECTOR_512))
+    {
+        return FIRST_BLOCK_KEYS_512;
+    }
+
+    if (Vec512_Equal(h, &INIT_VECTOR_256))
+    {
+        return FIRST_BLOCK_KEYS_256;
+    }
+
+    return GostNull;
+}
+
+/**
+    @brief      Compression of a message block: G_N(h, m) with h updated in place. The
+                first block of the message skips the key expansion.
+    @param      h - parameter 'h', according to The Standard, also an output pointer.
+    @param      m - parameter 'm', according to The Standard.
+    @param      N - parameter 'N', according to The Standard.
+ */
+static
+void CompressBlock(union Vec512 *h, const union Vec512 *m, const union Vec512 *N)
+{
+    union Vec512 r1, r2;
+    const union Vec512 *K = FirstBlockKeys(h, N);
+
+    if (K == GostNull)
+    {
+        G_N(h, m, N, h);
+        return;
+    }
+
+    TimerStart(t);
+    E_Scheduled(K, m, &r1);
+    Vec512_Xor(&r1, h, &r2);
+    Vec512_Xor(&r2, m, h);
+    TimerEnd(t);
+}
 
 /**
    @brief       This function takes message in natural ("big endian") byte order,
@@ -50,12 +142,13 @@ void Stage3(struct GOST34112018_Internal *ctx,
     union Vec512  size512;
 
     TimerStart(t);
+    Probe(stage3_start, size);
     SplitMessage512(message, size, &m);
     Uint64ToVec512(size * BYTE_SIZE, &size512);
 
     m.bytes[size] = 0x01; // padding
 
-    G_N(h, &m, N, h);
+    CompressBlock(h, &m, N);
 
     Vec512_Add(N, &size512, &r1);
     *N = r1;
@@ -65,6 +158,7 @@ void Stage3(struct GOST34112018_Internal *ctx,
 
     G_N(h, N, &ZERO_VECTOR_512, h);
     G_N(h, sigma, &ZERO_VECTOR_512, h);
+    Probe(stage3_done, size);
     TimerEnd(t);
 }
 
@@ -89,13 +183,14 @@ void Stage2(struct GOST34112018_Internal *ctx,
     union Vec512  vec512;
 
     TimerStart(t);
+    Probe(stage2_start, size);
     Uint64ToVec512(512, &vec512);
 
     while (current_size >= BLOCK_SIZE)
     {
         SplitMessage512(message, current_size, &m);
 
-        G_N(h, &m, N, h);
+        CompressBlock(h, &m, N);
 
         Vec512_Add(N, &vec512, &r1);
         *N = r1;
@@ -103,9 +198,13 @@ void Stage2(struct GOST34112018_Internal *ctx,
         Vec512_Add(sigma, &m, &r1);
         *sigma = r1;
 
+        message      += BLOCK_SIZE;
         current_size -= BLOCK_SIZE;
     }
 
+    // bytes compressed by the loop, the tail goes to the stage 3
+    Probe(stage2_done, size - current_size);
+
     Stage3(ctx, message, current_size);
     TimerEnd(t);
 }
@@ -133,7 +232,7 @@ void Stage2_SingleCycle(struct GOST34112018_Internal *ctx,
 
     Uint64ToVec512(512, &vec512);
 
-    G_N(h, &m, N, h);
+    CompressBlock(h, &m, N);
 
     Vec512_Add(N, &vec512, &r1);
     *N = r1;
@@ -174,6 +273,100 @@ void Start(struct GOST34112018_Internal   *ctx,
     Stage2(ctx, message, size);
 }
 
+/**
+    @brief      Values of N after hashing 256, 512 and 1024 bits of the message and the
+                padding block of an empty remainder (ch. 8.3 of The Standard). They are
+                used by the fixed-length paths instead of Uint64ToVec512 and Vec512_Add.
+ */
+static const union Vec512 N_256         = { .qwords = { [0] = 256  } };
+static const union Vec512 N_512         = { .qwords = { [0] = 512  } };
+static const union Vec512 N_1024        = { .qwords = { [0] = 1024 } };
+static const union Vec512 PADDING_BLOCK = { .bytes  = { [0] = 0x01 } };
+
+/**
+    @brief      Copies size bytes of the message into the vector, starting from the
+                byte with the given offset.
+    @param      message - bytes to be copied.
+    @param      size - number of bytes to copy.
+    @param      offset - index of the first byte in the vector to be written.
+    @param      out - output pointer.
+ */
+static
+void LoadBytes(const GostU8  *message,
+               const GostU64  size,
+               const GostU64  offset,
+               union Vec512  *out)
+{
+    for (GostU64 i = 0; i < size; i++)
+    {
+        out->bytes[offset + i] = message[i];
+    }
+}
+
+/**
+    @brief      Hashes a message of exactly 256 bits. Stage 2 is skipped, stage 3 is
+                performed with N = 0 and sigma = 0, so both N and sigma are constant
+                after it.
+    @param      h - current value of h, initialization vector on input.
+    @param      m - message block, already padded.
+ */
+static
+void HashHalfBlock(union Vec512 *h, const union Vec512 *m)
+{
+    TimerStart(t);
+    CompressBlock(h, m, &ZERO_VECTOR_512);
+    G_N(h, &N_256, &ZERO_VECTOR_512, h);
+    G_N(h, m, &ZERO_VECTOR_512, h);
+    TimerEnd(t);
+}
+
+/**
+    @brief      Hashes a message of exactly 512 bits: a single cycle of stage 2, then
+                stage 3 with an empty remainder.
+    @param      h - current value of h, initialization vector on input.
+    @param      m - message block.
+ */
+static
+void HashOneBlock(union Vec512 *h, const union Vec512 *m)
+{
+    union Vec512 sigma;
+
+    TimerStart(t);
+    CompressBlock(h, m, &ZERO_VECTOR_512);
+    G_N(h, &PADDING_BLOCK, &N_512, h);
+
+    Vec512_Add(m, &PADDING_BLOCK, &sigma);
+
+    G_N(h, &N_512, &ZERO_VECTOR_512, h);
+    G_N(h, &sigma, &ZERO_VECTOR_512, h);
+    TimerEnd(t);
+}
+
+/**
+    @brief      Hashes a message of exactly 1024 bits: two cycles of stage 2, then
+                stage 3 with an empty remainder.
+    @param      h - current value of h, initialization vector on input.
+    @param      m1 - first (least significant) message block.
+    @param      m2 - second message block.
+ */
+static
+void HashTwoBlocks(union Vec512 *h, const union Vec512 *m1, const union Vec512 *m2)
+{
+    union Vec512 r1, sigma;
+
+    TimerStart(t);
+    CompressBlock(h, m1, &ZERO_VECTOR_512);
+    G_N(h, m2, &N_512, h);
+    G_N(h, &PADDING_BLOCK, &N_1024, h);
+
+    Vec512_Add(m1, m2, &r1);
+    Vec512_Add(&r1, &PADDING_BLOCK, &sigma);
+
+    G_N(h, &N_1024, &ZERO_VECTOR_512, h);
+    G_N(h, &sigma, &ZERO_VECTOR_512, h);
+    TimerEnd(t);
+}
+
 public_api
 void GOST34112018_InitContext(struct GOST34112018_Context   *ctx,
                                      GOST34112018_HashSize_t hash_size)
@@ -193,6 +386,7 @@ void GOST34112018_HashBlock(const unsigned char          *data_block,
                             struct GOST34112018_Context  *ctx)
 {
     TimerStart(t);
+    Probe(hash_block_entry, data_block_size, ctx->hash_size);
     if (data_block_size < BLOCK_SIZE)
     {
         Stage3((struct GOST34112018_Internal *) ctx, data_block, data_block_size);
@@ -203,26 +397,19 @@ void GOST34112018_HashBlock(const unsigned char          *data_block,
     }
 
     ctx->prev_block_size = data_block_size;
+    Probe(hash_block_return, data_block_size, ctx->hash_size);
     TimerEnd(t);
 }
 
 public_api
 void GOST34112018_HashBlockEnd(struct GOST34112018_Context *ctx)
 {
+    Probe(hash_block_end_entry, ctx->hash_size);
     if (ctx->prev_block_size == BLOCK_SIZE)
     {
         GOST34112018_HashBlock(GostNull, 0, ctx);
     }
-
-#ifdef __ENABLE_TIMING__
-    struct CLKW_TimingMetaData *meta = g_timing_metadata_list.first;
-    while(meta)
-    {
-        printf("[TIMING] %s: %f secs.\n", meta->func_name, ((double) meta->clk) / CLOCKS_PER_SEC);
-        total_secs += ((double) meta->clk) / CLOCKS_PER_SEC;
-        meta = meta->next;
-    }
-#endif
+    Probe(hash_block_end_return, ctx->hash_size);
 }
 
 public_api
@@ -243,9 +430,638 @@ void GOST34112018_HashBytes(const unsigned char          *message,
                             unsigned char                *hash_out)
 {
     struct GOST34112018_Context ctx;
+
+    Probe(hash_bytes_entry, message_size, hash_size);
     GOST34112018_InitContext(&ctx, hash_size);
 
     Start((struct GOST34112018_Internal *) &ctx, message, message_size);
 
     GOST34112018_GetHashFromContext(&ctx, hash_out);
+    Probe(hash_bytes_return, message_size, hash_size);
+}
+
+public_api
+void GOST34112018_HashBytes32(const unsigned char          *message,
+                              const GOST34112018_HashSize_t hash_size,
+                              unsigned char                *hash_out)
+{
+    struct GOST34112018_Context ctx;
+    union  Vec512               m = ZERO_VECTOR_512;
+
+    Probe(hash_fixed_entry, 32, hash_size);
+    GOST34112018_InitContext(&ctx, hash_size);
+
+    LoadBytes(message, GOST34112018_Hash256, 0, &m);
+    m.bytes[GOST34112018_Hash256] = 0x01; // padding
+
+    HashHalfBlock(&((struct GOST34112018_Internal *) &ctx)->h, &m);
+
+    GOST34112018_GetHashFromContext(&ctx, hash_out);
+    Probe(hash_fixed_return, 32, hash_size);
+}
+
+public_api
+void GOST34112018_HashBytes64(const unsigned char          *message,
+                              const GOST34112018_HashSize_t hash_size,
+                              unsigned char                *hash_out)
+{
+    struct GOST34112018_Context ctx;
+    union  Vec512               m;
+
+    Probe(hash_fixed_entry, 64, hash_size);
+    GOST34112018_InitContext(&ctx, hash_size);
+
+    LoadBytes(message, BLOCK_SIZE, 0, &m);
+
+    HashOneBlock(&((struct GOST34112018_Internal *) &ctx)->h, &m);
+
+    GOST34112018_GetHashFromContext(&ctx, hash_out);
+    Probe(hash_fixed_return, 64, hash_size);
+}
+
+public_api
+void GOST34112018_HashBytes128(const unsigned char          *message,
+                               const GOST34112018_HashSize_t hash_size,
+                               unsigned char                *hash_out)
+{
+    struct GOST34112018_Context ctx;
+    union  Vec512               m1, m2;
+
+    Probe(hash_fixed_entry, 128, hash_size);
+    GOST34112018_InitContext(&ctx, hash_size);
+
+    LoadBytes(message,              BLOCK_SIZE, 0, &m1);
+    LoadBytes(message + BLOCK_SIZE, BLOCK_SIZE, 0, &m2);
+
+    HashTwoBlocks(&((struct GOST34112018_Internal *) &ctx)->h, &m1, &m2);
+
+    GOST34112018_GetHashFromContext(&ctx, hash_out);
+    Probe(hash_fixed_return, 128, hash_size);
+}
+
+public_api
+int GOST34112018_HashPair(const unsigned char          *left,
+                           const unsigned char          *right,
+                           const GOST34112018_HashSize_t children_size,
+                           const GOST34112018_HashSize_t hash_size,
+                           unsigned char                *hash_out)
+{
+    struct GOST34112018_Context ctx;
+    union  Vec512               m1, m2;
+    union  Vec512              *h = &((struct GOST34112018_Internal *) &ctx)->h;
+
+    if (children_size != GOST34112018_Hash256 && children_size != GOST34112018_Hash512)
+        return EINVAL;
+
+    Probe(hash_pair_entry, children_size, hash_size);
+    GOST34112018_InitContext(&ctx, hash_size);
+
+    if (children_size == GOST34112018_Hash512)
+    {
+        LoadBytes(left,  GOST34112018_Hash512, 0, &m1);
+        LoadBytes(right, GOST34112018_Hash512, 0, &m2);
+
+        HashTwoBlocks(h, &m1, &m2);
+    }
+    else
+    {
+        LoadBytes(left,  GOST34112018_Hash256, 0,                    &m1);
+        LoadBytes(right, GOST34112018_Hash256, GOST34112018_Hash256, &m1);
+
+        HashOneBlock(h, &m1);
+    }
+
+    GOST34112018_GetHashFromContext(&ctx, hash_out);
+    Probe(hash_pair_return, children_size, hash_size);
+    return 0;
+}
+
+/**
+    @brief      Compression of a message block by both chains of the dual context. The
+                first block skips the key expansion, like CompressBlock does.
+    @param      ctx - dual context, h256 and h512 are updated in place.
+    @param      m - parameter 'm', according to The Standard.
+ */
+static
+void CompressBlockDual(struct GOST34112018_DualInternal *ctx, const union Vec512 *m)
+{
+    if (Vec512_Equal(&ctx->N, &ZERO_VECTOR_512))
+    {
+        CompressBlock(&ctx->h256, m, &ctx->N);
+        CompressBlock(&ctx->h512, m, &ctx->N);
+        return;
+    }
+
+    G_N_x2(&ctx->h256, m, &ctx->N, &ctx->h512, m, &ctx->N, &ctx->h256, &ctx->h512);
+}
+
+/**
+    @brief      Stage 3 of the algorithm (ch. 8.3 of The Standard) for the dual context.
+    @param      ctx - current dual context.
+    @param      message - message of size less than 512 bits.
+    @param      size - size of the message.
+ */
+static
+void Stage3Dual(struct GOST34112018_DualInternal *ctx,
+                const  GostU8                    *message,
+                const  GostU64                    size)
+{
+    union Vec512  r1;
+    union Vec512  m = ZERO_VECTOR_512;
+    union Vec512  size512;
+
+    TimerStart(t);
+    Probe(stage3_start, size);
+    SplitMessage512(message, size, &m);
+    Uint64ToVec512(size * BYTE_SIZE, &size512);
+
+    m.bytes[size] = 0x01; // padding
+
+    CompressBlockDual(ctx, &m);
+
+    Vec512_Add(&ctx->N, &size512, &r1);
+    ctx->N = r1;
+
+    Vec512_Add(&ctx->sigma, &m, &r1);
+    ctx->sigma = r1;
+
+    G_N_x2(&ctx->h256, &ctx->N,     &ZERO_VECTOR_512,
+           &ctx->h512, &ctx->N,     &ZERO_VECTOR_512, &ctx->h256, &ctx->h512);
+    G_N_x2(&ctx->h256, &ctx->sigma, &ZERO_VECTOR_512,
+           &ctx->h512, &ctx->sigma, &ZERO_VECTOR_512, &ctx->h256, &ctx->h512);
+    Probe(stage3_done, size);
+    TimerEnd(t);
+}
+
+/**
+    @brief      Single cycle of the stage 2 of the algorithm (ch. 8.2 of The Standard) for
+                the dual context.
+    @param      ctx - current dual context.
+    @param      message - 64-byte message.
+ */
+static
+void Stage2_SingleCycleDual(struct GOST34112018_DualInternal *ctx,
+                            const  GostU8                    *message)
+{
+    union Vec512 r1;
+    union Vec512 m;
+    union Vec512 vec512;
+
+    TimerStart(t);
+    SplitMessage512(message, BLOCK_SIZE, &m);
+
+    Uint64ToVec512(512, &vec512);
+
+    CompressBlockDual(ctx, &m);
+
+    Vec512_Add(&ctx->N, &vec512, &r1);
+    ctx->N = r1;
+
+    Vec512_Add(&ctx->sigma, &m, &r1);
+    ctx->sigma = r1;
+    TimerEnd(t);
+}
+
+public_api
+void GOST34112018_InitDualContext(struct GOST34112018_DualContext *ctx)
+{
+    struct GOST34112018_DualInternal *internal = (struct GOST34112018_DualInternal *) ctx;
+
+    internal->h256  = INIT_VECTOR_256;
+    internal->h512  = INIT_VECTOR_512;
+    internal->N     = ZERO_VECTOR_512;
+    internal->sigma = ZERO_VECTOR_512;
+    ctx->prev_block_size = BLOCK_SIZE;
+}
+
+public_api
+void GOST34112018_HashBlockDual(const unsigned char             *data_block,
+                                const unsigned long long         data_block_size,
+                                struct GOST34112018_DualContext *ctx)
+{
+    TimerStart(t);
+    Probe(hash_block_dual_entry, data_block_size);
+    if (data_block_size < BLOCK_SIZE)
+    {
+        Stage3Dual((struct GOST34112018_DualInternal *) ctx, data_block, data_block_size);
+    }
+    else if (data_block_size == BLOCK_SIZE)
+    {
+        Stage2_SingleCycleDual((struct GOST34112018_DualInternal *) ctx, data_block);
+    }
+
+    ctx->prev_block_size = data_block_size;
+    Probe(hash_block_dual_return, data_block_size);
+    TimerEnd(t);
+}
+
+public_api
+void GOST34112018_HashBlockEndDual(struct GOST34112018_DualContext *ctx)
+{
+    if (ctx->prev_block_size == BLOCK_SIZE)
+    {
+        GOST34112018_HashBlockDual(GostNull, 0, ctx);
+    }
+}
+
+public_api
+void GOST34112018_GetHashesFromDualContext(const struct GOST34112018_DualContext *ctx,
+                                           unsigned char                         *hash256_out,
+                                           unsigned char                         *hash512_out)
+{
+    for (GostU32 i = 0; i < GOST34112018_Hash256; i++)
+    {
+        hash256_out[i] = ctx->h256[i + GOST34112018_Hash256];
+    }
+
+    for (GostU32 i = 0; i < GOST34112018_Hash512; i++)
+    {
+        hash512_out[i] = ctx->h512[i];
+    }
+}
+
+public_api
+void GOST34112018_HashBytesDual(const unsigned char      *message,
+                                const unsigned long long  message_size,
+                                unsigned char            *hash256_out,
+                                unsigned char            *hash512_out)
+{
+    struct GOST34112018_DualContext ctx;
+    unsigned long long              offset = 0;
+
+    Probe(hash_bytes_dual_entry, message_size);
+    GOST34112018_InitDualContext(&ctx);
+
+    for (; offset + BLOCK_SIZE <= message_size; offset += BLOCK_SIZE)
+    {
+        Stage2_SingleCycleDual((struct GOST34112018_DualInternal *) &ctx, message + offset);
+    }
+
+    Stage3Dual((struct GOST34112018_DualInternal *) &ctx, message + offset,
+               message_size - offset);
+
+    GOST34112018_GetHashesFromDualContext(&ctx, hash256_out, hash512_out);
+    Probe(hash_bytes_dual_return, message_size);
+}
+
+/**
+    @brief      Store of the contexts of many streams in the structure-of-arrays layout.
+                N of a stream never exceeds 2^64 bits in practice, so it is kept as a
+                64-bit counter rather than a vector, and a stream takes 141 bytes
+                instead of the 256 bytes of a GOST34112018_Context.
+ */
+struct GOST34112018_Store
+{
+    union Vec512 *h;
+    union Vec512 *sigma;
+    GostU64      *N;            // bits hashed so far
+    GostU8       *hash_size;    // 0 if the stream is not open
+    GostU32      *next_free;    // list of the streams which are not open
+    GostU32       free_head;    // 'capacity' if all of the streams are open
+    GostU32       capacity;
+};
+
+/**
+    @brief      Single cycle of the stage 2 of the algorithm (ch. 8.2 of The Standard) for
+                one or two streams of the store. Two streams are compressed together by
+                G_N_x2, unless one of them is at its first block, which has the key
+                schedule precomputed.
+    @param      store - store of the streams.
+    @param      a - block of the first stream.
+    @param      b - block of the second stream, which is not the first one, or GostNull.
+ */
+static
+void StoreCycle(struct GOST34112018_Store            *store,
+                const struct GOST34112018_StoreBlock *a,
+                const struct GOST34112018_StoreBlock *b)
+{
+    union Vec512 r1, m_a, m_b, N_a, N_b;
+
+    TimerStart(t);
+    SplitMessage512(a->block, BLOCK_SIZE, &m_a);
+    Uint64ToVec512(store->N[a->stream], &N_a);
+
+    if (b)
+    {
+        SplitMessage512(b->block, BLOCK_SIZE, &m_b);
+        Uint64ToVec512(store->N[b->stream], &N_b);
+
+        G_N_x2(&store->h[a->stream], &m_a, &N_a, &store->h[b->stream], &m_b, &N_b,
+               &store->h[a->stream], &store->h[b->stream]);
+
+        store->N[b->stream] += BLOCK_SIZE * BYTE_SIZE;
+        Vec512_Add(&store->sigma[b->stream], &m_b, &r1);
+        store->sigma[b->stream] = r1;
+    }
+    else
+    {
+        CompressBlock(&store->h[a->stream], &m_a, &N_a);
+    }
+
+    store->N[a->stream] += BLOCK_SIZE * BYTE_SIZE;
+    Vec512_Add(&store->sigma[a->stream], &m_a, &r1);
+    store->sigma[a->stream] = r1;
+    TimerEnd(t);
+}
+
+static
+GostBool StoreIsOpen(const struct GOST34112018_Store *store, const GostU32 stream)
+{
+    return stream < store->capacity && store->hash_size[stream] != 0;
+}
+
+public_api
+struct GOST34112018_Store *GOST34112018_StoreCreate(const unsigned int capacity)
+{
+    if (capacity == 0 || capacity > INT_MAX)
+    {
+        errno = EINVAL;
+        return GostNull;
+    }
+
+    struct GOST34112018_Store *store = calloc(1, sizeof(*store));
+    if (!store)
+        return GostNull;
+
+    store->capacity  = capacity;
+    store->h         = aligned_alloc(VEC512_BYTES, capacity * sizeof(union Vec512));
+    store->sigma     = aligned_alloc(VEC512_BYTES, capacity * sizeof(union Vec512));
+    store->N         = calloc(capacity, sizeof(*store->N));
+    store->hash_size = calloc(capacity, sizeof(*store->hash_size));
+    store->next_free = malloc(capacity * sizeof(*store->next_free));
+
+    if (!store->h || !store->sigma || !store->N || !store->hash_size || !store->next_free)
+    {
+        GOST34112018_StoreDestroy(store);
+        errno = ENOMEM;
+        return GostNull;
+    }
+
+    for (GostU32 i = 0; i < capacity; i++)
+    {
+        store->next_free[i] = i + 1;
+    }
+    store->free_head = 0;
+
+    log_d("Store of %u streams", capacity);
+    return store;
+}
+
+public_api
+void GOST34112018_StoreDestroy(struct GOST34112018_Store *store)
+{
+    if (!store)
+        return;
+
+    free(store->h);
+    free(store->sigma);
+    free(store->N);
+    free(store->hash_size);
+    free(store->next_free);
+    free(store);
+}
+
+public_api
+int GOST34112018_StoreOpen(struct GOST34112018_Store     *store,
+                           const GOST34112018_HashSize_t  hash_size)
+{
+    if (hash_size != GOST34112018_Hash256 && hash_size != GOST34112018_Hash512)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (store->free_head == store->capacity)
+    {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    const GostU32 stream = store->free_head;
+    store->free_head = store->next_free[stream];
+
+    store->h[stream]         = hash_size == GOST34112018_Hash512 ? INIT_VECTOR_512
+                                                                 : INIT_VECTOR_256;
+    store->sigma[stream]     = ZERO_VECTOR_512;
+    store->N[stream]         = 0;
+    store->hash_size[stream] = hash_size;
+
+    return (int) stream;
+}
+
+public_api
+void GOST34112018_StoreClose(struct GOST34112018_Store *store,
+                             const unsigned int         stream)
+{
+    if (!StoreIsOpen(store, stream))
+        return;
+
+    store->hash_size[stream] = 0;
+    store->next_free[stream] = store->free_head;
+    store->free_head         = stream;
+}
+
+public_api
+void GOST34112018_StoreUpdate(struct GOST34112018_Store            *store,
+                              const struct GOST34112018_StoreBlock *blocks,
+                              const unsigned long long              count)
+{
+    const struct GOST34112018_StoreBlock *pending = GostNull;
+
+    TimerStart(t);
+    for (unsigned long long i = 0; i < count; i++)
+    {
+        const struct GOST34112018_StoreBlock *block = &blocks[i];
+
+        if (!StoreIsOpen(store, block->stream))
+            continue;
+
+        // blocks of the same stream are chained, the previous one goes first
+        if (pending && pending->stream == block->stream)
+        {
+            StoreCycle(store, pending, GostNull);
+            pending = GostNull;
+        }
+
+        if (store->N[block->stream] == 0)
+        {
+            StoreCycle(store, block, GostNull);
+        }
+        else if (!pending)
+        {
+            pending = block;
+        }
+        else
+        {
+            StoreCycle(store, pending, block);
+            pending = GostNull;
+        }
+    }
+
+    if (pending)
+    {
+        StoreCycle(store, pending, GostNull);
+    }
+    TimerEnd(t);
+}
+
+public_api
+void GOST34112018_StoreFinish(struct GOST34112018_Store *store,
+                              const unsigned int         stream,
+                              const unsigned char       *tail,
+                              const unsigned long long   tail_size,
+                              unsigned char             *hash_out)
+{
+    struct GOST34112018_Context   ctx;
+    struct GOST34112018_Internal *internal = (struct GOST34112018_Internal *) &ctx;
+
+    if (!StoreIsOpen(store, stream) || tail_size >= BLOCK_SIZE)
+        return;
+
+    internal->h     = store->h[stream];
+    internal->sigma = store->sigma[stream];
+    Uint64ToVec512(store->N[stream], &internal->N);
+    ctx.hash_size = store->hash_size[stream];
+
+    Stage3(internal, tail, tail_size);
+
+    GOST34112018_GetHashFromContext(&ctx, hash_out);
+    GOST34112018_StoreClose(store, stream);
+}
+
+enum
+{
+    CACHE_LINE_SIZE   = 64,
+    MAX_TABLE_REGIONS = 32,
+};
+
+/**
+    @brief      Lists all of the lookup tables and constants the computation depends on:
+                the common ones and the ones of the implementation.
+    @param      out - output pointer, array of regions.
+    @param      max - capacity of the array.
+    @return     Number of regions written.
+ */
+static
+GostU32 CollectTables(struct TableRegion *out, const GostU32 max)
+{
+    GostU32 count = 0;
+
+#define ADD_REGION(__ptr, __size)               \
+    if (count < max)                            \
+    {                                           \
+        out[count].ptr  = (__ptr);              \
+        out[count].size = (__size);             \
+        count++;                                \
+    }
+
+    ADD_REGION(PI,                   sizeof(PI));
+    ADD_REGION(TAU,                  sizeof(TAU));
+    ADD_REGION(A,                    sizeof(A));
+    ADD_REGION(C,                    C_SIZE * sizeof(C[0]));
+    ADD_REGION(&INIT_VECTOR_256,     sizeof(INIT_VECTOR_256));
+    ADD_REGION(&INIT_VECTOR_512,     sizeof(INIT_VECTOR_512));
+    ADD_REGION(&ZERO_VECTOR_512,     sizeof(ZERO_VECTOR_512));
+    ADD_REGION(FIRST_BLOCK_KEYS_256, sizeof(FIRST_BLOCK_KEYS_256));
+    ADD_REGION(FIRST_BLOCK_KEYS_512, sizeof(FIRST_BLOCK_KEYS_512));
+
+    for (GostU32 i = 0; i < C_SIZE; i++)
+    {
+        ADD_REGION(C[i], sizeof(*C[i]));
+    }
+
+#undef ADD_REGION
+
+    return count + ImplementationTables(out + count, max - count);
+}
+
+/**
+    @brief      Reads every cache line of the region, so its pages are faulted in and
+                the data is brought into the cache.
+    @param      region - region to be touched.
+ */
+static
+void TouchRegion(const struct TableRegion *region)
+{
+    const volatile GostU8 *bytes = region->ptr;
+
+    for (GostU64 i = 0; i < region->size; i += CACHE_LINE_SIZE)
+    {
+        (void) bytes[i];
+    }
+
+    (void) bytes[region->size - 1];
+}
+
+public_api
+int GOST34112018_Warmup(const GOST34112018_WarmupFlags_t flags)
+{
+    struct TableRegion regions[MAX_TABLE_REGIONS];
+    unsigned char      hash[GOST34112018_Hash512];
+    int                rc = 0;
+
+    const GostU32 count = CollectTables(regions, MAX_TABLE_REGIONS);
+
+    for (GostU32 i = 0; i < count; i++)
+    {
+        TouchRegion(&regions[i]);
+
+        if ((flags & GOST34112018_WarmupLock) &&
+            (mlock(regions[i].ptr, regions[i].size) != 0) &&
+            (rc == 0))
+        {
+            rc = errno;
+        }
+    }
+
+    // a hash of an empty message brings in the code of the compression function too
+    GOST34112018_HashBytes(GostNull, 0, GOST34112018_Hash512, hash);
+
+    return rc;
+}
+
+#ifdef __ENABLE_PREFAULT__
+/**
+    @brief      Prefaults and locks the tables when the library is loaded, so that the
+                first hash does not pay for it.
+ */
+__attribute__((constructor))
+static
+void PrefaultTables(void)
+{
+    GOST34112018_Warmup(GOST34112018_WarmupLock);
+}
+#endif // __ENABLE_PREFAULT__
+
+public_api
+int GOST34112018_ProfileSnapshot(struct GOST34112018_ProfileEntry *entries,
+                                 const int                         max_entries)
+{
+#ifdef __ENABLE_TIMING__
+    struct CLKW_Entry snapshot[CLKW_MAX_SITES];
+
+    const int count = CLKW_Snapshot(snapshot, CLKW_MAX_SITES);
+
+    for (int i = 0; i < count && i < max_entries; i++)
+    {
+        entries[i].func_name   = snapshot[i].func_name;
+        entries[i].calls       = snapshot[i].calls;
+        entries[i].ticks       = snapshot[i].ticks;
+        entries[i].nanoseconds = snapshot[i].nanoseconds;
+    }
+
+    return count;
+#else
+    (void) entries;
+    (void) max_entries;
+    return 0;
+#endif
+}
+
+public_api
+void GOST34112018_ProfileReset(void)
+{
+#ifdef __ENABLE_TIMING__
+    CLKW_Reset();
+#endif
 }
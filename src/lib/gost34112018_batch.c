@@ -0,0 +1,143 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/*
+    Batch hashing of independent messages with OpenMP.
+
+    Messages of a batch can differ in size by orders of magnitude, so the batch is not
+    split by the number of messages. It is cut into consecutive chunks of roughly the
+    same number of bytes (several chunks per thread), and the chunks are handed out
+    dynamically: a thread which got a few large messages does not hold up the rest.
+    Every message is weighted with a constant on top of its size, so a batch of empty
+    messages is spread as well.
+ */
+
+#include "gost34112018.h"
+#include "gost34112018_common.h"
+#include "gost34112018_types.h"
+#include "stdlib.h"
+#include "stdatomic.h"
+
+#ifdef _OPENMP
+    #include "omp.h"
+#endif
+
+enum
+{
+    MESSAGE_WEIGHT_BASE = 64,         // cost of a message besides its bytes
+    CHUNKS_PER_THREAD   = 8,
+    PARALLEL_MIN_WEIGHT = 256 * 1024, // smaller batches are not worth waking threads
+};
+
+static _Atomic int g_batch_threads = 0;
+
+static
+void HashRange(const unsigned char *const    messages[],
+               const unsigned long long      sizes[],
+               const GostU64                 begin,
+               const GostU64                 end,
+               const GOST34112018_HashSize_t hash_size,
+               unsigned char                *hashes_out)
+{
+    for (GostU64 i = begin; i < end; i++)
+    {
+        GOST34112018_HashBytes(messages[i], sizes[i], hash_size, hashes_out + i * hash_size);
+    }
+}
+
+#ifdef _OPENMP
+
+static
+GostU64 MessageWeight(const unsigned long long size)
+{
+    return MESSAGE_WEIGHT_BASE + size;
+}
+
+/**
+    @brief      Hashes the batch of 'total' weight by chunks of about 'target' weight on
+                'threads' threads.
+    @return     false if the chunks could not be allocated.
+ */
+static
+GostBool HashParallel(const unsigned char *const    messages[],
+                      const unsigned long long      sizes[],
+                      const GostU64                 count,
+                      const GostU64                 total,
+                      const GostU64                 target,
+                      const int                     threads,
+                      const GOST34112018_HashSize_t hash_size,
+                      unsigned char                *hashes_out)
+{
+    // every chunk but the last one weighs at least 'target'
+    const GostU64 max_chunks = total / target + 1;
+    GostU64      *bounds     = malloc((max_chunks + 1) * sizeof(*bounds));
+    GostU64       chunks     = 0;
+    GostU64       weight     = 0;
+
+    if (!bounds)
+        return false;
+
+    bounds[0] = 0;
+    for (GostU64 i = 0; i < count; i++)
+    {
+        weight += MessageWeight(sizes[i]);
+        if (weight >= target || i + 1 == count)
+        {
+            bounds[++chunks] = i + 1;
+            weight           = 0;
+        }
+    }
+
+    log_d("Batch of %llu messages in %llu chunks on %d threads",
+          (unsigned long long) count, (unsigned long long) chunks, threads);
+
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+    for (GostU64 chunk = 0; chunk < chunks; chunk++)
+    {
+        HashRange(messages, sizes, bounds[chunk], bounds[chunk + 1], hash_size, hashes_out);
+    }
+
+    free(bounds);
+    return true;
+}
+
+#endif // _OPENMP
+
+public_api
+void GOST34112018_SetBatchThreads(const int threads)
+{
+    atomic_store_explicit(&g_batch_threads, threads < 0 ? 0 : threads, memory_order_relaxed);
+}
+
+public_api
+void GOST34112018_HashBatch(const unsigned char *const    messages[],
+                            const unsigned long long      sizes[],
+                            const unsigned long long      count,
+                            const GOST34112018_HashSize_t hash_size,
+                            unsigned char                *hashes_out)
+{
+#ifdef _OPENMP
+    int threads = atomic_load_explicit(&g_batch_threads, memory_order_relaxed);
+    if (threads == 0)
+        threads = omp_get_max_threads();
+
+    GostU64 total = 0;
+    for (GostU64 i = 0; i < count; i++)
+    {
+        total += MessageWeight(sizes[i]);
+    }
+
+    if (threads > 1 && count > 1 && total >= PARALLEL_MIN_WEIGHT)
+    {
+        GostU64 target = total / ((GostU64) threads * CHUNKS_PER_THREAD);
+        if (target < PARALLEL_MIN_WEIGHT / CHUNKS_PER_THREAD)
+            target = PARALLEL_MIN_WEIGHT / CHUNKS_PER_THREAD;
+
+        if (HashParallel(messages, sizes, count, total, target, threads, hash_size,
+                         hashes_out))
+            return;
+    }
+#endif
+
+    HashRange(messages, sizes, 0, count, hash_size, hashes_out);
+}
@@ -14,20 +14,37 @@
 
 #ifdef __ENABLE_TIMING__
     #include "clockwork.h"
-    #include "stdio.h"
-
-    extern struct CLKW_TimingMetaDataListHead g_timing_metadata_list;
 
-    #define TimerStart(__timer) CLKW_TimerStart(__timer, &g_timing_metadata_list);
+    #define TimerStart(__timer) CLKW_TimerStart(__timer);
     #define TimerEnd(__timer)   CLKW_TimerEnd(__timer);
 #else
     #define TimerStart(__timer)
     #define TimerEnd(__timer)
 #endif
 
+/*
+    USDT probes (provider 'gost34112018'), e.g. for bpftrace:
+        usdt:libgost34112018.so:gost34112018:hash_bytes_entry { @sizes = hist(arg0); }
+    A probe is a single nop in the code and a note in the ELF file, its arguments are
+    only read by the tracer when it is attached.
+ */
+#ifdef __ENABLE_USDT__
+    #include "sys/sdt.h"
+
+    #define Probe(__name, ...) STAP_PROBEV(gost34112018, __name, ##__VA_ARGS__)
+#else
+    #define Probe(__name, ...)
+#endif
+
 #include "gost34112018.h"
 #include "gost34112018_vec512.h"
 
+/**
+    @brief      Marks definitions of the public API functions. Everything else is hidden
+                from users of the library (see C_VISIBILITY_PRESET in CMakeLists.txt).
+ */
+#define public_api __attribute__((visibility("default")))
+
 /**
     @brief      Internal context of the algorithm, as described in ch. 8.1 of the Standard.
  */
@@ -38,6 +55,18 @@ struct GOST34112018_AlignAttribute(32) GOST34112018_Internal
     union Vec512 sigma;
 };
 
+/**
+    @brief      Internal dual context: two chains (256- and 512-bit digests) over the
+                same message share N and sigma.
+ */
+struct GOST34112018_AlignAttribute(64) GOST34112018_DualInternal
+{
+    union Vec512 h256;
+    union Vec512 h512;
+    union Vec512 N;
+    union Vec512 sigma;
+};
+
 /**
     @brief      S-box, as defined in the chapter 5.1 of The Standard. It is used for
                 S-transformation.
@@ -0,0 +1,349 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/*
+    Delta computation of the rsync algorithm, with Streebog-256 as the strong checksum.
+
+    The signature of a basis has a weak and a strong checksum per block. The weak one is
+    the checksum of rsync: a = sum of the bytes, b = sum of (block_size - i) * byte i,
+    both modulo 2^16. It can be rolled by one byte in a few operations, so it is
+    computed at every offset of the message. Only the offsets whose weak checksum is in
+    the signature are hashed with Streebog, and the digest is compared with the strong
+    one. The strong checksums of the signature are computed in batches with
+    GOST34112018_HashBatch.
+
+    After a match the next block of the basis is tried first, before the table of the
+    weak checksums: unchanged regions are mostly consecutive blocks.
+ */
+
+#include "gost34112018.h"
+#include "gost34112018_common.h"
+#include "gost34112018_types.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+
+enum
+{
+    SIGNATURE_BATCH = 1024,     // blocks hashed per GOST34112018_HashBatch
+    MIN_BUCKETS     = 16,
+};
+
+static const GostU64 NO_BLOCK = ~0ull;
+
+/**
+    @brief      Weak checksums of the blocks, as a hash table chained through the blocks.
+ */
+struct WeakTable
+{
+    GostU64 *heads;     // first block of a bucket, NO_BLOCK if there is none
+    GostU64 *next;      // next block of the same bucket
+    int      shift;
+};
+
+/**
+    @brief      Pending instruction: ranges of the basis are merged until a different
+                one is emitted.
+ */
+struct Emitter
+{
+    GOST34112018_DeltaCallback_t callback;
+    void                        *user_data;
+    GostU64                      offset;
+    GostU64                      size;
+};
+
+static
+GostU32 WeakChecksum(const GostU8 *data, const GostU64 size, GostU32 *a_out, GostU32 *b_out)
+{
+    GostU32 a = 0;
+    GostU32 b = 0;
+
+    for (GostU64 i = 0; i < size; i++)
+    {
+        a += data[i];
+        b += a;
+    }
+
+    *a_out = a;
+    *b_out = b;
+    return (a & 0xffff) | (b << 16);
+}
+
+static
+GostU64 Bucket(const struct WeakTable *table, const GostU32 weak)
+{
+    return (GostU64) (weak * 0x9e3779b97f4a7c15ull) >> table->shift;
+}
+
+static
+int TableInit(struct WeakTable *table, const struct GOST34112018_Signature *signature,
+              const GostU64 count)
+{
+    GostU64 buckets = MIN_BUCKETS;
+    int     bits    = 4;
+
+    while (buckets < count)
+    {
+        buckets <<= 1;
+        bits++;
+    }
+
+    table->shift = 64 - bits;
+    table->heads = malloc(buckets * sizeof(*table->heads));
+    table->next  = malloc((count ? count : 1) * sizeof(*table->next));
+
+    if (!table->heads || !table->next)
+    {
+        free(table->heads);
+        free(table->next);
+        return ENOMEM;
+    }
+
+    memset(table->heads, 0xff, buckets * sizeof(*table->heads));
+
+    // inserted backwards, so the earlier blocks come first in a bucket
+    for (GostU64 i = count; i-- > 0;)
+    {
+        const GostU64 bucket = Bucket(table, signature->blocks[i].weak);
+        table->next[i]       = table->heads[bucket];
+        table->heads[bucket] = i;
+    }
+
+    return 0;
+}
+
+static
+int EmitFlush(struct Emitter *emitter)
+{
+    if (emitter->size == 0)
+        return 0;
+
+    const struct GOST34112018_DeltaOp op = { NULL, emitter->offset, emitter->size };
+    emitter->size = 0;
+    return emitter->callback(&op, emitter->user_data);
+}
+
+static
+int EmitCopy(struct Emitter *emitter, const GostU64 offset, const GostU64 size)
+{
+    if (emitter->size != 0 && emitter->offset + emitter->size == offset)
+    {
+        emitter->size += size;
+        return 0;
+    }
+
+    const int rc = EmitFlush(emitter);
+
+    emitter->offset = offset;
+    emitter->size   = size;
+    return rc;
+}
+
+static
+int EmitLiteral(struct Emitter *emitter, const GostU8 *literal, const GostU64 size)
+{
+    if (size == 0)
+        return 0;
+
+    const int rc = EmitFlush(emitter);
+    if (rc != 0)
+        return rc;
+
+    const struct GOST34112018_DeltaOp op = { literal, 0, size };
+    return emitter->callback(&op, emitter->user_data);
+}
+
+/**
+    @brief      Checks a block of the basis against the message at an offset. The digest
+                of the message is computed at most once per offset.
+ */
+static
+GostBool BlockMatches(const struct GOST34112018_Signature *signature, const GostU64 block,
+                      const GostU32 weak, const GostU8 *window, const GostU64 size,
+                      GostU8 *digest, GostBool *hashed)
+{
+    if (signature->blocks[block].weak != weak)
+        return false;
+
+    if (!*hashed)
+    {
+        GOST34112018_HashBytes(window, size, GOST34112018_Hash256, digest);
+        *hashed = true;
+    }
+
+    return memcmp(signature->blocks[block].strong, digest, signature->strong_size) == 0;
+}
+
+public_api
+long long GOST34112018_DeltaSignature(const unsigned char                *basis,
+                                      const unsigned long long            size,
+                                      const unsigned long long            block_size,
+                                      const unsigned int                  strong_size,
+                                      struct GOST34112018_BlockSignature *blocks_out)
+{
+    GostU32 a, b;
+
+    if (block_size == 0 || strong_size == 0 || strong_size > GOST34112018_Hash256)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const GostU64         count    = size / block_size + (size % block_size != 0);
+    const unsigned char **messages = malloc(SIGNATURE_BATCH * sizeof(*messages));
+    unsigned long long   *sizes    = malloc(SIGNATURE_BATCH * sizeof(*sizes));
+    unsigned char        *hashes   = malloc(SIGNATURE_BATCH * GOST34112018_Hash256);
+
+    if (!messages || !sizes || !hashes)
+    {
+        free(messages);
+        free(sizes);
+        free(hashes);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // the strong checksums are hashed as batches, spread across threads with OpenMP
+    for (GostU64 first = 0; first < count; first += SIGNATURE_BATCH)
+    {
+        const GostU64 batch = count - first < SIGNATURE_BATCH ? count - first : SIGNATURE_BATCH;
+
+        for (GostU64 i = 0; i < batch; i++)
+        {
+            const GostU64 offset = (first + i) * block_size;
+
+            messages[i] = basis + offset;
+            sizes[i]    = size - offset < block_size ? size - offset : block_size;
+            blocks_out[first + i].weak = WeakChecksum(messages[i], sizes[i], &a, &b);
+        }
+
+        GOST34112018_HashBatch(messages, sizes, batch, GOST34112018_Hash256, hashes);
+
+        for (GostU64 i = 0; i < batch; i++)
+        {
+            memset(blocks_out[first + i].strong, 0, sizeof(blocks_out[first + i].strong));
+            memcpy(blocks_out[first + i].strong, hashes + i * GOST34112018_Hash256, strong_size);
+        }
+    }
+
+    log_d("%llu bytes in %llu blocks", size, (unsigned long long) count);
+
+    free(messages);
+    free(sizes);
+    free(hashes);
+    return (long long) count;
+}
+
+public_api
+int GOST34112018_DeltaCompute(const struct GOST34112018_Signature *signature,
+                              const unsigned char                 *message,
+                              const unsigned long long             size,
+                              const GOST34112018_DeltaCallback_t   callback,
+                              void                                *user_data)
+{
+    const GostU64    block_size = signature->block_size;
+    struct Emitter   emitter    = { callback, user_data, 0, 0 };
+    struct WeakTable table;
+    GostU8           digest[GOST34112018_Hash256];
+    GostU32          a = 0, b = 0;
+    int              rc;
+
+    if (block_size == 0 || signature->strong_size == 0 || signature->strong_size > GOST34112018_Hash256)
+        return EINVAL;
+
+    const GostU64 count = signature->basis_size / block_size +
+                          (signature->basis_size % block_size != 0);
+    const GostU64 tail  = count ? signature->basis_size - (count - 1) * block_size : 0;
+
+    rc = TableInit(&table, signature, count);
+    if (rc != 0)
+        return rc;
+
+    GostU64  literal  = 0;          // start of the pending literal bytes
+    GostU64  expected = NO_BLOCK;   // block after the last match
+    GostU64  pos      = 0;
+    GostBool rolled   = false;      // a and b are of the window at pos
+
+    while (rc == 0 && pos + block_size <= size)
+    {
+        const GostU8 *window = message + pos;
+        GostBool      hashed = false;
+        GostU64       match  = NO_BLOCK;
+
+        if (!rolled)
+        {
+            WeakChecksum(window, block_size, &a, &b);
+            rolled = true;
+        }
+
+        const GostU32 weak = (a & 0xffff) | (b << 16);
+
+        // a short last block only matches at the end of the message, below
+        if (expected < count && (expected + 1 < count || tail == block_size) &&
+            BlockMatches(signature, expected, weak, window, block_size, digest, &hashed))
+        {
+            match = expected;
+        }
+
+        for (GostU64 i = table.heads[Bucket(&table, weak)]; match == NO_BLOCK && i != NO_BLOCK;
+             i = table.next[i])
+        {
+            if ((i + 1 < count || tail == block_size) &&
+                BlockMatches(signature, i, weak, window, block_size, digest, &hashed))
+            {
+                match = i;
+            }
+        }
+
+        if (match != NO_BLOCK)
+        {
+            rc = EmitLiteral(&emitter, message + literal, pos - literal);
+            if (rc == 0)
+                rc = EmitCopy(&emitter, match * block_size, block_size);
+
+            pos     += block_size;
+            literal  = pos;
+            expected = match + 1;
+            rolled   = false;
+            continue;
+        }
+
+        if (pos + block_size == size)
+            break;
+
+        // rolls the window by one byte
+        const GostU32 out = message[pos];
+        const GostU32 in  = message[pos + block_size];
+
+        a   += in - out;
+        b   += a - (GostU32) block_size * out;
+        pos++;
+    }
+
+    // the rest is shorter than a block, it can only be the short last block
+    const GostU64 rest = size - literal;
+    if (rc == 0 && tail != 0 && tail < block_size && rest >= tail)
+    {
+        const GostU8 *window = message + size - tail;
+        GostBool      hashed = false;
+
+        if (BlockMatches(signature, count - 1, WeakChecksum(window, tail, &a, &b), window,
+                         tail, digest, &hashed))
+        {
+            rc = EmitLiteral(&emitter, message + literal, size - tail - literal);
+            if (rc == 0)
+                rc = EmitCopy(&emitter, (count - 1) * block_size, tail);
+            literal = size;
+        }
+    }
+
+    if (rc == 0)
+        rc = EmitLiteral(&emitter, message + literal, size - literal);
+    if (rc == 0)
+        rc = EmitFlush(&emitter);
+
+    free(table.heads);
+    free(table.next);
+    return rc;
+}
@@ -0,0 +1,370 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/*
+    Asynchronous hashing engine.
+
+    Every worker owns an inbox: an intrusive lock-free stack of jobs (a compare-and-swap
+    push by the submitters, an exchange of the whole stack by the worker, which then
+    reverses it to restore the submission order). A job goes to the worker with the
+    smallest number of queued bytes, so a few long messages do not pile up behind each
+    other. Idle workers sleep on a semaphore, which does not enter the kernel on
+    sem_post unless the worker is actually sleeping.
+
+    Completed jobs without a callback are pushed onto another lock-free stack, which
+    is taken by GOST34112018_EnginePoll. If there is an eventfd, it is written after the
+    push and read before the take, so a completion is never missed.
+ */
+
+#include "gost34112018.h"
+#include "gost34112018_common.h"
+#include "gost34112018_types.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "stdatomic.h"
+#include "pthread.h"
+#include "semaphore.h"
+#include "unistd.h"
+#include "sys/eventfd.h"
+
+enum
+{
+    READ_BUFFER_SIZE = 65536,
+    FD_JOB_WEIGHT    = 1 << 20, // size of a descriptor is unknown in advance
+    JOB_WEIGHT_BASE  = 64,      // so that empty messages are spread too
+};
+
+struct GOST34112018_AlignAttribute(64) EngineWorker
+{
+    struct GOST34112018_Job *_Atomic inbox;
+    _Atomic GostU64                  pending;   // bytes in the inbox and in progress
+    sem_t                            wakeup;
+    pthread_t                        thread;
+    struct GOST34112018_Engine      *engine;
+};
+
+struct GOST34112018_Engine
+{
+    struct EngineWorker             *workers;
+    int                              count;
+    _Atomic int                      quit;
+    int                              eventfd;
+    struct GOST34112018_Job *_Atomic completed;
+    struct GOST34112018_Job         *ready;     // taken from 'completed', not polled yet
+};
+
+static
+GostU64 JobWeight(const struct GOST34112018_Job *job)
+{
+    return JOB_WEIGHT_BASE + (job->fd >= 0 ? FD_JOB_WEIGHT : job->message_size);
+}
+
+static
+void Push(struct GOST34112018_Job *_Atomic *stack, struct GOST34112018_Job *job)
+{
+    job->next = atomic_load_explicit(stack, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(stack, &job->next, job,
+                                                  memory_order_release,
+                                                  memory_order_relaxed))
+        ;
+}
+
+/**
+    @brief      Takes the whole stack, in the order of the pushes.
+ */
+static
+struct GOST34112018_Job *TakeAll(struct GOST34112018_Job *_Atomic *stack)
+{
+    struct GOST34112018_Job *job      = atomic_exchange_explicit(stack, GostNull,
+                                                                 memory_order_acquire);
+    struct GOST34112018_Job *reversed = GostNull;
+
+    while (job)
+    {
+        struct GOST34112018_Job *next = job->next;
+        job->next = reversed;
+        reversed  = job;
+        job       = next;
+    }
+
+    return reversed;
+}
+
+static
+void RunJob(struct GOST34112018_Job *job)
+{
+    if (job->hash_size != GOST34112018_Hash256 && job->hash_size != GOST34112018_Hash512)
+    {
+        job->status = EINVAL;
+    }
+    else if (job->fd >= 0)
+    {
+        job->status = GOST34112018_HashFd(job->fd, job->hash_size, job->hash);
+    }
+    else
+    {
+        GOST34112018_HashBytes(job->message, job->message_size, job->hash_size, job->hash);
+        job->status = 0;
+    }
+}
+
+static
+void Complete(struct GOST34112018_Engine *engine, struct GOST34112018_Job *job)
+{
+    if (job->callback)
+    {
+        job->callback(job);
+        return;
+    }
+
+    Push(&engine->completed, job);
+
+    if (engine->eventfd >= 0)
+    {
+        const GostU64 one = 1;
+        while (write(engine->eventfd, &one, sizeof(one)) < 0 && errno == EINTR)
+            ;
+    }
+}
+
+static
+void *WorkerThread(void *arg)
+{
+    struct EngineWorker        *worker = arg;
+    struct GOST34112018_Engine *engine = worker->engine;
+
+    for (;;)
+    {
+        struct GOST34112018_Job *job = TakeAll(&worker->inbox);
+
+        if (!job)
+        {
+            // jobs submitted before the destruction are completed first
+            if (atomic_load(&engine->quit))
+                break;
+
+            while (sem_wait(&worker->wakeup) != 0 && errno == EINTR)
+                ;
+            continue;
+        }
+
+        while (job)
+        {
+            struct GOST34112018_Job *next   = job->next;
+            const GostU64            weight = JobWeight(job);
+
+            RunJob(job);
+            atomic_fetch_sub_explicit(&worker->pending, weight, memory_order_relaxed);
+
+            // the job may be reused by the caller right after this
+            Complete(engine, job);
+            job = next;
+        }
+    }
+
+    return GostNull;
+}
+
+public_api
+int GOST34112018_HashFd(const int                     fd,
+                        const GOST34112018_HashSize_t hash_size,
+                        unsigned char                *hash_out)
+{
+    struct GOST34112018_Context ctx;
+    unsigned char               buffer[READ_BUFFER_SIZE];
+    GostU64                     filled = 0;
+    GostBool                    eof    = false;
+
+    if (hash_size != GOST34112018_Hash256 && hash_size != GOST34112018_Hash512)
+        return EINVAL;
+
+    GOST34112018_InitContext(&ctx, hash_size);
+
+    while (!eof)
+    {
+        const ssize_t n = read(fd, buffer + filled, sizeof(buffer) - filled);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return errno;
+
+        filled += n;
+        eof     = n == 0;
+
+        // before the end only whole blocks are hashed, the rest waits for more data
+        GostU64 i = 0;
+        for (; i + BLOCK_SIZE <= filled; i += BLOCK_SIZE)
+        {
+            GOST34112018_HashBlock(buffer + i, BLOCK_SIZE, &ctx);
+        }
+
+        if (eof && i < filled)
+        {
+            GOST34112018_HashBlock(buffer + i, filled - i, &ctx);
+            i = filled;
+        }
+
+        memmove(buffer, buffer + i, filled - i);
+        filled -= i;
+    }
+
+    GOST34112018_HashBlockEnd(&ctx);
+    GOST34112018_GetHashFromContext(&ctx, hash_out);
+    return 0;
+}
+
+public_api
+struct GOST34112018_Engine *GOST34112018_EngineCreate(const int                        workers,
+                                                      const GOST34112018_EngineFlags_t flags)
+{
+    if (workers < 1)
+    {
+        errno = EINVAL;
+        return GostNull;
+    }
+
+    struct GOST34112018_Engine *engine = calloc(1, sizeof(*engine));
+    if (!engine)
+        return GostNull;
+
+    engine->eventfd = -1;
+    engine->workers = aligned_alloc(64, workers * sizeof(struct EngineWorker));
+    if (!engine->workers)
+    {
+        free(engine);
+        errno = ENOMEM;
+        return GostNull;
+    }
+    memset(engine->workers, 0, workers * sizeof(struct EngineWorker));
+
+    if (flags & GOST34112018_EngineUseEventFd)
+    {
+        engine->eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (engine->eventfd < 0)
+        {
+            const int rc = errno;
+            GOST34112018_EngineDestroy(engine);
+            errno = rc;
+            return GostNull;
+        }
+    }
+
+    for (; engine->count < workers; engine->count++)
+    {
+        struct EngineWorker *worker = &engine->workers[engine->count];
+
+        worker->engine = engine;
+        sem_init(&worker->wakeup, 0, 0);
+
+        const int rc = pthread_create(&worker->thread, GostNull, WorkerThread, worker);
+        if (rc != 0)
+        {
+            sem_destroy(&worker->wakeup);
+            GOST34112018_EngineDestroy(engine);
+            errno = rc;
+            return GostNull;
+        }
+    }
+
+    log_d("Engine with %d workers", workers);
+    return engine;
+}
+
+public_api
+void GOST34112018_EngineDestroy(struct GOST34112018_Engine *engine)
+{
+    if (!engine)
+        return;
+
+    atomic_store(&engine->quit, 1);
+
+    for (int i = 0; i < engine->count; i++)
+    {
+        sem_post(&engine->workers[i].wakeup);
+    }
+
+    for (int i = 0; i < engine->count; i++)
+    {
+        pthread_join(engine->workers[i].thread, GostNull);
+        sem_destroy(&engine->workers[i].wakeup);
+    }
+
+    if (engine->eventfd >= 0)
+        close(engine->eventfd);
+
+    free(engine->workers);
+    free(engine);
+}
+
+public_api
+int GOST34112018_EngineSubmit(struct GOST34112018_Engine *engine,
+                              struct GOST34112018_Job    *job)
+{
+    if (!job || (job->fd < 0 && !job->message && job->message_size))
+        return EINVAL;
+
+    // the least loaded worker; the loads are read without synchronization, a stale
+    // value only makes the choice slightly worse
+    struct EngineWorker *target = &engine->workers[0];
+    GostU64              least  = atomic_load_explicit(&target->pending, memory_order_relaxed);
+
+    for (int i = 1; i < engine->count && least != 0; i++)
+    {
+        const GostU64 pending = atomic_load_explicit(&engine->workers[i].pending,
+                                                     memory_order_relaxed);
+        if (pending < least)
+        {
+            least  = pending;
+            target = &engine->workers[i];
+        }
+    }
+
+    atomic_fetch_add_explicit(&target->pending, JobWeight(job), memory_order_relaxed);
+    Push(&target->inbox, job);
+    sem_post(&target->wakeup);
+
+    return 0;
+}
+
+public_api
+int GOST34112018_EnginePoll(struct GOST34112018_Engine *engine,
+                            struct GOST34112018_Job   **jobs,
+                            const int                   max_jobs)
+{
+    int count = 0;
+
+    if (!engine->ready)
+    {
+        if (engine->eventfd >= 0)
+        {
+            GostU64 value;
+            while (read(engine->eventfd, &value, sizeof(value)) < 0 && errno == EINTR)
+                ;
+        }
+
+        engine->ready = TakeAll(&engine->completed);
+    }
+
+    while (engine->ready && count < max_jobs)
+    {
+        jobs[count++] = engine->ready;
+        engine->ready = engine->ready->next;
+    }
+
+    // jobs are left over, the event loop must come back even without new completions
+    if (engine->ready && engine->eventfd >= 0)
+    {
+        const GostU64 one = 1;
+        while (write(engine->eventfd, &one, sizeof(one)) < 0 && errno == EINTR)
+            ;
+    }
+
+    return count;
+}
+
+public_api
+int GOST34112018_EngineEventFd(const struct GOST34112018_Engine *engine)
+{
+    return engine->eventfd;
+}
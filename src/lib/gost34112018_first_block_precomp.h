@@ -0,0 +1,185 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+#ifndef __GOST34112018_FIRST_BLOCK_PRECOMP_H__
+#define __GOST34112018_FIRST_BLOCK_PRECOMP_H__
+
+#include "gost34112018_common.h"
+
+/*
+    On the first call of G_N both h (one of the initialization vectors) and N (zero)
+    are known in advance, so is the whole key schedule of E. The arrays below were
+    produced by PRECOMPUTE_FIRST_BLOCK_KEYS (see file 'gost34112018.c').
+ */
+
+/**
+    @brief      Iteration keys K_1 ... K_13 of the first call of G_N for the 256-bit
+                initialization vector (h = INIT_VECTOR_256, N = 0).
+ */
+const union Vec512 FIRST_BLOCK_KEYS_256[C_SIZE + 1] = {
+    { .qwords = {
+        0x23c5ee40b07b5f15, 0x23c5ee40b07b5f15,
+        0x23c5ee40b07b5f15, 0x23c5ee40b07b5f15,
+        0x23c5ee40b07b5f15, 0x23c5ee40b07b5f15,
+        0x23c5ee40b07b5f15, 0x23c5ee40b07b5f15,
+    } },
+    { .qwords = {
+        0x0c7d0cc39d4a5eb9, 0xe611d68c8401bfcd,
+        0x9c7e6b5eea633511, 0xda22de93a66a66b1,
+        0x451cfab6a904a549, 0x349769df88be26bf,
+        0x3bd6cb8233694cea, 0x18ee8f3176b2ebea,
+    } },
+    { .qwords = {
+        0xfd74af4101805f2d, 0xc7f68e73ba26fb00,
+        0x915000cd674be12c, 0xce0913f1253e7757,
+        0x940bba1a519e9d1f, 0xbf27dee21164c5e3,
+        0x57aec8ce91e7fd46, 0xaaa4cf31a2659591,
+    } },
+    { .qwords = {
+        0x8200311920839286, 0x2067fb5ddd6ac156,
+        0x98d01ef0602b0e33, 0xcd801ea9dd743a0d,
+        0xa54228aeca9c4585, 0xa5329a2236747bf8,
+        0x0235e2afadded326, 0x61fe0a65cc177af5,
+    } },
+    { .qwords = {
+        0x99a5d5309fe73d5a, 0xd595394cc199bf69,
+        0x0a546acd63d960ba, 0x169bd540af75e161,
+        0xe4693c86c06c7d4e, 0xe2934314aa2ecb3e,
+        0x1fd5abb75fbf26a8, 0x9983685f4fd3636f,
+    } },
+    { .qwords = {
+        0xbe297c13c0f7a156, 0xaf98c83c22cdb0e2,
+        0xd170990a86602088, 0x62615d907eb0551a,
+        0x922994e52820ffea, 0xf1e735d613946e32,
+        0x156c9a7fbcc6b8fd, 0xf05772ae2ce7f025,
+    } },
+    { .qwords = {
+        0xfcf03d9b81cfbb8d, 0x51a9b18cfc8e4098,
+        0xb7b005a43e5959a6, 0xc89eb6b35167f159,
+        0x0b2b8d0e6be2b5ac, 0x7453e9c321197433,
+        0x46b3e7688829fbb7, 0x5ad144c362546e4e,
+    } },
+    { .qwords = {
+        0xc1f191a539016daa, 0xb0a0ad5790dfb73f,
+        0x8d6c746adcd5426f, 0x018287e5a9f509c7,
+        0x83332fe0b8efdac9, 0x518c638ed530122a,
+        0xb64fa840b934352b, 0x6a6cec9a1ba20a8d,
+    } },
+    { .qwords = {
+        0x2b8fb6a8f5dd0409, 0x367d5f9437443538,
+        0xd82e0e2069fc49ed, 0xbb4c9d580a224e9c,
+        0xe35fa35fee9dd8bd, 0xf351531f948f0fc5,
+        0x8a8d6643f705bd51, 0x99217036737aa9b3,
+    } },
+    { .qwords = {
+        0xd74fe5393ccb05d2, 0xca8fdf678fcb337b,
+        0x76f83022f2526791, 0xf0b35d80a7317a7f,
+        0xd703c35d2e62aeaf, 0x9a7630e8bfd6c3fe,
+        0xe69288d8ec9e9dda, 0x906763c0fc89fa1a,
+    } },
+    { .qwords = {
+        0x3d695c0bfc89add5, 0x159c8c624c3fe6e1,
+        0x52ce34af272f96d3, 0xd6a1dae9a6dc6ddf,
+        0xbff3c29d38dadb6e, 0x4e2ae3eee68991bb,
+        0x04a5c8e03ee43385, 0x88ce996c63618e64,
+    } },
+    { .qwords = {
+        0x1d7b5a0f7655f2db, 0xe75a49c68199112a,
+        0x628e8365d8798477, 0xb55f30c79982ca45,
+        0x76b978fccaa32f38, 0x506aa168cf829157,
+        0x3eec550100576f3a, 0x3e0a281ea9bd4606,
+    } },
+    { .qwords = {
+        0xfcf9eca06500bf03, 0x0ef9f5e03c907fa1,
+        0x19ff433e76ef6adb, 0x14b21cffc51e3fa3,
+        0x3f6cbab54ed18b83, 0x62c848422b6a92f9,
+        0xe432fbae18672122, 0xf0b273409eb31aeb,
+    } },
+};
+
+/**
+    @brief      Iteration keys K_1 ... K_13 of the first call of G_N for the 512-bit
+                initialization vector (h = INIT_VECTOR_512, N = 0).
+ */
+const union Vec512 FIRST_BLOCK_KEYS_512[C_SIZE + 1] = {
+    { .qwords = {
+        0xb383fc2eced4a574, 0xb383fc2eced4a574,
+        0xb383fc2eced4a574, 0xb383fc2eced4a574,
+        0xb383fc2eced4a574, 0xb383fc2eced4a574,
+        0xb383fc2eced4a574, 0xb383fc2eced4a574,
+    } },
+    { .qwords = {
+        0xf4d18af70c46cf1e, 0x36f728bd1d7eec33,
+        0x3569cd2ba0513010, 0x88be14f0b2da2797,
+        0xa73d010807dae9c1, 0xe0e902d23aef2ee9,
+        0x13f2c3ebc774e80d, 0xd0b00807642fd78f,
+    } },
+    { .qwords = {
+        0x816dbaf927b8fca9, 0xe24e7d636eb1607e,
+        0x2d61014a1b5c9fc9, 0x1a9387ecc257930e,
+        0x6681105e2d13712a, 0x44ecf66716d3a0f1,
+        0xb0e8b7dac6ef6e6b, 0x9d4475c7899f2d0b,
+    } },
+    { .qwords = {
+        0x782487defd83ca0f, 0x3370d0a3d6194ac5,
+        0xc8cde3b8bf78f95f, 0xdf9f8055ffe3c004,
+        0x73e58856bd96a72f, 0xdae2e40cc4c3219c,
+        0x3b8c833c48e1c670, 0x5c283daba5ec1f23,
+    } },
+    { .qwords = {
+        0xeb5ffc818826470c, 0x36fa7cba93f8239c,
+        0x046388469ae195c4, 0x2fd97d7493784779,
+        0x1fab4e37225292ec, 0xd4d2964fa18d42c4,
+        0x569cbc9317baa551, 0x109f33262731f9bd,
+    } },
+    { .qwords = {
+        0x85d30d99f286c5e7, 0x459bc382573aee2d,
+        0x37555c676c153d99, 0x3e1135cfbefe2442,
+        0xc6b5da70b1b87474, 0x57e25026ccf41e67,
+        0x8f8a0877be9a1707, 0xb32c9b02667911cf,
+    } },
+    { .qwords = {
+        0x1502e634559e32f1, 0xd6b01e17285eb7e6,
+        0xc9c7aad694edc922, 0x6c8207594714e8e9,
+        0xce6050fcbabdc234, 0xc7b00e4f3f62765e,
+        0xac49989e7d84b08b, 0x8a13c1b195fd0886,
+    } },
+    { .qwords = {
+        0x71dff8de5d128cac, 0x617ff01cc546728e,
+        0x56c342034773023d, 0x4c47f7a9e13bb1db,
+        0xa5acbffd323ec376, 0x8730cb9179d6dece,
+        0x17d0ddfbc926f2e8, 0x52cec3b11448bb86,
+    } },
+    { .qwords = {
+        0x1c6088afa1a1e735, 0xc01fc415e3fb7dc6,
+        0x91d70103f48fd4d4, 0xd4d7104453896712,
+        0x38b963bbb7f28e74, 0xb9c243cb82154aa1,
+        0x502007a05ea64a4e, 0xf38c5b7947e7736d,
+    } },
+    { .qwords = {
+        0xa7eef99f6068b315, 0xd0687948286cfefa,
+        0x1dd30c24c1ab877a, 0xa5e61bb465459958,
+        0x0617cecbaddd618e, 0x6b6e18e40cdaabd3,
+        0x257dd6e3db7c1bf5, 0x0740b3faa03ed39b,
+    } },
+    { .qwords = {
+        0x1a82164893313116, 0x107bb3aa56441af1,
+        0x96e9695ce8957837, 0xe374f088f2e5c294,
+        0x3ad71e5fca678e45, 0x47011bf92b95910a,
+        0xc8cfdfcae9dbb293, 0x185811cf3c2633ae,
+    } },
+    { .qwords = {
+        0x076451901279ee4c, 0x427052fa345613fd,
+        0x760b251f4db5cdef, 0xc9a1eab800fb8cc5,
+        0xd2f206906b5ee00d, 0x0fedd87189b75b3c,
+        0x6c3b2120d2a3f15e, 0x9d46bf66234a7ed0,
+    } },
+    { .qwords = {
+        0x0d76b621cb45be70, 0xa3cbc28fd94f9546,
+        0x90bf612558b4b60a, 0x7782ef127cd6b982,
+        0xd2d8565ada926c3f, 0x61e3c585b3a405a6,
+        0xd768b6e223484c97, 0x0f79104026b900d8,
+    } },
+};
+
+#endif // __GOST34112018_FIRST_BLOCK_PRECOMP_H__
@@ -6,6 +6,24 @@
 
 #include "gost34112018_vec512.h"
 
+/**
+    @brief      Memory occupied by a lookup table or a constant used by the implementation.
+ */
+struct TableRegion
+{
+    const void *ptr;
+    GostU64     size;
+};
+
+/**
+    @brief      Lists the lookup tables specific to the implementation (the common ones
+                are listed in gost34112018.c), so they can be prefaulted and locked.
+    @param      out - output pointer, array of regions.
+    @param      max - capacity of the array.
+    @return     Number of regions written.
+ */
+GostU32 ImplementationTables(struct TableRegion *out, const GostU32 max);
+
 /**
     @brief      Compression function G_N(h, m), as defined in ch. 7 of The Standard.
     @param      m - parameter 'm', accroding to The Standard.
@@ -16,6 +34,25 @@
 void G_N(const union Vec512 *h, const union Vec512 *m, const union Vec512 *N,
                union Vec512 *out);
 
+/**
+    @brief      Two independent compression functions: out_a = G_N_a(h_a, m_a),
+                out_b = G_N_b(h_b, m_b), e.g. the two chains of a dual context over the
+                same block, or blocks of two different messages. Implementations
+                interleave the two chains, so that one hides the latency of the other.
+                It is safe for the outputs to alias the corresponding 'h'.
+    @param      h_a - parameter 'h' of the first chain.
+    @param      m_a - parameter 'm' of the first chain.
+    @param      N_a - parameter 'N' of the first chain.
+    @param      h_b - parameter 'h' of the second chain.
+    @param      m_b - parameter 'm' of the second chain.
+    @param      N_b - parameter 'N' of the second chain.
+    @param      out_a - output pointer of the first chain.
+    @param      out_b - output pointer of the second chain.
+ */
+void G_N_x2(const union Vec512 *h_a, const union Vec512 *m_a, const union Vec512 *N_a,
+            const union Vec512 *h_b, const union Vec512 *m_b, const union Vec512 *N_b,
+                  union Vec512 *out_a,     union Vec512 *out_b);
+
 /**
     @brief      Encryption function E(K, m), which is an integral part of the compression
                 function, as defined in ch. 7 of The Standard.
@@ -26,4 +63,25 @@ void G_N(const union Vec512 *h, const union Vec512 *m, const union Vec512 *N,
 void E(const union Vec512 *K, const union Vec512 *m,
              union Vec512 *out);
 
+/**
+    @brief      Computes all iteration keys of the encryption function E for a single
+                call of G_N(h, m): K_1 = LPSX[h ^ N] and K_2 ... K_13, as defined in
+                ch. 7 of The Standard. The keys do not depend on the message 'm'.
+    @param      h - parameter 'h', according to The Standard.
+    @param      N - parameter 'N', according to The Standard.
+    @param      K - output pointer, array of C_SIZE + 1 iteration keys.
+ */
+void KeySchedule(const union Vec512 *h, const union Vec512 *N,
+                       union Vec512 *K);
+
+/**
+    @brief      Encryption function E(K, m) with all of the iteration keys already
+                computed by KeySchedule.
+    @param      K - array of C_SIZE + 1 iteration keys.
+    @param      m - an argument 'm', according to The Standard.
+    @param      out - output pointer.
+ */
+void E_Scheduled(const union Vec512 *K, const union Vec512 *m,
+                       union Vec512 *out);
+
 #endif // __GOST34112018_INTERFACE_H__
\ No newline at end of file
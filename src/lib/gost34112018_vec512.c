@@ -104,10 +104,5 @@ void DebugPrintVec(const union Vec512 *vec)
 
     printf("\n");
     fflush(stdout);
-}
-#else
-void DebugPrintVec(const union Vec512 *out)
-{
-
 }
 #endif // __ENABLE_DEBUG_OUTPUT__
@@ -23,6 +23,11 @@ void Vec512_Xor(const union Vec512 *in1, const union Vec512 *in2, union Vec512 *
 
 void Uint64ToVec512(const GostU64 x, union Vec512 *out);
 
+#ifdef __ENABLE_DEBUG_OUTPUT__
 void DebugPrintVec(const union Vec512 *out);
+#else
+    // release builds must not pay for a call of an empty function
+    #define DebugPrintVec(__vec) ((void) (__vec))
+#endif // __ENABLE_DEBUG_OUTPUT__
 
 #endif // __GOST34112018_VEC512_H__
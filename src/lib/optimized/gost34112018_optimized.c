@@ -7,6 +7,10 @@
 #include "gost34112018_interface.h"
 #include "gost34112018_types.h"
 
+#ifdef __ENABLE_UNROLLED_ROUNDS__
+    #include "gost34112018_optimized_unrolled.h"
+#endif
+
 /**
     @brief     This function computes a lookup table for L (ch. 5.3) and S (ch. 5.2)
                transformations combined. It is not used in the computation itself, rather
@@ -46,6 +50,20 @@ void PRECOMPUTE_TRANSFORM_TABLE(unsigned long long **out)
     LINEAR_TRANSFORM_TABLE(A, 64, PI, 256, table);
 }
 
+GostU32 ImplementationTables(struct TableRegion *out, const GostU32 max)
+{
+    if (max < 1)
+    {
+        return 0;
+    }
+
+    out[0].ptr  = SL_transform_precomp;
+    out[0].size = sizeof(SL_transform_precomp);
+
+    return 1;
+}
+
+#ifndef __ENABLE_UNROLLED_ROUNDS__
 /**
     @brief       X transformation of the algorithm as defined in the ch. 6 of the Standard.
     @param       a - argument 'a', according to the standard.
@@ -68,6 +86,7 @@ void XTransform(const union Vec512 *a, const union Vec512 *k, union Vec512 *out)
     log_d("Out: ");
     DebugPrintVec(out);
 }
+#endif // __ENABLE_UNROLLED_ROUNDS__
 
 /**
     @brief      P transformation of the algorithm as defined in the ch. 6 of the Standard.
@@ -155,6 +174,27 @@ void K_i(const GostU8 i, const union Vec512 *prev_K, union Vec512 *out)
     DebugPrintVec(out);
 }
 
+void KeySchedule(const union Vec512 *h,
+                 const union Vec512 *N,
+                       union Vec512 *K)
+{
+    union Vec512 r1, r2;
+
+    TimerStart(t);
+    Vec512_Xor(h, N, &r1);
+
+    PTransform(&r1, &r2);
+    SLCombinedTransform(&r2, &K[0]);
+
+    for (int i = 1; i <= C_SIZE; i++)
+    {
+        K_i(i, &K[i - 1], &K[i]);
+    }
+
+    TimerEnd(t);
+}
+
+#ifndef __ENABLE_UNROLLED_ROUNDS__
 void E(const union Vec512 *K, const union Vec512 *m, union Vec512 *out)
 {
     union Vec512 r1, r2, new_m, prev_K;
@@ -223,3 +263,164 @@ void G_N(const union Vec512 *h,
     log_d("Out: ");
     DebugPrintVec(out);
 }
+
+void G_N_x2(const union Vec512 *h_a,
+            const union Vec512 *m_a,
+            const union Vec512 *N_a,
+            const union Vec512 *h_b,
+            const union Vec512 *m_b,
+            const union Vec512 *N_b,
+                  union Vec512 *out_a,
+                  union Vec512 *out_b)
+{
+    union Vec512 K_a, K_b, e_a, e_b, r1_a, r1_b, r2_a, r2_b;
+
+    TimerStart(t);
+    // K_1 of both chains
+    Vec512_Xor(h_a, N_a, &r1_a);
+    Vec512_Xor(h_b, N_b, &r1_b);
+    PTransform(&r1_a, &r2_a);
+    PTransform(&r1_b, &r2_b);
+    SLCombinedTransform(&r2_a, &K_a);
+    SLCombinedTransform(&r2_b, &K_b);
+
+    // E of both chains, step by step
+    XTransform(m_a, &K_a, &r1_a);
+    XTransform(m_b, &K_b, &r1_b);
+    PTransform(&r1_a, &r2_a);
+    PTransform(&r1_b, &r2_b);
+    SLCombinedTransform(&r2_a, &e_a);
+    SLCombinedTransform(&r2_b, &e_b);
+
+    for (int i = 1; i < C_SIZE; i++)
+    {
+        K_i(i, &K_a, &K_a);
+        K_i(i, &K_b, &K_b);
+        XTransform(&e_a, &K_a, &r1_a);
+        XTransform(&e_b, &K_b, &r1_b);
+        PTransform(&r1_a, &r2_a);
+        PTransform(&r1_b, &r2_b);
+        SLCombinedTransform(&r2_a, &e_a);
+        SLCombinedTransform(&r2_b, &e_b);
+    }
+
+    K_i(C_SIZE, &K_a, &K_a);
+    K_i(C_SIZE, &K_b, &K_b);
+    XTransform(&e_a, &K_a, &r1_a);
+    XTransform(&e_b, &K_b, &r1_b);
+
+    // h and m are read before the outputs are written, as out may alias h
+    Vec512_Xor(&r1_a, h_a, &r2_a);
+    Vec512_Xor(&r1_b, h_b, &r2_b);
+    Vec512_Xor(&r2_a, m_a, out_a);
+    Vec512_Xor(&r2_b, m_b, out_b);
+    TimerEnd(t);
+}
+
+void E_Scheduled(const union Vec512 *K, const union Vec512 *m, union Vec512 *out)
+{
+    union Vec512 r1, r2, new_m;
+
+    log_d("E transformation (scheduled keys):");
+    log_d("m: ");
+    DebugPrintVec(m);
+
+    TimerStart(t);
+    new_m = *m;
+
+    for (int i = 0; i < C_SIZE; i++)
+    {
+        XTransform(&new_m, &K[i], &r1);
+        PTransform(&r1, &r2);
+        SLCombinedTransform(&r2, &new_m);
+    }
+
+    XTransform(&new_m, &K[C_SIZE], out);
+
+    TimerEnd(t);
+    log_d("Out: ");
+    DebugPrintVec(out);
+}
+
+#else
+
+void E(const union Vec512 *K, const union Vec512 *m, union Vec512 *out)
+{
+    union Vec512 new_m, prev_K = *K;
+
+    TimerStart(t);
+    // K_1 = K
+    LPSX_Unrolled(m, &prev_K, &new_m);
+
+    ROUNDS_UNROLLED(&prev_K, &new_m)
+
+    X_Unrolled(&new_m, &prev_K, out);
+    TimerEnd(t);
+}
+
+void G_N(const union Vec512 *h,
+         const union Vec512 *m,
+         const union Vec512 *N,
+               union Vec512 *out)
+{
+    union Vec512 new_m, K;
+
+    TimerStart(t);
+    LPSX_Unrolled(h, N, &K);
+    LPSX_Unrolled(m, &K, &new_m);
+
+    ROUNDS_UNROLLED(&K, &new_m)
+
+    X_Unrolled(&new_m, &K, &new_m);
+    X_Unrolled(&new_m, h, &new_m);
+    X_Unrolled(&new_m, m, out);
+    TimerEnd(t);
+}
+
+void G_N_x2(const union Vec512 *h_a,
+            const union Vec512 *m_a,
+            const union Vec512 *N_a,
+            const union Vec512 *h_b,
+            const union Vec512 *m_b,
+            const union Vec512 *N_b,
+                  union Vec512 *out_a,
+                  union Vec512 *out_b)
+{
+    union Vec512 K_a, K_b, e_a, e_b;
+
+    TimerStart(t);
+    LPSX_Unrolled(h_a, N_a, &K_a);
+    LPSX_Unrolled(h_b, N_b, &K_b);
+    LPSX_Unrolled(m_a, &K_a, &e_a);
+    LPSX_Unrolled(m_b, &K_b, &e_b);
+
+    // the rounds are not unrolled here: two fully unrolled chains are twice as much
+    // code as G_N, and the kernel becomes slower than two calls of G_N
+    for (int i = 0; i < C_SIZE - 1; i++)
+    {
+        ROUND_UNROLLED_X2(&K_a, &e_a, &K_b, &e_b, C[i])
+    }
+    LPSX_Unrolled(&K_a, C[C_SIZE - 1], &K_a);
+    LPSX_Unrolled(&K_b, C[C_SIZE - 1], &K_b);
+
+    X_Unrolled(&e_a, &K_a, &e_a);
+    X_Unrolled(&e_b, &K_b, &e_b);
+    X_Unrolled(&e_a, h_a, &e_a);
+    X_Unrolled(&e_b, h_b, &e_b);
+    X_Unrolled(&e_a, m_a, out_a);
+    X_Unrolled(&e_b, m_b, out_b);
+    TimerEnd(t);
+}
+
+void E_Scheduled(const union Vec512 *K, const union Vec512 *m, union Vec512 *out)
+{
+    union Vec512 new_m = *m;
+
+    TimerStart(t);
+    SCHEDULED_ROUNDS_UNROLLED(K, &new_m)
+
+    X_Unrolled(&new_m, &K[C_SIZE], out);
+    TimerEnd(t);
+}
+
+#endif // __ENABLE_UNROLLED_ROUNDS__
@@ -0,0 +1,135 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+#ifndef __GOST34112018_OPTIMIZED_UNROLLED_H__
+#define __GOST34112018_OPTIMIZED_UNROLLED_H__
+
+#include "gost34112018_common.h"
+#include "gost34112018_optimized_precomp.h"
+
+/*
+    Building blocks of the fully unrolled E and G_N (see ENABLE_UNROLLED_ROUNDS in
+    CMakeLists.txt). Every round is expanded by the preprocessor, the iteration
+    constants are referenced directly instead of through the C[] table and all of the
+    transformations are inlined, so the kernel is a straight sequence of loads, XORs
+    and table lookups. There are no debug hooks in here.
+ */
+
+/**
+    @brief      Iteration constants C_1 ... C_12, see C[] in gost34112018_common.h.
+ */
+extern const union Vec512 C1, C2, C3, C4,  C5,  C6,
+                          C7, C8, C9, C10, C11, C12;
+
+/**
+    @brief      One column of the combined P + S + L transformation. P is a
+                transposition of the 8x8 byte matrix, so i-th qword of the result is
+                built from i-th bytes of all of the qwords of the argument.
+ */
+#define LPS_COLUMN(__x, __i)                                          \
+    (  SL_transform_precomp[0][((__x)[0] >> (8 * (__i))) & 0xFF]      \
+     ^ SL_transform_precomp[1][((__x)[1] >> (8 * (__i))) & 0xFF]      \
+     ^ SL_transform_precomp[2][((__x)[2] >> (8 * (__i))) & 0xFF]      \
+     ^ SL_transform_precomp[3][((__x)[3] >> (8 * (__i))) & 0xFF]      \
+     ^ SL_transform_precomp[4][((__x)[4] >> (8 * (__i))) & 0xFF]      \
+     ^ SL_transform_precomp[5][((__x)[5] >> (8 * (__i))) & 0xFF]      \
+     ^ SL_transform_precomp[6][((__x)[6] >> (8 * (__i))) & 0xFF]      \
+     ^ SL_transform_precomp[7][((__x)[7] >> (8 * (__i))) & 0xFF])
+
+/**
+    @brief      Combined X, P, S and L transformations: out = LPS(a ^ b). It is safe
+                for out to alias any of the arguments.
+    @param      a - first argument.
+    @param      b - second argument.
+    @param      out - output pointer.
+ */
+static inline __attribute__((always_inline))
+void LPSX_Unrolled(const union Vec512 *a, const union Vec512 *b, union Vec512 *out)
+{
+    const GostU64 x[VEC512_QWORDS] = {
+        a->qwords[0] ^ b->qwords[0], a->qwords[1] ^ b->qwords[1],
+        a->qwords[2] ^ b->qwords[2], a->qwords[3] ^ b->qwords[3],
+        a->qwords[4] ^ b->qwords[4], a->qwords[5] ^ b->qwords[5],
+        a->qwords[6] ^ b->qwords[6], a->qwords[7] ^ b->qwords[7],
+    };
+
+    out->qwords[0] = LPS_COLUMN(x, 0);
+    out->qwords[1] = LPS_COLUMN(x, 1);
+    out->qwords[2] = LPS_COLUMN(x, 2);
+    out->qwords[3] = LPS_COLUMN(x, 3);
+    out->qwords[4] = LPS_COLUMN(x, 4);
+    out->qwords[5] = LPS_COLUMN(x, 5);
+    out->qwords[6] = LPS_COLUMN(x, 6);
+    out->qwords[7] = LPS_COLUMN(x, 7);
+}
+
+/**
+    @brief      X transformation: out = a ^ b.
+ */
+static inline __attribute__((always_inline))
+void X_Unrolled(const union Vec512 *a, const union Vec512 *b, union Vec512 *out)
+{
+    out->qwords[0] = a->qwords[0] ^ b->qwords[0];
+    out->qwords[1] = a->qwords[1] ^ b->qwords[1];
+    out->qwords[2] = a->qwords[2] ^ b->qwords[2];
+    out->qwords[3] = a->qwords[3] ^ b->qwords[3];
+    out->qwords[4] = a->qwords[4] ^ b->qwords[4];
+    out->qwords[5] = a->qwords[5] ^ b->qwords[5];
+    out->qwords[6] = a->qwords[6] ^ b->qwords[6];
+    out->qwords[7] = a->qwords[7] ^ b->qwords[7];
+}
+
+/**
+    @brief      Round of E with the key expansion: K_{i+1} = LPS(K_i ^ C_i),
+                m = LPS(m ^ K_{i+1}).
+ */
+#define ROUND_UNROLLED(__K, __m, __C)       \
+    LPSX_Unrolled((__K), (__C), (__K));     \
+    LPSX_Unrolled((__m), (__K), (__m));
+
+/**
+    @brief      All 12 rounds of E after K_1 has been applied. Leaves K_13 in __K.
+ */
+#define ROUNDS_UNROLLED(__K, __m)           \
+    ROUND_UNROLLED((__K), (__m), &C1)       \
+    ROUND_UNROLLED((__K), (__m), &C2)       \
+    ROUND_UNROLLED((__K), (__m), &C3)       \
+    ROUND_UNROLLED((__K), (__m), &C4)       \
+    ROUND_UNROLLED((__K), (__m), &C5)       \
+    ROUND_UNROLLED((__K), (__m), &C6)       \
+    ROUND_UNROLLED((__K), (__m), &C7)       \
+    ROUND_UNROLLED((__K), (__m), &C8)       \
+    ROUND_UNROLLED((__K), (__m), &C9)       \
+    ROUND_UNROLLED((__K), (__m), &C10)      \
+    ROUND_UNROLLED((__K), (__m), &C11)      \
+    LPSX_Unrolled((__K), &C12, (__K));
+
+/**
+    @brief      Round of two independent chains (see G_N_x2). The steps of the chains
+                alternate, so the table lookups of one chain fill the latency of the
+                other.
+ */
+#define ROUND_UNROLLED_X2(__K_a, __m_a, __K_b, __m_b, __C)   \
+    LPSX_Unrolled((__K_a), (__C),   (__K_a));               \
+    LPSX_Unrolled((__K_b), (__C),   (__K_b));               \
+    LPSX_Unrolled((__m_a), (__K_a), (__m_a));               \
+    LPSX_Unrolled((__m_b), (__K_b), (__m_b));
+
+/**
+    @brief      All 12 rounds of E with the precomputed keys __K[0] ... __K[12].
+ */
+#define SCHEDULED_ROUNDS_UNROLLED(__K, __m)     \
+    LPSX_Unrolled((__m), &(__K)[0],  (__m));    \
+    LPSX_Unrolled((__m), &(__K)[1],  (__m));    \
+    LPSX_Unrolled((__m), &(__K)[2],  (__m));    \
+    LPSX_Unrolled((__m), &(__K)[3],  (__m));    \
+    LPSX_Unrolled((__m), &(__K)[4],  (__m));    \
+    LPSX_Unrolled((__m), &(__K)[5],  (__m));    \
+    LPSX_Unrolled((__m), &(__K)[6],  (__m));    \
+    LPSX_Unrolled((__m), &(__K)[7],  (__m));    \
+    LPSX_Unrolled((__m), &(__K)[8],  (__m));    \
+    LPSX_Unrolled((__m), &(__K)[9],  (__m));    \
+    LPSX_Unrolled((__m), &(__K)[10], (__m));    \
+    LPSX_Unrolled((__m), &(__K)[11], (__m));
+
+#endif // __GOST34112018_OPTIMIZED_UNROLLED_H__
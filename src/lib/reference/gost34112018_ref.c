@@ -5,6 +5,18 @@
 #include "gost34112018_common.h"
 #include "gost34112018_interface.h"
 
+/**
+    @brief      The reference implementation uses only the tables of The Standard, which
+                are common for all of the implementations.
+ */
+GostU32 ImplementationTables(struct TableRegion *out, const GostU32 max)
+{
+    (void) out;
+    (void) max;
+
+    return 0;
+}
+
 /**
     @brief       X transformation of the algorithm as defined in the ch. 6 of the Standard.
     @param       a - argument 'a', according to the standard.
@@ -218,3 +230,84 @@ void G_N(const union Vec512 *h,
     log_d("Out: ");
     DebugPrintVec(out);
 }
+
+/**
+    @brief      Two independent compression functions. The reference implementation
+                simply computes them one after another.
+    @param      h_a - parameter 'h' of the first chain.
+    @param      m_a - parameter 'm' of the first chain.
+    @param      N_a - parameter 'N' of the first chain.
+    @param      h_b - parameter 'h' of the second chain.
+    @param      m_b - parameter 'm' of the second chain.
+    @param      N_b - parameter 'N' of the second chain.
+    @param      out_a - output pointer of the first chain.
+    @param      out_b - output pointer of the second chain.
+ */
+void G_N_x2(const union Vec512 *h_a,
+            const union Vec512 *m_a,
+            const union Vec512 *N_a,
+            const union Vec512 *h_b,
+            const union Vec512 *m_b,
+            const union Vec512 *N_b,
+                  union Vec512 *out_a,
+                  union Vec512 *out_b)
+{
+    G_N(h_a, m_a, N_a, out_a);
+    G_N(h_b, m_b, N_b, out_b);
+}
+
+/**
+    @brief      Computes all iteration keys of the encryption function E for a single
+                call of G_N(h, m), as defined in ch. 7 of The Standard.
+    @param      h - parameter 'h', according to The Standard.
+    @param      N - parameter 'N', according to The Standard.
+    @param      K - output pointer, array of C_SIZE + 1 iteration keys.
+ */
+void KeySchedule(const union Vec512 *h,
+                 const union Vec512 *N,
+                       union Vec512 *K)
+{
+    union Vec512 r1, r2;
+
+    Vec512_Xor(h, N, &r1);
+
+    STransform(&r1, &r2);
+    PTransform(&r2, &r1);
+    LTransform(&r1, &K[0]);
+
+    for (int i = 1; i <= C_SIZE; i++)
+    {
+        K_i(i, &K[i - 1], &K[i]);
+    }
+}
+
+/**
+    @brief      Encryption function E(K, m) with all of the iteration keys already
+                computed by KeySchedule.
+    @param      K - array of C_SIZE + 1 iteration keys.
+    @param      m - an argument 'm', according to The Standard.
+    @param      out - output pointer.
+ */
+void E_Scheduled(const union Vec512 *K, const union Vec512 *m, union Vec512 *out)
+{
+    union Vec512 r1, r2, new_m;
+
+    log_d("E transformation (scheduled keys):");
+    log_d("m: ");
+    DebugPrintVec(m);
+
+    new_m = *m;
+
+    for (int i = 0; i < C_SIZE; i++)
+    {
+        XTransform(&new_m, &K[i], &r1);
+        STransform(&r1, &r2);
+        PTransform(&r2, &r1);
+        LTransform(&r1, &new_m);
+    }
+
+    XTransform(&new_m, &K[C_SIZE], out);
+
+    log_d("Out: ");
+    DebugPrintVec(out);
+}
@@ -2,8 +2,18 @@
 // SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
 
 #include "gost34112018.h"
+#include "gost34112018_cas.h"
 #include "stdio.h"
 #include "assert.h"
+#include "string.h"
+#include "pthread.h"
+#include "stdatomic.h"
+#include "unistd.h"
+#include "poll.h"
+#include "errno.h"
+#include "stdlib.h"
+#include "fcntl.h"
+#include "sys/stat.h"
 
 #define TESTS_ENABLED
 #ifdef TESTS_ENABLED
@@ -61,6 +71,21 @@ bool BytesEqual(const unsigned char *lhs,
     return true;
 }
 
+/**
+    Test vectors of The Standard are written as numbers, most significant byte first,
+    while the library hashes byte strings, where the first byte is the least
+    significant one. This converts one into the other.
+ */
+void ReverseBytes(const unsigned char *in,
+                  const unsigned long long size,
+                  unsigned char *out)
+{
+    for (unsigned long long i = 0; i < size; i++)
+    {
+        out[i] = in[size - 1 - i];
+    }
+}
+
 void Test(void)
 {
     unsigned char message[] = {
@@ -86,23 +111,30 @@ void Test(void)
         0x62, 0x54, 0x28, 0x8d, 0xd6, 0x86, 0x3d, 0xcc, 0xd5, 0xb9, 0xf5, 0x4a, 0x1a, 0xd0, 0x54, 0x1b
     };
 
+    unsigned char message_le[63];
+    ReverseBytes(message, 63, message_le);
+
     unsigned char hash512[64];
-    GOST34112018_HashBytes(message, 63, GOST34112018_Hash512, hash512);
+    unsigned char hash512_be[64];
+    GOST34112018_HashBytes(message_le, 63, GOST34112018_Hash512, hash512);
+    ReverseBytes(hash512, GOST34112018_Hash512, hash512_be);
 
     log_d("Got 512-bit hash!");
-    PrintBytes(hash512, GOST34112018_Hash512);
+    PrintBytes(hash512_be, GOST34112018_Hash512);
 
-    assert(BytesEqual(expected_hash512, hash512, GOST34112018_Hash512));
+    assert(BytesEqual(expected_hash512, hash512_be, GOST34112018_Hash512));
     log_d("Hash 512 OK!");
 
     unsigned char hash256[64];
+    unsigned char hash256_be[64];
 
-    GOST34112018_HashBytes(message, 63, GOST34112018_Hash256, hash256);
+    GOST34112018_HashBytes(message_le, 63, GOST34112018_Hash256, hash256);
+    ReverseBytes(hash256, GOST34112018_Hash256, hash256_be);
 
     log_d("Got 256-bit hash!");
-    PrintBytes(hash256, GOST34112018_Hash256);
+    PrintBytes(hash256_be, GOST34112018_Hash256);
 
-    assert(BytesEqual(expected_hash256, hash256, GOST34112018_Hash256));
+    assert(BytesEqual(expected_hash256, hash256_be, GOST34112018_Hash256));
     log_d("Hash 256 OK!");
 }
 
@@ -138,20 +170,27 @@ void Test2(void)
         0x6f, 0xca, 0xbf, 0x26, 0x22, 0xe6, 0x88, 0x1e,
     };
 
+    unsigned char message_le[72];
+    ReverseBytes(message, 72, message_le);
+
     unsigned char hash512[64];
+    unsigned char hash512_be[64];
 
     unsigned char hash256[32];
+    unsigned char hash256_be[32];
 
-    GOST34112018_HashBytes(message, 72, GOST34112018_Hash512, hash512);
+    GOST34112018_HashBytes(message_le, 72, GOST34112018_Hash512, hash512);
+    ReverseBytes(hash512, 64, hash512_be);
 
-    PrintBytes(hash512, 64);
-    assert(BytesEqual(expected_hash512, hash512, GOST34112018_Hash512));
+    PrintBytes(hash512_be, 64);
+    assert(BytesEqual(expected_hash512, hash512_be, GOST34112018_Hash512));
     log_d("Hash512 OK!");
 
-    GOST34112018_HashBytes(message, 72, GOST34112018_Hash256, hash256);
+    GOST34112018_HashBytes(message_le, 72, GOST34112018_Hash256, hash256);
+    ReverseBytes(hash256, 32, hash256_be);
 
-    PrintBytes(hash256, 32);
-    assert(BytesEqual(expected_hash256, hash256, GOST34112018_Hash256));
+    PrintBytes(hash256_be, 32);
+    assert(BytesEqual(expected_hash256, hash256_be, GOST34112018_Hash256));
     log_d("Hash256 OK!");
 }
 
@@ -177,11 +216,726 @@ void Test3(void)
     PrintBytes(hash512, GOST34112018_Hash512);
 }
 
+void TestFixedLength(void)
+{
+    const GOST34112018_HashSize_t sizes[] = { GOST34112018_Hash256, GOST34112018_Hash512 };
+
+    unsigned char message[128];
+    unsigned char expected[64];
+    unsigned char hash[64];
+
+    for (unsigned long long i = 0; i < sizeof(message); i++)
+    {
+        message[i] = (unsigned char) (i * 37 + 11);
+    }
+
+    for (int s = 0; s < 2; s++)
+    {
+        const GOST34112018_HashSize_t hash_size = sizes[s];
+
+        GOST34112018_HashBytes(message, 32, hash_size, expected);
+        GOST34112018_HashBytes32(message, hash_size, hash);
+        assert(BytesEqual(expected, hash, hash_size));
+
+        GOST34112018_HashBytes(message, 64, hash_size, expected);
+        GOST34112018_HashBytes64(message, hash_size, hash);
+        assert(BytesEqual(expected, hash, hash_size));
+
+        GOST34112018_HashPair(message, message + 32, GOST34112018_Hash256, hash_size, hash);
+        assert(BytesEqual(expected, hash, hash_size));
+
+        GOST34112018_HashBytes(message, 128, hash_size, expected);
+        GOST34112018_HashBytes128(message, hash_size, hash);
+        assert(BytesEqual(expected, hash, hash_size));
+
+        GOST34112018_HashPair(message, message + 64, GOST34112018_Hash512, hash_size, hash);
+        assert(BytesEqual(expected, hash, hash_size));
+
+        const int rc = GOST34112018_HashPair(message, message + 48, 48, hash_size, hash);
+        assert(rc == EINVAL && BytesEqual(expected, hash, hash_size));
+        (void) rc;
+
+        // the streaming interface has to agree with the one-shot one
+        struct GOST34112018_Context ctx;
+        GOST34112018_InitContext(&ctx, hash_size);
+        GOST34112018_HashBlock(message,      64, &ctx);
+        GOST34112018_HashBlock(message + 64, 64, &ctx);
+        GOST34112018_HashBlockEnd(&ctx);
+        GOST34112018_GetHashFromContext(&ctx, hash);
+        assert(BytesEqual(expected, hash, hash_size));
+
+        log_d("Fixed-length %d OK!", hash_size * 8);
+    }
+}
+
+void TestDual(void)
+{
+    const unsigned long long sizes[] = { 0, 1, 63, 64, 65, 127, 128, 200 };
+
+    unsigned char message[200];
+    unsigned char expected256[32], expected512[64];
+    unsigned char hash256[32], hash512[64];
+
+    for (unsigned long long i = 0; i < sizeof(message); i++)
+    {
+        message[i] = (unsigned char) (i * 53 + 7);
+    }
+
+    for (unsigned long long s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        const unsigned long long size = sizes[s];
+
+        GOST34112018_HashBytes(message, size, GOST34112018_Hash256, expected256);
+        GOST34112018_HashBytes(message, size, GOST34112018_Hash512, expected512);
+
+        GOST34112018_HashBytesDual(message, size, hash256, hash512);
+        assert(BytesEqual(expected256, hash256, GOST34112018_Hash256));
+        assert(BytesEqual(expected512, hash512, GOST34112018_Hash512));
+
+        // streaming, the way the command-line tool feeds the blocks
+        struct GOST34112018_DualContext ctx;
+        unsigned long long i = 0;
+
+        GOST34112018_InitDualContext(&ctx);
+        for (; i + 64 <= size; i += 64)
+        {
+            GOST34112018_HashBlockDual(message + i, 64, &ctx);
+        }
+        if (i < size)
+        {
+            GOST34112018_HashBlockDual(message + i, size - i, &ctx);
+        }
+        GOST34112018_HashBlockEndDual(&ctx);
+        GOST34112018_GetHashesFromDualContext(&ctx, hash256, hash512);
+        assert(BytesEqual(expected256, hash256, GOST34112018_Hash256));
+        assert(BytesEqual(expected512, hash512, GOST34112018_Hash512));
+    }
+
+    log_d("Dual OK!");
+}
+
+void TestWarmup(void)
+{
+    unsigned char expected[64];
+    unsigned char hash[64];
+    const unsigned char message[] = { 0x30, 0x31, 0x32 };
+
+    GOST34112018_HashBytes(message, sizeof(message), GOST34112018_Hash512, expected);
+
+    int rc = GOST34112018_Warmup(GOST34112018_WarmupTouch);
+    assert(rc == 0);
+
+    // locking may be forbidden by RLIMIT_MEMLOCK, but hashing must not be affected
+    rc = GOST34112018_Warmup(GOST34112018_WarmupLock);
+    log_d("Warmup with lock: %d", rc);
+
+    GOST34112018_HashBytes(message, sizeof(message), GOST34112018_Hash512, hash);
+    assert(BytesEqual(expected, hash, GOST34112018_Hash512));
+    log_d("Warmup OK!");
+}
+
+enum
+{
+    PROFILE_THREADS = 4,
+    PROFILE_BLOCKS  = 100,
+};
+
+void *ProfileThread(void *arg)
+{
+    struct GOST34112018_Context ctx;
+    unsigned char block[64] = { 0 };
+
+    (void) arg;
+
+    GOST34112018_InitContext(&ctx, GOST34112018_Hash512);
+    for (int i = 0; i < PROFILE_BLOCKS; i++)
+    {
+        GOST34112018_HashBlock(block, sizeof(block), &ctx);
+    }
+    GOST34112018_HashBlockEnd(&ctx);
+
+    return NULL;
+}
+
+void TestProfile(void)
+{
+    struct GOST34112018_ProfileEntry entries[64];
+    pthread_t threads[PROFILE_THREADS];
+
+    GOST34112018_ProfileReset();
+
+    for (int i = 0; i < PROFILE_THREADS; i++)
+    {
+        int rc = pthread_create(&threads[i], NULL, ProfileThread, NULL);
+        assert(rc == 0);
+        (void) rc;
+    }
+    for (int i = 0; i < PROFILE_THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    int count = GOST34112018_ProfileSnapshot(entries, 64);
+    if (count == 0)
+    {
+        log_d("Library is built without timing, skipped");
+        return;
+    }
+
+    // every thread calls HashBlock once per block and once more from HashBlockEnd
+    bool found = false;
+    for (int i = 0; i < count && i < 64; i++)
+    {
+        if (strcmp(entries[i].func_name, "GOST34112018_HashBlock") == 0)
+        {
+            assert(entries[i].calls == PROFILE_THREADS * (PROFILE_BLOCKS + 1));
+            found = true;
+        }
+    }
+    assert(found);
+    (void) found;
+
+    GOST34112018_ProfileReset();
+    count = GOST34112018_ProfileSnapshot(entries, 64);
+    assert(count == 0);
+
+    log_d("Profile OK!");
+}
+
+enum
+{
+    ENGINE_WORKERS = 3,
+    ENGINE_JOBS    = 200,
+};
+
+static atomic_int g_engine_callbacks;
+
+void EngineCallback(struct GOST34112018_Job *job)
+{
+    unsigned char expected[64];
+
+    GOST34112018_HashBytes(job->message, job->message_size, job->hash_size, expected);
+    assert(job->status == 0);
+    assert(BytesEqual(expected, job->hash, job->hash_size));
+    atomic_fetch_add(&g_engine_callbacks, 1);
+}
+
+void TestEngine(void)
+{
+    static unsigned char message[ENGINE_JOBS * 7];
+    static struct GOST34112018_Job jobs[ENGINE_JOBS];
+    struct GOST34112018_Job *completed[16];
+    unsigned char expected[64];
+    int pipe_fds[2];
+
+    for (unsigned long long i = 0; i < sizeof(message); i++)
+    {
+        message[i] = (unsigned char) (i * 31 + 3);
+    }
+
+    struct GOST34112018_Engine *engine = GOST34112018_EngineCreate(ENGINE_WORKERS,
+                                                                   GOST34112018_EngineUseEventFd);
+    assert(engine);
+
+    // every other job is completed with a callback, the rest are polled
+    int polled_jobs = 0;
+    for (int i = 0; i < ENGINE_JOBS; i++)
+    {
+        jobs[i].message      = message;
+        jobs[i].message_size = i * 7;
+        jobs[i].fd           = -1;
+        jobs[i].hash_size    = i % 3 ? GOST34112018_Hash512 : GOST34112018_Hash256;
+        jobs[i].callback     = i % 2 ? EngineCallback : NULL;
+        polled_jobs         += i % 2 ? 0 : 1;
+
+        int rc = GOST34112018_EngineSubmit(engine, &jobs[i]);
+        assert(rc == 0);
+        (void) rc;
+    }
+
+    // a descriptor, hashed to its end
+    struct GOST34112018_Job fd_job = { 0 };
+    int rc = pipe(pipe_fds);
+    assert(rc == 0);
+    rc = write(pipe_fds[1], message, 1000);
+    assert(rc == 1000);
+    (void) rc;
+    close(pipe_fds[1]);
+    fd_job.fd        = pipe_fds[0];
+    fd_job.hash_size = GOST34112018_Hash512;
+    GOST34112018_EngineSubmit(engine, &fd_job);
+    polled_jobs++;
+
+    struct pollfd pfd = { .fd = GOST34112018_EngineEventFd(engine), .events = POLLIN };
+    while (polled_jobs > 0)
+    {
+        poll(&pfd, 1, 1000);
+
+        const int count = GOST34112018_EnginePoll(engine, completed, 16);
+        for (int i = 0; i < count; i++)
+        {
+            struct GOST34112018_Job *job = completed[i];
+            assert(!job->callback);
+            assert(job->status == 0);
+
+            if (job == &fd_job)
+            {
+                GOST34112018_HashBytes(message, 1000, GOST34112018_Hash512, expected);
+            }
+            else
+            {
+                GOST34112018_HashBytes(job->message, job->message_size, job->hash_size, expected);
+            }
+            assert(BytesEqual(expected, job->hash, job->hash_size));
+        }
+        polled_jobs -= count;
+    }
+    close(pipe_fds[0]);
+
+    GOST34112018_EngineDestroy(engine);
+    assert(atomic_load(&g_engine_callbacks) == ENGINE_JOBS / 2);
+
+    // the descriptor helper used by the engine, on its own
+    unsigned char hash[64];
+    rc = pipe(pipe_fds);
+    assert(rc == 0);
+    rc = write(pipe_fds[1], message, 1000);
+    assert(rc == 1000);
+    close(pipe_fds[1]);
+    rc = GOST34112018_HashFd(pipe_fds[0], GOST34112018_Hash256, hash);
+    GOST34112018_HashBytes(message, 1000, GOST34112018_Hash256, expected);
+    assert(rc == 0 && BytesEqual(expected, hash, GOST34112018_Hash256));
+    rc = GOST34112018_HashFd(pipe_fds[0], (GOST34112018_HashSize_t) 48, hash);
+    assert(rc == EINVAL);
+    close(pipe_fds[0]);
+
+    log_d("Engine OK!");
+}
+
+enum { BATCH_MESSAGES = 200, BATCH_MAX_SIZE = 65536 };
+
+void TestBatch(void)
+{
+    static unsigned char message[BATCH_MAX_SIZE];
+    static unsigned char hashes[BATCH_MESSAGES * 64];
+    const unsigned char *messages[BATCH_MESSAGES];
+    unsigned long long sizes[BATCH_MESSAGES];
+    unsigned char expected[64];
+
+    for (unsigned long long i = 0; i < sizeof(message); i++)
+    {
+        message[i] = (unsigned char) (i * 17 + 5);
+    }
+
+    // sizes from empty to the whole buffer, enough bytes in total to go parallel
+    for (int i = 0; i < BATCH_MESSAGES; i++)
+    {
+        messages[i] = message + i;
+        sizes[i]    = (unsigned long long) i * i * 13 % (BATCH_MAX_SIZE - i);
+    }
+
+    const int threads[] = { 3, 1, 0 };
+    for (unsigned long long t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+    {
+        GOST34112018_SetBatchThreads(threads[t]);
+
+        for (int hash_size = GOST34112018_Hash256; hash_size <= GOST34112018_Hash512;
+             hash_size += GOST34112018_Hash256)
+        {
+            memset(hashes, 0, sizeof(hashes));
+            GOST34112018_HashBatch(messages, sizes, BATCH_MESSAGES, hash_size, hashes);
+
+            for (int i = 0; i < BATCH_MESSAGES; i++)
+            {
+                GOST34112018_HashBytes(messages[i], sizes[i], hash_size, expected);
+                assert(BytesEqual(expected, hashes + i * hash_size, hash_size));
+            }
+        }
+    }
+
+    // a batch too small to be split
+    GOST34112018_HashBatch(messages, sizes, 2, GOST34112018_Hash256, hashes);
+    GOST34112018_HashBytes(messages[1], sizes[1], GOST34112018_Hash256, expected);
+    assert(BytesEqual(expected, hashes + GOST34112018_Hash256, GOST34112018_Hash256));
+
+    log_d("Batch OK!");
+}
+
+enum { STORE_STREAMS = 6, STORE_MAX_SIZE = 5 * 64 + 63 };
+
+void TestStore(void)
+{
+    static unsigned char messages[STORE_STREAMS][STORE_MAX_SIZE];
+    struct GOST34112018_StoreBlock blocks[STORE_STREAMS * 5];
+    unsigned long long sizes[STORE_STREAMS];
+    unsigned long long fed[STORE_STREAMS] = { 0 };
+    int streams[STORE_STREAMS];
+    unsigned char expected[64];
+    unsigned char hash[64];
+
+    struct GOST34112018_Store *store = GOST34112018_StoreCreate(STORE_STREAMS);
+    assert(store);
+
+    for (int s = 0; s < STORE_STREAMS; s++)
+    {
+        sizes[s] = (s * 97 + 3 * 64) % STORE_MAX_SIZE;
+        for (unsigned long long i = 0; i < sizes[s]; i++)
+        {
+            messages[s][i] = (unsigned char) (i * 13 + s);
+        }
+
+        streams[s] = GOST34112018_StoreOpen(store, s % 2 ? GOST34112018_Hash256
+                                                         : GOST34112018_Hash512);
+        assert(streams[s] >= 0);
+    }
+
+    int rc = GOST34112018_StoreOpen(store, GOST34112018_Hash256);
+    assert(rc == -1);
+    (void) rc;
+
+    // round-robin over the streams, two blocks in a row of the stream 1, so the batch
+    // has both interleaved and chained blocks
+    int count = 0;
+    for (int round = 0; round < 5; round++)
+    {
+        for (int s = 0; s < STORE_STREAMS; s++)
+        {
+            for (int r = 0; r < (s == 1 ? 2 : 1) && fed[s] + 64 <= sizes[s]; r++)
+            {
+                blocks[count].stream = streams[s];
+                blocks[count].block  = messages[s] + fed[s];
+                fed[s] += 64;
+                count++;
+            }
+        }
+    }
+
+    // the state is kept between the batches
+    GOST34112018_StoreUpdate(store, blocks, count / 2);
+    GOST34112018_StoreUpdate(store, blocks + count / 2, count - count / 2);
+
+    for (int s = 0; s < STORE_STREAMS; s++)
+    {
+        const GOST34112018_HashSize_t hash_size = s % 2 ? GOST34112018_Hash256
+                                                        : GOST34112018_Hash512;
+
+        GOST34112018_StoreFinish(store, streams[s], messages[s] + fed[s], sizes[s] - fed[s],
+                                 hash);
+        GOST34112018_HashBytes(messages[s], sizes[s], hash_size, expected);
+        assert(BytesEqual(expected, hash, hash_size));
+    }
+
+    // finished streams are reused
+    const int stream = GOST34112018_StoreOpen(store, GOST34112018_Hash256);
+    assert(stream >= 0);
+    GOST34112018_StoreFinish(store, stream, NULL, 0, hash);
+    GOST34112018_HashBytes(NULL, 0, GOST34112018_Hash256, expected);
+    assert(BytesEqual(expected, hash, GOST34112018_Hash256));
+
+    // closed and unknown streams and a full-block tail are ignored
+    const struct GOST34112018_StoreBlock bad[2] = { { stream, messages[0] },
+                                                    { STORE_STREAMS, messages[0] } };
+    GOST34112018_StoreUpdate(store, bad, 2);
+
+    memset(hash, 0xaa, sizeof(hash));
+    memset(expected, 0xaa, sizeof(expected));
+    GOST34112018_StoreFinish(store, stream, NULL, 0, hash);
+    GOST34112018_StoreFinish(store, STORE_STREAMS, NULL, 0, hash);
+
+    const int opened = GOST34112018_StoreOpen(store, GOST34112018_Hash512);
+    assert(opened >= 0);
+    GOST34112018_StoreFinish(store, opened, messages[0], 64, hash);
+    assert(BytesEqual(expected, hash, sizeof(hash)));
+    GOST34112018_StoreClose(store, opened);
+
+    GOST34112018_StoreDestroy(store);
+
+    log_d("Store OK!");
+}
+
+enum { CDC_SIZE = 1 << 18, CDC_INSERT = 10, CDC_MIN = 256, CDC_AVG = 1024, CDC_MAX = 8192 };
+
+void TestChunker(void)
+{
+    static unsigned char message[CDC_SIZE + CDC_INSERT];
+    static unsigned char edited[CDC_SIZE + CDC_INSERT];
+    static struct GOST34112018_Chunk chunks[CDC_SIZE / CDC_MIN + 1];
+    static struct GOST34112018_Chunk edited_chunks[(CDC_SIZE + CDC_INSERT) / CDC_MIN + 1];
+    struct GOST34112018_Chunker chunker;
+    unsigned char expected[64];
+    unsigned long long x = 88172645463325252ull;
+
+    int rc = GOST34112018_ChunkerInit(&chunker, CDC_MIN, 1000, CDC_MAX);
+    assert(rc == EINVAL);
+    rc = GOST34112018_ChunkerInit(&chunker, CDC_AVG * 2, CDC_AVG, CDC_MAX);
+    assert(rc == EINVAL);
+    rc = GOST34112018_ChunkerInit(&chunker, CDC_MIN, CDC_AVG, CDC_MAX);
+    assert(rc == 0);
+    (void) rc;
+
+    for (unsigned long long i = 0; i < sizeof(message); i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        message[i] = (unsigned char) x;
+    }
+
+    const long long count = GOST34112018_ChunkAndHash(&chunker, message, CDC_SIZE,
+                                                      GOST34112018_Hash256, chunks);
+    assert(count > CDC_SIZE / CDC_MAX && count <= CDC_SIZE / CDC_MIN + 1);
+
+    unsigned long long offset = 0;
+    for (long long i = 0; i < count; i++)
+    {
+        assert(chunks[i].offset == offset);
+        assert(chunks[i].size <= CDC_MAX && (chunks[i].size > CDC_MIN || i + 1 == count));
+        offset += chunks[i].size;
+
+        GOST34112018_HashBytes(message + chunks[i].offset, chunks[i].size,
+                               GOST34112018_Hash256, expected);
+        assert(BytesEqual(expected, chunks[i].hash, GOST34112018_Hash256));
+    }
+    assert(offset == CDC_SIZE);
+
+    // without a boundary in the data the chunk goes on
+    assert(GOST34112018_ChunkBoundary(&chunker, message, chunks[0].size - 1) ==
+           chunks[0].size - 1);
+
+    // an insertion only changes the chunks around it
+    memcpy(edited, message, CDC_SIZE / 2);
+    memcpy(edited + CDC_SIZE / 2 + CDC_INSERT, message + CDC_SIZE / 2, CDC_SIZE / 2);
+    memset(edited + CDC_SIZE / 2, 0xa5, CDC_INSERT);
+
+    const long long edited_count = GOST34112018_ChunkAndHash(&chunker, edited,
+                                                             CDC_SIZE + CDC_INSERT,
+                                                             GOST34112018_Hash256,
+                                                             edited_chunks);
+    long long changed = 0;
+    for (long long i = 0; i < edited_count; i++)
+    {
+        long long j = 0;
+        while (j < count && !BytesEqual(chunks[j].hash, edited_chunks[i].hash,
+                                        GOST34112018_Hash256))
+        {
+            j++;
+        }
+        changed += j == count;
+    }
+    // a new boundary near the insertion may hide the next old one behind min_size, the
+    // chunks take a few boundaries to fall back into step
+    assert(changed >= 1 && changed <= 8);
+    (void) changed;
+
+    const long long empty_count = GOST34112018_ChunkAndHash(&chunker, message, 0,
+                                                            GOST34112018_Hash256, chunks);
+    assert(empty_count == 0);
+    (void) empty_count;
+
+    log_d("Chunker OK!");
+}
+
+static void RemoveObject(struct GOST34112018_Cas *cas, const unsigned char *digest)
+{
+    char path[256];
+
+    GOST34112018_CasPath(cas, digest, path, sizeof(path));
+    remove(path);
+    *strrchr(path, '/') = '\0';
+    remove(path);
+}
+
+static void CountDamaged(const char *object, int status, void *user_data)
+{
+    (void) object;
+    (void) status;
+    (*(int *) user_data)++;
+}
+
+void TestCas(void)
+{
+    static const unsigned char blob[] = "content-addressable";
+    char root[] = "/tmp/gost34112018_cas_XXXXXX";
+    char path[256];
+    unsigned char digest[32];
+    unsigned char expected[32];
+    unsigned char read_back[sizeof(blob)];
+    unsigned long long checked = 0;
+    int pipe_fds[2];
+    int damaged = 0;
+    int rc;
+
+    const char *created = mkdtemp(root);
+    assert(created);
+    (void) created;
+
+    // only a store which exists is opened without the create flag
+    struct GOST34112018_Cas *cas = GOST34112018_CasOpen(root, 0);
+    assert(!cas && errno == ENOENT);
+
+    cas = GOST34112018_CasOpen(root, 1);
+    assert(cas);
+
+    GOST34112018_HashBytes(blob, sizeof(blob), GOST34112018_Hash256, expected);
+    assert(!GOST34112018_CasHas(cas, expected));
+
+    rc = GOST34112018_CasPut(cas, blob, sizeof(blob), digest);
+    assert(rc == 0);
+    assert(BytesEqual(expected, digest, sizeof(digest)));
+    assert(GOST34112018_CasHas(cas, digest));
+
+    // the same blob streamed through a descriptor lands on the same object
+    rc = pipe(pipe_fds);
+    assert(rc == 0);
+    rc = (int) write(pipe_fds[1], blob, sizeof(blob));
+    assert(rc == sizeof(blob));
+    close(pipe_fds[1]);
+
+    memset(digest, 0, sizeof(digest));
+    rc = GOST34112018_CasPutFd(cas, pipe_fds[0], digest);
+    assert(rc == 0);
+    assert(BytesEqual(expected, digest, sizeof(digest)));
+    close(pipe_fds[0]);
+
+    int fd = GOST34112018_CasGet(cas, digest);
+    assert(fd >= 0);
+    rc = (int) read(fd, read_back, sizeof(read_back));
+    assert(rc == sizeof(blob));
+    assert(BytesEqual(blob, read_back, sizeof(blob)));
+    close(fd);
+
+    rc = GOST34112018_CasPut(cas, NULL, 0, digest);
+    assert(rc == 0);
+
+    long long bad = GOST34112018_CasFsck(cas, 2, CountDamaged, &damaged, &checked);
+    assert(bad == 0 && checked == 2 && damaged == 0);
+
+    // a flipped byte is found
+    GOST34112018_CasPath(cas, expected, path, sizeof(path));
+    chmod(path, 0644);
+    fd = open(path, O_WRONLY);
+    assert(fd >= 0);
+    rc = (int) pwrite(fd, "C", 1, 0);
+    assert(rc == 1);
+    close(fd);
+
+    bad = GOST34112018_CasFsck(cas, 2, CountDamaged, &damaged, &checked);
+    assert(bad == 1 && damaged == 1);
+    (void) bad;
+
+    rc = GOST34112018_CasPath(cas, expected, path, 8);
+    assert(rc == ENAMETOOLONG);
+    (void) rc;
+
+    RemoveObject(cas, expected);
+    RemoveObject(cas, digest);
+    GOST34112018_CasClose(cas);
+
+    snprintf(path, sizeof(path), "%s/objects", root);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/tmp", root);
+    remove(path);
+    remove(root);
+
+    log_d("Cas OK!");
+}
+
+enum { DELTA_SIZE = 100000, DELTA_BLOCK = 512, DELTA_STRONG = 8 };
+
+/**
+    Applies the instructions of a delta to the basis, counting the bytes of the basis.
+ */
+struct DeltaPatch
+{
+    const unsigned char *basis;
+    unsigned char       *out;
+    unsigned long long   size;
+    unsigned long long   copied;
+    int                  ops;
+};
+
+static int ApplyDeltaOp(const struct GOST34112018_DeltaOp *op, void *user_data)
+{
+    struct DeltaPatch *patch = user_data;
+
+    memcpy(patch->out + patch->size, op->literal ? op->literal : patch->basis + op->offset,
+           op->size);
+    patch->size   += op->size;
+    patch->copied += op->literal ? 0 : op->size;
+    patch->ops++;
+    return 0;
+}
+
+void TestDelta(void)
+{
+    static unsigned char basis[DELTA_SIZE];
+    static unsigned char edited[DELTA_SIZE + 100];
+    static unsigned char out[DELTA_SIZE + 100];
+    static struct GOST34112018_BlockSignature blocks[DELTA_SIZE / DELTA_BLOCK + 1];
+    unsigned long long x = 88172645463325252ull;
+
+    for (unsigned long long i = 0; i < sizeof(basis); i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        basis[i] = (unsigned char) x;
+    }
+
+    long long count = GOST34112018_DeltaSignature(basis, DELTA_SIZE, DELTA_BLOCK, 33, blocks);
+    assert(count == -1 && errno == EINVAL);
+    count = GOST34112018_DeltaSignature(basis, DELTA_SIZE, DELTA_BLOCK, DELTA_STRONG, blocks);
+    assert(count == DELTA_SIZE / DELTA_BLOCK + 1);
+    (void) count;
+
+    const struct GOST34112018_Signature signature = {
+        DELTA_SIZE, DELTA_BLOCK, DELTA_STRONG, blocks
+    };
+
+    // the basis itself is one range, with the short last block
+    struct DeltaPatch patch = { basis, out, 0, 0, 0 };
+    int rc = GOST34112018_DeltaCompute(&signature, basis, DELTA_SIZE, ApplyDeltaOp, &patch);
+    assert(rc == 0 && patch.ops == 1 && patch.copied == DELTA_SIZE);
+
+    // an insertion and a changed byte cost the blocks around them
+    memcpy(edited, basis, 30000);
+    memset(edited + 30000, 0x5a, 100);
+    memcpy(edited + 30100, basis + 30000, DELTA_SIZE - 30000);
+    edited[70000] ^= 1;
+
+    memset(&patch, 0, sizeof(patch));
+    patch.basis = basis;
+    patch.out   = out;
+    rc = GOST34112018_DeltaCompute(&signature, edited, sizeof(edited), ApplyDeltaOp, &patch);
+    assert(rc == 0 && patch.size == sizeof(edited) && BytesEqual(out, edited, sizeof(edited)));
+    assert(patch.copied >= DELTA_SIZE - 3 * DELTA_BLOCK);
+
+    // a message shorter than a block is a literal
+    memset(&patch, 0, sizeof(patch));
+    patch.basis = basis;
+    patch.out   = out;
+    rc = GOST34112018_DeltaCompute(&signature, edited, 100, ApplyDeltaOp, &patch);
+    assert(rc == 0 && patch.ops == 1 && patch.copied == 0 && BytesEqual(out, edited, 100));
+    (void) rc;
+
+    log_d("Delta OK!");
+}
+
 int main(int argc, char **argv)
 {
     Test();
     Test2();
     // Test3();
+    TestFixedLength();
+    TestDual();
+    TestWarmup();
+    TestProfile();
+    TestEngine();
+    TestBatch();
+    TestStore();
+    TestChunker();
+    TestCas();
+    TestDelta();
 }
 
 #else
@@ -0,0 +1,217 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    Tests of the digest cache of gost34112018_cli (--cache), built with
+    src/util/gost34112018_cli_cache.c.
+ */
+
+#include "gost34112018_cli.h"
+#include "stdio.h"
+#include "assert.h"
+#include "string.h"
+#include "errno.h"
+#include "stdlib.h"
+#include "time.h"
+#include "unistd.h"
+#include "fcntl.h"
+
+#define log_d(__fmt, ...) \
+    printf("GOST34112018 [TEST] %s " __fmt "\n", __func__,##__VA_ARGS__)
+
+// modified long before now, so it is not racy
+static const struct CacheKey KEY = {
+    .dev      = 42,
+    .ino      = 1234,
+    .size     = 4096,
+    .mtime_ns = 1000000000ull,
+    .ctime_ns = 1000000000ull,
+};
+
+static void MakePath(char *path, const size_t size)
+{
+    snprintf(path, size, "/tmp/test_gost34112018_cache.%d", (int) getpid());
+    unlink(path);
+}
+
+void TestCacheHit(void)
+{
+    char    path[64];
+    uint8_t hash256[32], hash512[64];
+    uint8_t expected256[32], expected512[64];
+
+    memset(expected256, 0x25, sizeof(expected256));
+    memset(expected512, 0x51, sizeof(expected512));
+    MakePath(path, sizeof(path));
+
+    struct DigestCache *cache = CacheOpen(path);
+    assert(cache);
+
+    bool hit = CacheLookup(cache, &KEY, hash256, NULL);
+    assert(!hit);
+
+    CacheStore(cache, &KEY, expected256, NULL);
+    hit = CacheLookup(cache, &KEY, hash256, NULL);
+    assert(hit && memcmp(hash256, expected256, sizeof(hash256)) == 0);
+
+    // only the 256-bit digest is there
+    hit = CacheLookup(cache, &KEY, NULL, hash512);
+    assert(!hit);
+
+    // the 256-bit digest of the same version is kept when the 512-bit one is stored
+    CacheStore(cache, &KEY, NULL, expected512);
+    memset(hash256, 0, sizeof(hash256));
+    hit = CacheLookup(cache, &KEY, hash256, hash512);
+    assert(hit && memcmp(hash256, expected256, sizeof(hash256)) == 0 &&
+           memcmp(hash512, expected512, sizeof(hash512)) == 0);
+
+    // the digests survive the reopening
+    CacheClose(cache);
+    cache = CacheOpen(path);
+    assert(cache);
+
+    memset(hash512, 0, sizeof(hash512));
+    hit = CacheLookup(cache, &KEY, NULL, hash512);
+    assert(hit && memcmp(hash512, expected512, sizeof(hash512)) == 0);
+    (void) hit;
+
+    CacheClose(cache);
+    unlink(path);
+    log_d("OK");
+}
+
+void TestCacheVersion(void)
+{
+    char    path[64];
+    uint8_t hash256[32], hash512[64];
+    uint8_t expected256[32], expected512[64];
+
+    memset(expected256, 0x25, sizeof(expected256));
+    memset(expected512, 0x51, sizeof(expected512));
+    MakePath(path, sizeof(path));
+
+    struct DigestCache *cache = CacheOpen(path);
+    assert(cache);
+
+    CacheStore(cache, &KEY, expected256, NULL);
+
+    struct CacheKey changed = KEY;
+    changed.mtime_ns += 1;
+    bool hit = CacheLookup(cache, &changed, hash256, NULL);
+    assert(!hit);
+
+    changed = KEY;
+    changed.size += 1;
+    hit = CacheLookup(cache, &changed, hash256, NULL);
+    assert(!hit);
+
+    changed = KEY;
+    changed.ctime_ns += 1;
+    hit = CacheLookup(cache, &changed, hash256, NULL);
+    assert(!hit);
+
+    // another file is a miss too
+    changed = KEY;
+    changed.ino += 1;
+    hit = CacheLookup(cache, &changed, hash256, NULL);
+    assert(!hit);
+
+    // a new version replaces the digests of the old one, they are not mixed
+    changed = KEY;
+    changed.mtime_ns += 1;
+    CacheStore(cache, &changed, NULL, expected512);
+    hit = CacheLookup(cache, &changed, NULL, hash512);
+    assert(hit && memcmp(hash512, expected512, sizeof(hash512)) == 0);
+    hit = CacheLookup(cache, &changed, hash256, NULL);
+    assert(!hit);
+    hit = CacheLookup(cache, &KEY, NULL, hash512);
+    assert(!hit);
+    (void) hit;
+
+    CacheClose(cache);
+    unlink(path);
+    log_d("OK");
+}
+
+void TestCacheRacy(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    const uint64_t now = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+
+    struct CacheKey key = KEY;
+    bool racy = CacheKeyIsRacy(&key);
+    assert(!racy);
+
+    key.mtime_ns = now;
+    racy = CacheKeyIsRacy(&key);
+    assert(racy);
+
+    // a change of the inode alone, e.g. chmod, is racy as well
+    key.mtime_ns = KEY.mtime_ns;
+    key.ctime_ns = now;
+    racy = CacheKeyIsRacy(&key);
+    assert(racy);
+    (void) racy;
+
+    log_d("OK");
+}
+
+void TestCacheOpenInvalid(void)
+{
+    char path[64];
+
+    MakePath(path, sizeof(path));
+
+    struct DigestCache *cache = CacheOpen(path);
+    assert(cache);
+    CacheClose(cache);
+
+    int fd = open(path, O_WRONLY);
+    assert(fd >= 0);
+
+    // a wrong magic
+    ssize_t written = pwrite(fd, "GOSTXX01", 8, 0);
+    assert(written == 8);
+    errno = 0;
+    cache = CacheOpen(path);
+    assert(!cache && errno == EINVAL);
+
+    // a wrong size
+    written = pwrite(fd, "GOSTDC01", 8, 0);
+    assert(written == 8);
+    cache = CacheOpen(path);
+    assert(cache);
+    CacheClose(cache);
+
+    struct stat st;
+    int rc = fstat(fd, &st);
+    assert(rc == 0);
+    rc = ftruncate(fd, st.st_size - 1);
+    assert(rc == 0);
+    errno = 0;
+    cache = CacheOpen(path);
+    assert(!cache && errno == EINVAL);
+
+    // shorter than the header
+    rc = ftruncate(fd, 16);
+    assert(rc == 0);
+    errno = 0;
+    cache = CacheOpen(path);
+    assert(!cache && errno == EINVAL);
+    (void) written;
+    (void) rc;
+
+    close(fd);
+    unlink(path);
+    log_d("OK");
+}
+
+int main(int argc, char **argv)
+{
+    TestCacheHit();
+    TestCacheVersion();
+    TestCacheRacy();
+    TestCacheOpenInvalid();
+}
@@ -6,22 +6,16 @@
     given data.
  */
 
-#include "gost34112018.h"
-#include "stdio.h"
-#include "stdint.h"
+#include "gost34112018_cli.h"
 #include "errno.h"
 #include "stdlib.h"
 #include "argp.h"
-#include "stdbool.h"
+#include "string.h"
+#include "ctype.h"
+#include "unistd.h"
 #include "sys/resource.h"
 #include <time.h>
 
-#define log_err(__fmt, ...) \
-    fprintf(stderr, "[ERROR, %s] " __fmt "\n", __func__, ##__VA_ARGS__)
-
-#define log_debug(__fmt, ...) \
-    fprintf(stdout, "[DEBUG, %s] " __fmt "\n", __func__, ##__VA_ARGS__)
-
 const char *argp_application_version = "gost34112018_cli ver. 0.1";
 const char *argp_application_bug_address = "anufriewwi@rambler.ru";
 
@@ -29,12 +23,40 @@ int g_opt_hash_size     = 512;
 bool g_opt_big_endian   = false;
 bool g_opt_no_nline     = false;
 bool g_opt_file_mode    = false;
+bool g_opt_stats        = false;
+bool g_opt_tar          = false;
+Records_t g_opt_records = RECORDS_NONE;
+int g_opt_jobs          = 1;
+bool g_opt_rehash       = false;
+bool g_opt_index        = false;
+int g_opt_debounce_ms   = 500;
 char *g_filename        = NULL;
+char *g_daemon_socket   = NULL;
+char *g_cache_path      = NULL;
+char *g_watch_root      = NULL;
+char *g_cas_root        = NULL;
+bool g_opt_delta        = false;
+unsigned long long g_opt_block_size = 0;
+
+struct GOST34112018_Chunker g_chunker;
+char **g_files          = NULL;
+int g_file_count        = 0;
 
 enum
 {
-    INTERNAL_BUFFER_SIZE = 65536,
-    BLOCK_SIZE = 64,
+    OPTION_STATS = 0x100, // long-only options
+    OPTION_RECORDS,
+    OPTION_TAR,
+    OPTION_DAEMON,
+    OPTION_CACHE,
+    OPTION_REHASH,
+    OPTION_INDEX,
+    OPTION_WATCH,
+    OPTION_DEBOUNCE,
+    OPTION_CDC,
+    OPTION_CAS,
+    OPTION_DELTA,
+    OPTION_BLOCK_SIZE,
 };
 
 static struct argp_option options[] = {
@@ -43,7 +65,9 @@ static struct argp_option options[] = {
         's',
         "HASH_SIZE",
         0,
-        "Size of the hash (256 or 512). 512 by default.",
+        "Size of the hash (256, 512 or both). 512 by default. With 'both' the two "
+        "digests are computed in a single pass and printed on separate lines, the "
+        "256-bit one first.",
         0
     },
     {
@@ -70,13 +94,159 @@ static struct argp_option options[] = {
         "Compute hash of the file with name FILENAME.",
         0
     },
+    {
+        "stats",
+        OPTION_STATS,
+        0,
+        0,
+        "Print throughput, time spent in reads versus hashing, histogram of read "
+        "sizes and peak RSS to stderr.",
+        0
+    },
+    {
+        "records",
+        OPTION_RECORDS,
+        "FORMAT",
+        0,
+        "Hash every record of the input separately and print one digest per line, in "
+        "the order of the input. FORMAT is 'lines' ('\\n'-terminated), 'nul' "
+        "('\\0'-terminated) or 'u32le' (every record is prefixed with its 32-bit "
+        "little-endian length). With '-s both' a line holds both digests, separated "
+        "by a space.",
+        0
+    },
+    {
+        "jobs",
+        'j',
+        "N",
+        0,
+        "Number of threads hashing records in --records mode or FILE arguments, 0 for "
+        "the number of online CPUs. 1 by default.",
+        0
+    },
+    {
+        "tar",
+        OPTION_TAR,
+        0,
+        0,
+        "The input is a tar archive (ustar, pax or GNU). Print a manifest line "
+        "'DIGEST  PATH' for every regular file in it, without extracting, followed by "
+        "the digest of the whole archive.",
+        0
+    },
+    {
+        "daemon",
+        OPTION_DAEMON,
+        "SOCKET",
+        0,
+        "Serve hashing requests of the client library (gost34112018_client.h) on the "
+        "Unix domain socket SOCKET with -j workers, until SIGINT or SIGTERM.",
+        0
+    },
+    {
+        "cache",
+        OPTION_CACHE,
+        "CACHE_FILE",
+        0,
+        "Keep digests of FILE arguments in CACHE_FILE, keyed by device, inode, size, "
+        "mtime and ctime. Files which have not changed since they were cached are not "
+        "read. The file is created if it does not exist.",
+        0
+    },
+    {
+        "rehash",
+        OPTION_REHASH,
+        0,
+        0,
+        "With --cache or --index, hash all of the files anyway and update the cache "
+        "or the indexes.",
+        0
+    },
+    {
+        "index",
+        OPTION_INDEX,
+        0,
+        0,
+        "Hash FILE arguments by 1 MiB chunks and print the digest of the chunk digests. "
+        "The chunk digests are saved to FILE.gidx, and only the chunks which have "
+        "changed since are hashed on the next run. Changes are found by seeded 64-bit "
+        "fingerprints, which are not cryptographic: use --rehash where a chunk may be "
+        "forged to collide.",
+        0
+    },
+    {
+        "watch",
+        OPTION_WATCH,
+        "DIR",
+        0,
+        "Monitor the directory tree DIR until SIGINT or SIGTERM: hash its files, then "
+        "rehash every file which has been closed after writing, with -j workers. "
+        "SIGUSR1 prints the digests, SIGUSR2 the changes since the previous SIGUSR2. "
+        "--cache is used for the first scan.",
+        0
+    },
+    {
+        "debounce",
+        OPTION_DEBOUNCE,
+        "MS",
+        0,
+        "With --watch, hash a written file only after it has been left alone for MS "
+        "milliseconds. 500 by default.",
+        0
+    },
+    {
+        "cdc",
+        OPTION_CDC,
+        "AVG_SIZE",
+        0,
+        "Split the input into content-defined chunks (FastCDC) of AVG_SIZE bytes on "
+        "average, a power of two (from AVG_SIZE/4 to 8*AVG_SIZE bytes), and print a "
+        "line 'OFFSET SIZE DIGEST' per chunk. The chunks are hashed by -j threads like "
+        "--records.",
+        0
+    },
+    {
+        "cas",
+        OPTION_CAS,
+        "STORE",
+        0,
+        "Content-addressable store of blobs named by their 256-bit digests. The "
+        "arguments are a command: 'put [FILE...]' stores the files (stdin without "
+        "FILE) and prints their digests, 'get DIGEST' writes a blob to stdout, "
+        "'has DIGEST...' prints the digests which are not in the store, 'fsck' "
+        "rehashes every blob with -j threads and prints the damaged ones.",
+        0
+    },
+    {
+        "delta",
+        OPTION_DELTA,
+        0,
+        0,
+        "rsync-style deltas of local files, with truncated 256-bit digests as the strong "
+        "block checksums. The arguments are a command: 'signature BASIS SIG' writes the "
+        "signature of the old file, 'delta SIG FILE DELTA' the delta of the new file "
+        "against it, 'patch BASIS DELTA OUT' rebuilds the new file and checks its digest.",
+        0
+    },
+    {
+        "block-size",
+        OPTION_BLOCK_SIZE,
+        "BYTES",
+        0,
+        "Block size of --delta signature. About the square root of the file size by "
+        "default.",
+        0
+    },
     {0}
 };
 
 static error_t parse_opt(int key, char *arg, struct argp_state *state) {
     switch (key) {
         case 's':
-            sscanf(arg, "%d", &g_opt_hash_size);
+            if (strcmp(arg, "both") == 0)
+                g_opt_hash_size = HASH_SIZE_BOTH;
+            else
+                sscanf(arg, "%d", &g_opt_hash_size);
             break;
         case 'b':
             g_opt_big_endian = true;
@@ -88,123 +258,509 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
             g_opt_file_mode = true;
             g_filename = arg;
             break;
+        case OPTION_STATS:
+            g_opt_stats = true;
+            break;
+        case OPTION_RECORDS:
+            if (strcmp(arg, "lines") == 0)
+                g_opt_records = RECORDS_LINES;
+            else if (strcmp(arg, "nul") == 0)
+                g_opt_records = RECORDS_NUL;
+            else if (strcmp(arg, "u32le") == 0)
+                g_opt_records = RECORDS_U32LE;
+            else
+                return EINVAL;
+            break;
+        case OPTION_TAR:
+            g_opt_tar = true;
+            break;
+        case OPTION_DAEMON:
+            g_daemon_socket = arg;
+            break;
+        case 'j':
+            sscanf(arg, "%d", &g_opt_jobs);
+            if (g_opt_jobs == 0)
+                g_opt_jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+            break;
+        case OPTION_CACHE:
+            g_cache_path = arg;
+            break;
+        case OPTION_REHASH:
+            g_opt_rehash = true;
+            break;
+        case OPTION_INDEX:
+            g_opt_index = true;
+            break;
+        case OPTION_WATCH:
+            g_watch_root = arg;
+            break;
+        case OPTION_CDC:
+        {
+            unsigned long long avg_size = 0;
+            if (sscanf(arg, "%llu", &avg_size) != 1 ||
+                GOST34112018_ChunkerInit(&g_chunker, avg_size / 4, avg_size, avg_size * 8) != 0)
+                return EINVAL;
+            g_opt_records = RECORDS_CDC;
+            break;
+        }
+        case OPTION_CAS:
+            g_cas_root = arg;
+            break;
+        case OPTION_DELTA:
+            g_opt_delta = true;
+            break;
+        case OPTION_BLOCK_SIZE:
+            if (sscanf(arg, "%llu", &g_opt_block_size) != 1 || g_opt_block_size == 0)
+                return EINVAL;
+            break;
+        case OPTION_DEBOUNCE:
+            if (sscanf(arg, "%d", &g_opt_debounce_ms) != 1 || g_opt_debounce_ms < 0)
+                return EINVAL;
+            break;
+        case ARGP_KEY_ARG:
+            // all of the remaining arguments are files
+            g_files      = &state->argv[state->next - 1];
+            g_file_count = state->argc - state->next + 1;
+            state->next  = state->argc;
+            break;
         default:
             return ARGP_ERR_UNKNOWN;
     }
     return 0;
 }
 
+void HasherInit(struct Hasher *hasher)
+{
+    hasher->dual = g_opt_hash_size == HASH_SIZE_BOTH;
+
+    if (hasher->dual)
+        GOST34112018_InitDualContext(&hasher->dual_ctx);
+    else
+        GOST34112018_InitContext(&hasher->ctx, (GOST34112018_HashSize_t) (g_opt_hash_size / 8));
+}
+
+void HasherBlock(struct Hasher *hasher, const uint8_t *block, const uint64_t size)
+{
+    if (hasher->dual)
+        GOST34112018_HashBlockDual(block, size, &hasher->dual_ctx);
+    else
+        GOST34112018_HashBlock(block, size, &hasher->ctx);
+}
+
+void HasherUpdate(struct Hasher *hasher, const uint8_t *data, const uint64_t size)
+{
+    uint64_t i = 0;
+
+    for (; i + BLOCK_SIZE <= size; i += BLOCK_SIZE)
+        HasherBlock(hasher, data + i, BLOCK_SIZE);
+
+    if (i < size)
+        HasherBlock(hasher, data + i, size - i);
+}
+
+void HasherEnd(struct Hasher *hasher)
+{
+    if (hasher->dual)
+        GOST34112018_HashBlockEndDual(&hasher->dual_ctx);
+    else
+        GOST34112018_HashBlockEnd(&hasher->ctx);
+}
+
+int HasherFormat(const struct Hasher *hasher, char *out)
+{
+    uint8_t hash[BLOCK_SIZE];
+    uint8_t hash256[BLOCK_SIZE / 2];
+
+    if (!hasher->dual)
+    {
+        GOST34112018_GetHashFromContext(&hasher->ctx, hash);
+        return FormatHash(out, hash, hasher->ctx.hash_size);
+    }
+
+    GOST34112018_GetHashesFromDualContext(&hasher->dual_ctx, hash256, hash);
+
+    int length = FormatHash(out, hash256, sizeof(hash256));
+    out[length++] = ' ';
+    return length + FormatHash(out + length, hash, sizeof(hash));
+}
+
+int FormatHash(char *out, const uint8_t *hash, const int size)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    for (int i = 0; i < size; i++)
+    {
+        const uint8_t byte = g_opt_big_endian ? hash[size - 1 - i] : hash[i];
+        out[2 * i]     = digits[byte >> 4];
+        out[2 * i + 1] = digits[byte & 0x0f];
+    }
+    out[2 * size] = '\0';
+
+    return 2 * size;
+}
+
+bool ParseHash(const char *hex, uint8_t *hash, const int size)
+{
+    if (strlen(hex) != 2 * (size_t) size)
+        return false;
+
+    for (int i = 0; i < size; i++)
+    {
+        unsigned int byte;
+        if (!isxdigit((unsigned char) hex[2 * i]) || !isxdigit((unsigned char) hex[2 * i + 1]) ||
+            sscanf(hex + 2 * i, "%2x", &byte) != 1)
+            return false;
+
+        hash[g_opt_big_endian ? size - 1 - i : i] = (uint8_t) byte;
+    }
+
+    return true;
+}
+
+static void PrintHash(const uint8_t *hash, const int size, const bool newline)
+{
+    char hex[HASH_HEX_MAX];
+
+    FormatHash(hex, hash, size);
+    fputs(hex, stdout);
+
+    if (newline)
+    {
+        putc('\n', stdout);
+    }
+}
+
+uint64_t StatsNow(void)
+{
+    struct timespec ts;
+
+    if (!g_opt_stats)
+        return 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+void StatsAddRead(struct Stats *stats, const size_t size, const uint64_t ns)
+{
+    int bucket = 0;
+
+    for (size_t s = size; s != 0 && bucket < READ_SIZE_BUCKETS - 1; s >>= 1)
+        bucket++;
+
+    stats->bytes   += size;
+    stats->reads   += 1;
+    stats->read_ns += ns;
+    stats->read_sizes[bucket]++;
+}
+
+int JobCount(void)
+{
+    if (g_opt_jobs < 1)
+        return 1;
+
+    return g_opt_jobs < MAX_JOBS ? g_opt_jobs : MAX_JOBS;
+}
+
+ssize_t ReadInput(FILE *fin, uint8_t *buffer, const size_t size, struct Stats *stats)
+{
+    size_t done = 0;
+
+    if (!g_opt_stats)
+    {
+        done = fread(buffer, 1, size, fin);
+        StatsAddRead(stats, done, 0);
+        return done < size && ferror(fin) ? -1 : (ssize_t) done;
+    }
+
+    // stdio would hide the sizes of the reads behind its buffer
+    while (done < size)
+    {
+        const uint64_t t0 = StatsNow();
+        const ssize_t  n  = read(fileno(fin), buffer + done, size - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+
+        StatsAddRead(stats, n, StatsNow() - t0);
+        if (n == 0)
+            break;
+        done += n;
+    }
+
+    return done;
+}
+
+static void StatsPrint(const struct Stats *stats)
+{
+    struct rusage usage;
+
+    const double wall = (StatsNow() - stats->start_ns) / 1e9;
+    const double read = stats->read_ns / 1e9;
+    const double hash = stats->hash_ns / 1e9;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(stderr, "bytes:        %llu\n", (unsigned long long) stats->bytes);
+    fprintf(stderr, "wall time:    %.6f s\n", wall);
+    fprintf(stderr, "throughput:   %.2f MB/s\n", wall > 0.0 ? stats->bytes / wall / 1e6 : 0.0);
+    fprintf(stderr, "read time:    %.6f s (%.1f%%)\n", read, wall > 0.0 ? 100.0 * read / wall : 0.0);
+    fprintf(stderr, "hash time:    %.6f s (%.1f%%)\n", hash, wall > 0.0 ? 100.0 * hash / wall : 0.0);
+    fprintf(stderr, "cpu time:     %.6f s user, %.6f s system\n",
+            usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6,
+            usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6);
+    fprintf(stderr, "peak rss:     %ld KiB\n", usage.ru_maxrss);
+    if (stats->records)
+    {
+        fprintf(stderr, "records:      %llu (%.0f records/s)\n",
+                (unsigned long long) stats->records, wall > 0.0 ? stats->records / wall : 0.0);
+    }
+    if (stats->files)
+    {
+        fprintf(stderr, "files:        %llu (%llu from the cache)\n",
+                (unsigned long long) stats->files, (unsigned long long) stats->cache_hits);
+    }
+    if (stats->chunks)
+    {
+        fprintf(stderr, "chunks:       %llu (%llu unchanged)\n",
+                (unsigned long long) stats->chunks, (unsigned long long) stats->chunks_reused);
+    }
+    fprintf(stderr, "reads:        %llu\n", (unsigned long long) stats->reads);
+
+    for (int i = 0; i < READ_SIZE_BUCKETS; i++)
+    {
+        if (!stats->read_sizes[i])
+            continue;
+
+        const unsigned long long low  = i ? 1ull << (i - 1) : 0;
+        const unsigned long long high = i ? (1ull << i) - 1 : 0;
+
+        // the last bucket takes every larger read
+        if (i == READ_SIZE_BUCKETS - 1)
+            fprintf(stderr, "  %6llu -   more: %llu\n", low,
+                    (unsigned long long) stats->read_sizes[i]);
+        else
+            fprintf(stderr, "  %6llu - %6llu: %llu\n", low, high,
+                    (unsigned long long) stats->read_sizes[i]);
+    }
+}
+
 int main(int argc, char **argv)
 {
     FILE *fin = NULL;
 
     int32_t rc = 0;
     uint8_t hash[BLOCK_SIZE];
+    uint8_t hash256[BLOCK_SIZE / 2];
     static uint8_t buffer[INTERNAL_BUFFER_SIZE];
-    struct GOST34112018_Context ctx;
+    static struct Hasher hasher;
+    struct Stats stats = { 0 };
+    uint64_t t0;
 
-    struct argp argp = { options, parse_opt, "[ARGS...]", "My program description.", 0, 0, 0 };
+    struct argp argp = { options, parse_opt, "[FILE...]", "My program description.", 0, 0, 0 };
     error_t argp_error = argp_parse(&argp, argc, argv, 0, 0, 0);
     if (argp_error != 0)
     {
         exit(EINVAL);
     }
 
-    if (g_opt_file_mode)
+    stats.start_ns = StatsNow();
+
+    if (g_daemon_socket)
     {
-        fin = fopen(g_filename, "rb");
-        if (!fin)
+        return RunDaemon(g_daemon_socket);
+    }
+
+    if (g_opt_hash_size != 512 && g_opt_hash_size != 256 && g_opt_hash_size != HASH_SIZE_BOTH)
+    {
+        log_err("Unsupported hash size");
+        exit(EINVAL);
+    }
+
+    if (g_cas_root)
+    {
+        if (g_opt_file_mode || g_opt_records != RECORDS_NONE || g_opt_tar || g_opt_index ||
+            g_cache_path || g_watch_root || g_opt_delta)
         {
-            fprintf(stderr, "Could not open file %s", g_filename);
-            exit(ENOENT);
+            log_err("--cas can not be combined with -f, --records, --cdc, --tar, --index, "
+                    "--cache, --watch or --delta");
+            exit(EINVAL);
         }
+
+        return RunCas(g_cas_root, g_files, g_file_count);
     }
-    else
+
+    if (g_opt_delta)
     {
-        fin = stdin;
+        if (g_opt_file_mode || g_opt_records != RECORDS_NONE || g_opt_tar || g_opt_index ||
+            g_cache_path || g_watch_root)
+        {
+            log_err("--delta can not be combined with -f, --records, --cdc, --tar, --index, "
+                    "--cache or --watch");
+            exit(EINVAL);
+        }
+
+        return RunDelta(g_files, g_file_count);
     }
 
-    if (g_opt_hash_size == 512)
+    if (g_watch_root)
     {
-        GOST34112018_InitContext(&ctx, GOST34112018_Hash512);
+        struct DigestCache *cache = NULL;
+
+        if (g_file_count > 0 || g_opt_file_mode || g_opt_records != RECORDS_NONE || g_opt_tar ||
+            g_opt_index)
+        {
+            log_err("--watch can not be combined with FILE arguments, -f, --records, --tar "
+                    "or --index");
+            exit(EINVAL);
+        }
+
+        if (g_cache_path && !(cache = CacheOpen(g_cache_path)))
+        {
+            log_err("Could not open the cache %s: %s", g_cache_path, strerror(errno));
+            exit(errno);
+        }
+
+        rc = RunWatch(g_watch_root, cache);
+        CacheClose(cache);
+        return rc;
     }
-    else if (g_opt_hash_size == 256)
+
+    if (g_file_count > 0 || g_cache_path || g_opt_index)
     {
-        GOST34112018_InitContext(&ctx, GOST34112018_Hash256);
+        struct DigestCache *cache = NULL;
+
+        if (g_file_count == 0 || g_opt_file_mode || g_opt_records != RECORDS_NONE || g_opt_tar)
+        {
+            log_err("--cache and --index need FILE arguments, which can not be combined "
+                    "with -f, --records or --tar");
+            exit(EINVAL);
+        }
+
+        if (g_opt_index && (g_cache_path || g_opt_hash_size == HASH_SIZE_BOTH))
+        {
+            log_err("--index can not be combined with --cache or -s both");
+            exit(EINVAL);
+        }
+
+        // threads which are not busy with files of their own hash chunks of a file
+        const int jobs = JobCount();
+        GOST34112018_SetBatchThreads(jobs / (g_file_count < jobs ? g_file_count : jobs));
+
+        if (g_cache_path && !(cache = CacheOpen(g_cache_path)))
+        {
+            log_err("Could not open the cache %s: %s", g_cache_path, strerror(errno));
+            exit(errno);
+        }
+
+        rc = HashFiles(g_files, g_file_count, cache, &stats);
+        CacheClose(cache);
+
+        if (g_opt_stats)
+        {
+            StatsPrint(&stats);
+        }
+
+        return rc;
+    }
+
+    if (g_opt_file_mode)
+    {
+        fin = fopen(g_filename, "rb");
+        if (!fin)
+        {
+            fprintf(stderr, "Could not open file %s", g_filename);
+            exit(ENOENT);
+        }
     }
     else
     {
-        log_err("Unsupported hash size");
-        exit(EINVAL);
+        fin = stdin;
     }
 
-    while (!feof(fin))
+    HasherInit(&hasher);
+
+    if (g_opt_records != RECORDS_NONE || g_opt_tar)
     {
-        rc = fread(buffer + rc, 1, INTERNAL_BUFFER_SIZE - rc, fin);
-        if (rc < 0 && (errno == EINTR))
+        if (g_opt_tar)
+            rc = HashTar(fin, g_opt_file_mode ? g_filename : "-", &stats);
+        else
+            rc = HashRecords(fin, &stats);
+
+        if (g_opt_file_mode)
+            fclose(fin);
+
+        if (g_opt_stats)
         {
-            continue;
+            StatsPrint(&stats);
         }
 
+        return rc;
+    }
+
+    for (;;)
+    {
+        rc = ReadInput(fin, buffer, INTERNAL_BUFFER_SIZE, &stats);
         if (rc < 0)
         {
             log_err("An error occurred while trying to read data");
             exit(EIO);
         }
 
-        // In some cases fread may not read all 64 bytes. This makes sure it does
+        // a short read is the end of the input, its tail is hashed below
         if (rc < INTERNAL_BUFFER_SIZE)
         {
-            continue;
+            break;
         }
 
+        t0 = StatsNow();
         for (int i = 0; i < rc; i += BLOCK_SIZE)
         {
-            GOST34112018_HashBlock(buffer + i, BLOCK_SIZE, &ctx);
+            HasherBlock(&hasher, buffer + i, BLOCK_SIZE);
         }
+        stats.hash_ns += StatsNow() - t0;
         rc = 0;
     }
 
+    t0 = StatsNow();
+
     // we hit feof, but rc is not empty
     if (rc != 0)
     {
         int i;
         for (i = 0; (i + BLOCK_SIZE) < rc; i += BLOCK_SIZE)
         {
-            GOST34112018_HashBlock(buffer + i, BLOCK_SIZE, &ctx);
+            HasherBlock(&hasher, buffer + i, BLOCK_SIZE);
         }
 
         // Hash the rest of the message
-        GOST34112018_HashBlock(buffer + i, rc - i, &ctx);
+        HasherBlock(&hasher, buffer + i, rc - i);
     }
 
     // Finish the hashing process correctly
-    GOST34112018_HashBlockEnd(&ctx);
-
-    GOST34112018_GetHashFromContext(&ctx, hash);
+    HasherEnd(&hasher);
+    stats.hash_ns += StatsNow() - t0;
 
-    if (g_opt_big_endian)
+    if (hasher.dual)
     {
-        for (int i = 0; i < (g_opt_hash_size / 8); i++)
-        {
-            printf("%02x", hash[(g_opt_hash_size / 8) - 1 - i]);
-        }
+        GOST34112018_GetHashesFromDualContext(&hasher.dual_ctx, hash256, hash);
+        PrintHash(hash256, sizeof(hash256), true);
+        PrintHash(hash, sizeof(hash), !g_opt_no_nline);
     }
     else
     {
-        for (int i = 0; i < (g_opt_hash_size / 8); i++)
-        {
-            printf("%02x", hash[i]);
-        }
-    }
-
-    if (!g_opt_no_nline)
-    {
-        putc('\n', stdout);
+        GOST34112018_GetHashFromContext(&hasher.ctx, hash);
+        PrintHash(hash, g_opt_hash_size / 8, !g_opt_no_nline);
     }
 
     if (g_opt_file_mode)
         fclose(fin);
 
+    if (g_opt_stats)
+    {
+        StatsPrint(&stats);
+    }
+
     return 0;
 }
@@ -0,0 +1,325 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    Declarations shared by the modes of gost34112018_cli. Every mode lives in its own
+    gost34112018_cli_*.c file, gost34112018_cli.c parses the options and dispatches.
+ */
+
+#ifndef __GOST34112018_CLI_H__
+#define __GOST34112018_CLI_H__
+
+#include "gost34112018.h"
+#include "stdio.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "sys/stat.h"
+
+#define log_err(__fmt, ...) \
+    fprintf(stderr, "[ERROR, %s] " __fmt "\n", __func__, ##__VA_ARGS__)
+
+#define log_debug(__fmt, ...) \
+    fprintf(stdout, "[DEBUG, %s] " __fmt "\n", __func__, ##__VA_ARGS__)
+
+enum
+{
+    INTERNAL_BUFFER_SIZE = 65536,
+    BLOCK_SIZE = 64,
+    READ_SIZE_BUCKETS = 18, // 0, 1, 2-3, ..., 32768-65535, 65536 and more
+    HASH_SIZE_BOTH = 0,     // -s both, 256- and 512-bit digests in one pass
+    HASH_HEX_MAX = 2 * (32 + 64) + 1, // hex of both digests, separated by a space
+    FILE_READ_SIZE = 1 << 20, // a multiple of BLOCK_SIZE
+    MAX_JOBS = 256,           // -j is clamped to it
+};
+
+typedef enum
+{
+    RECORDS_NONE,
+    RECORDS_LINES,  // records are terminated by '\n'
+    RECORDS_NUL,    // records are terminated by '\0'
+    RECORDS_U32LE,  // every record is prefixed with its 32-bit little-endian length
+    RECORDS_CDC,    // content-defined chunks of g_chunker, see --cdc
+} Records_t;
+
+extern int       g_opt_hash_size;
+extern bool      g_opt_big_endian;
+extern bool      g_opt_stats;
+extern Records_t g_opt_records;
+extern int       g_opt_jobs;
+extern bool      g_opt_rehash;
+extern bool      g_opt_index;
+extern int       g_opt_debounce_ms;
+extern unsigned long long g_opt_block_size;
+
+extern struct GOST34112018_Chunker g_chunker;
+
+/**
+    Either a single context, or the dual one for -s both.
+ */
+struct Hasher
+{
+    bool                            dual;
+    struct GOST34112018_Context     ctx;
+    struct GOST34112018_DualContext dual_ctx;
+};
+
+/**
+    Counters of the --stats mode.
+ */
+struct Stats
+{
+    uint64_t start_ns;
+    uint64_t bytes;
+    uint64_t reads;
+    uint64_t read_ns;
+    uint64_t hash_ns;
+    uint64_t records;
+    uint64_t files;
+    uint64_t cache_hits;
+    uint64_t chunks;
+    uint64_t chunks_reused;
+    uint64_t read_sizes[READ_SIZE_BUCKETS];
+};
+
+/**
+    Digests of a file, the ones not asked for with -s are left as they are.
+ */
+struct FileResult
+{
+    int     rc;
+    uint8_t hash256[32];
+    uint8_t hash512[64];
+};
+
+/**
+    Identity and version of a file in the digest cache of --cache.
+ */
+struct CacheKey
+{
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    uint64_t mtime_ns;
+    uint64_t ctime_ns;
+};
+
+struct DigestCache;
+
+/**
+    @brief      Monotonic time in nanoseconds, or 0 if --stats is not given (so the
+                clock is not read in the main loops).
+ */
+uint64_t StatsNow(void);
+
+/**
+    @brief      Accounts one read of 'size' bytes, which took 'ns' nanoseconds.
+ */
+void StatsAddRead(struct Stats *stats, const size_t size, const uint64_t ns);
+
+/**
+    @brief      Number of threads given with -j, from 1 to MAX_JOBS.
+ */
+int JobCount(void);
+
+/**
+    @brief      Reads until 'size' bytes or the end of the input, like fread. With --stats
+                the input is read with read(2), so the read sizes are those of the
+                system calls and not of the stdio buffer.
+    @return     number of bytes read, less than 'size' only at the end of the input, or
+                -1 with errno set.
+ */
+ssize_t ReadInput(FILE *fin, uint8_t *buffer, const size_t size, struct Stats *stats);
+
+/**
+    @brief      Formats a digest as hex, honoring -b.
+    @param      out - output buffer, at least 2 * size + 1 bytes. It is NUL-terminated.
+    @param      hash - digest.
+    @param      size - size of the digest in bytes.
+    @return     number of characters written, without the NUL.
+ */
+int FormatHash(char *out, const uint8_t *hash, const int size);
+
+/**
+    @brief      Parses a digest printed by FormatHash, honoring -b.
+    @param      hex - the digest, 2 * size hex digits.
+    @param      hash - output pointer, 'size' bytes.
+    @return     false if 'hex' is not a digest of that size.
+ */
+bool ParseHash(const char *hex, uint8_t *hash, const int size);
+
+/**
+    @brief      Initializes the hasher for the digest size given with -s.
+ */
+void HasherInit(struct Hasher *hasher);
+
+/**
+    @brief      Hashes one block of at most BLOCK_SIZE bytes, see GOST34112018_HashBlock.
+ */
+void HasherBlock(struct Hasher *hasher, const uint8_t *block, const uint64_t size);
+
+/**
+    @brief      Hashes 'size' bytes as a sequence of blocks. All but the last call for
+                a message must pass a multiple of BLOCK_SIZE bytes.
+ */
+void HasherUpdate(struct Hasher *hasher, const uint8_t *data, const uint64_t size);
+
+/**
+    @brief      Finishes hashing, see GOST34112018_HashBlockEnd.
+ */
+void HasherEnd(struct Hasher *hasher);
+
+/**
+    @brief      Formats the digest of a finished hasher as hex. With -s both these are
+                the 256-bit and the 512-bit digests, separated by a space.
+    @param      out - output buffer, at least HASH_HEX_MAX bytes.
+    @return     number of characters written, without the NUL.
+ */
+int HasherFormat(const struct Hasher *hasher, char *out);
+
+/**
+    @brief      --records mode: hashes every record of the input separately and prints
+                one line per record, in the order of the input. With --cdc the records
+                are content-defined chunks, and a line is 'OFFSET SIZE DIGEST'.
+    @param      fin - input stream.
+    @param      stats - counters of --stats.
+    @return     0 on success, errno otherwise.
+ */
+int HashRecords(FILE *fin, struct Stats *stats);
+
+/**
+    @brief      --tar mode: hashes every regular file of a tar archive without
+                extracting it and prints a manifest line per file, then the digest of
+                the whole archive.
+    @param      fin - input stream, the archive.
+    @param      name - name of the archive in the manifest.
+    @param      stats - counters of --stats.
+    @return     0 on success, errno otherwise.
+ */
+int HashTar(FILE *fin, const char *name, struct Stats *stats);
+
+/**
+    @brief      --daemon mode: serves hashing requests on a Unix domain socket with -j
+                workers until SIGINT or SIGTERM.
+    @param      socket_path - path of the socket, it is replaced if it exists.
+    @return     0 on success, errno otherwise.
+ */
+int RunDaemon(const char *socket_path);
+
+/**
+    @brief      Hashes the given files with -j workers and prints a line 'DIGEST  PATH'
+                per file, in the order of the arguments.
+    @param      files - paths of the files.
+    @param      count - number of the files.
+    @param      cache - digest cache of --cache, or NULL.
+    @param      stats - counters of --stats.
+    @return     0 on success, errno of the first failed file otherwise.
+ */
+int HashFiles(char **files, const int count, struct DigestCache *cache, struct Stats *stats);
+
+/**
+    @brief      Hashes one file, through the cache if there is one, or by chunks with
+                --index.
+    @param      path - path of the file.
+    @param      cache - digest cache of --cache, or NULL.
+    @param      result - output pointer, the digests of the size given with -s.
+    @param      stats - counters of --stats.
+    @param      buffer - read buffer of FILE_READ_SIZE bytes.
+    @return     0 on success, errno otherwise.
+ */
+int HashFile(const char *path, struct DigestCache *cache, struct FileResult *result,
+             struct Stats *stats, uint8_t *buffer);
+
+/**
+    @brief      Formats the digests of a file as hex, like HasherFormat.
+    @param      out - output buffer, at least HASH_HEX_MAX bytes.
+    @return     number of characters written, without the NUL.
+ */
+int FormatResult(char *out, const struct FileResult *result);
+
+/**
+    @brief      --watch mode: keeps the digests of the files of a directory tree up to
+                date, rehashing the files which have been written, until SIGINT or
+                SIGTERM. SIGUSR1 prints the digests, SIGUSR2 the changes since the
+                previous SIGUSR2.
+    @param      root - the directory.
+    @param      cache - digest cache of --cache, or NULL.
+    @return     0 on success, errno otherwise.
+ */
+int RunWatch(const char *root, struct DigestCache *cache);
+
+/**
+    @brief      --cas mode: runs a command of the content-addressable store.
+    @param      root - directory of the store.
+    @param      args - the command and its arguments.
+    @param      count - number of the arguments, with the command.
+    @return     0 on success, errno otherwise.
+ */
+int RunCas(const char *root, char **args, const int count);
+
+/**
+    @brief      --delta mode: runs a command of the rsync algorithm on local files.
+    @param      args - the command and its arguments.
+    @param      count - number of the arguments, with the command.
+    @return     0 on success, errno otherwise.
+ */
+int RunDelta(char **args, const int count);
+
+/**
+    @brief      --index mode: computes the digest of the chunk digests of a file (see
+                gost34112018_cli_index.c), hashing only the chunks which have changed
+                since the index PATH.gidx was saved, and saves the new index.
+    @param      path - path of the file.
+    @param      fd - descriptor of the file, at offset 0.
+    @param      st - status of the file.
+    @param      top - output pointer, digest of the size given with -s.
+    @param      stats - counters of --stats.
+    @return     0 on success, errno otherwise.
+ */
+int HashFileIndexed(const char *path, const int fd, const struct stat *st, uint8_t *top,
+                    struct Stats *stats);
+
+/**
+    @brief      Opens the digest cache, creating the file if it does not exist.
+    @return     cache, or NULL with errno set.
+ */
+struct DigestCache *CacheOpen(const char *path);
+
+/**
+    @brief      Unmaps the cache.
+ */
+void CacheClose(struct DigestCache *cache);
+
+/**
+    @brief      Makes a cache key of a file.
+ */
+void CacheKeyFromStat(const struct stat *st, struct CacheKey *key);
+
+/**
+    @brief      Checks whether the file was modified too recently for its digest to be
+                cached: like git's racily clean entries, a write within the same
+                timestamp tick as the hashing would leave mtime and ctime unchanged.
+    @return     true if the digest must not be stored.
+ */
+bool CacheKeyIsRacy(const struct CacheKey *key);
+
+/**
+    @brief      Looks up the digests of a file, without locks. Can be called from any
+                number of threads.
+    @param      hash256 - output pointer of the 256-bit digest, NULL if not needed.
+    @param      hash512 - output pointer of the 512-bit digest, NULL if not needed.
+    @return     true if the file has not changed since its needed digests were stored.
+ */
+bool CacheLookup(struct DigestCache *cache, const struct CacheKey *key,
+                 uint8_t *hash256, uint8_t *hash512);
+
+/**
+    @brief      Stores the digests of a file. Digests of the same version of the file
+                stored before are kept. If the table is too crowded around the file, it
+                is not stored.
+    @param      hash256 - 256-bit digest, or NULL.
+    @param      hash512 - 512-bit digest, or NULL.
+ */
+void CacheStore(struct DigestCache *cache, const struct CacheKey *key,
+                const uint8_t *hash256, const uint8_t *hash512);
+
+#endif // __GOST34112018_CLI_H__
@@ -0,0 +1,332 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    Persistent digest cache of gost34112018_cli (--cache). The cache file is mapped
+    into memory and shared by the workers of the process (and by other processes using
+    the same file). It is an open-addressing hash table of fixed-size slots, keyed by
+    the device and the inode of a file; the size, mtime and ctime of the file are stored
+    with its digests and must match for a hit.
+
+    Every slot is guarded by a sequence number (a seqlock): 0 is an empty slot, an odd
+    number is a slot being written, an even one is a valid slot. Readers never write to
+    the slots: they copy a slot and check that its sequence number has not changed in
+    the meantime. Writers take a slot by moving its sequence number from even to odd
+    with a compare-and-swap, so two writers never write the same slot. A read that finds
+    a slot odd or changed is retried a few times before the slot is passed over, or a
+    writer could add a second slot for a file whose first slot it has just skipped. A
+    slot left odd by a crashed writer is never used again, it only costs one slot.
+ */
+
+#include "gost34112018_cli.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "time.h"
+#include "stdatomic.h"
+#include "unistd.h"
+#include "sched.h"
+#include "fcntl.h"
+#include "sys/file.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+
+enum
+{
+    CACHE_SLOTS      = 1 << 20, // of a new cache file, which is sparse
+    CACHE_MAX_PROBES = 32,
+    CACHE_READ_TRIES = 64,      // of a slot being written, see ReadSlotSettled
+    CACHE_HAS_256    = 1 << 0,
+    CACHE_HAS_512    = 1 << 1,
+};
+
+// a file modified within that long of its hashing may still change without a visible
+// difference of mtime and ctime on file systems with coarse timestamps
+static const uint64_t CACHE_RACY_NS = 2000000000ull;
+
+static const char CACHE_MAGIC[8] = "GOSTDC01";
+
+struct CacheHeader
+{
+    char     magic[8];
+    uint64_t slot_count;        // a power of two
+    uint64_t slot_size;
+    uint64_t reserved[5];
+};
+
+struct CacheSlot
+{
+    _Atomic uint64_t sequence;
+    struct CacheKey  key;
+    uint64_t         flags;     // CACHE_HAS_*
+    uint8_t          hash256[32];
+    uint8_t          hash512[64];
+};
+
+struct DigestCache
+{
+    struct CacheHeader *header;
+    struct CacheSlot   *slots;
+    uint64_t            mask;
+    size_t              map_size;
+};
+
+void CacheKeyFromStat(const struct stat *st, struct CacheKey *key)
+{
+    key->dev      = st->st_dev;
+    key->ino      = st->st_ino;
+    key->size     = st->st_size;
+    key->mtime_ns = st->st_mtim.tv_sec * 1000000000ull + st->st_mtim.tv_nsec;
+    key->ctime_ns = st->st_ctim.tv_sec * 1000000000ull + st->st_ctim.tv_nsec;
+}
+
+bool CacheKeyIsRacy(const struct CacheKey *key)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_REALTIME, &ts) != 0)
+        return true;
+
+    const uint64_t now = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    return key->mtime_ns + CACHE_RACY_NS > now || key->ctime_ns + CACHE_RACY_NS > now;
+}
+
+static uint64_t SlotIndex(const struct CacheKey *key)
+{
+    // a file keeps its slot when it changes, so only the identity is hashed
+    uint64_t x = key->dev * 0x9e3779b97f4a7c15ull ^ key->ino;
+
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+    Copies a valid slot.
+    @return     the sequence number of the copy, 0 if the slot is empty, or 1 if the
+                slot is being written.
+ */
+static uint64_t ReadSlot(struct CacheSlot *slot, struct CacheSlot *copy)
+{
+    const uint64_t before = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+    if (before == 0 || (before & 1))
+        return before == 0 ? 0 : 1;
+
+    copy->key   = slot->key;
+    copy->flags = slot->flags;
+    memcpy(copy->hash256, slot->hash256, sizeof(copy->hash256));
+    memcpy(copy->hash512, slot->hash512, sizeof(copy->hash512));
+
+    atomic_thread_fence(memory_order_acquire);
+    const uint64_t after = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+
+    return before == after ? before : 1;
+}
+
+/**
+    Copies a valid slot like ReadSlot, retrying while the slot is being written. A writer
+    holds a slot only for a copy of the digests, but a slot left odd by a crashed writer
+    never settles, so the tries are bounded.
+    @return     as ReadSlot.
+ */
+static uint64_t ReadSlotSettled(struct CacheSlot *slot, struct CacheSlot *copy)
+{
+    uint64_t sequence = ReadSlot(slot, copy);
+
+    for (int tries = 1; sequence == 1 && tries < CACHE_READ_TRIES; tries++)
+    {
+        sched_yield();
+        sequence = ReadSlot(slot, copy);
+    }
+
+    return sequence;
+}
+
+static bool SameFile(const struct CacheKey *lhs, const struct CacheKey *rhs)
+{
+    return lhs->dev == rhs->dev && lhs->ino == rhs->ino;
+}
+
+static bool SameVersion(const struct CacheKey *lhs, const struct CacheKey *rhs)
+{
+    return SameFile(lhs, rhs) && lhs->size == rhs->size &&
+           lhs->mtime_ns == rhs->mtime_ns && lhs->ctime_ns == rhs->ctime_ns;
+}
+
+struct DigestCache *CacheOpen(const char *path)
+{
+    struct stat         st;
+    struct DigestCache *cache = calloc(1, sizeof(*cache));
+    int                 rc    = 0;
+
+    if (!cache)
+        return NULL;
+
+    const int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        free(cache);
+        return NULL;
+    }
+
+    // only the creation of the file is serialized between processes
+    flock(fd, LOCK_EX);
+
+    if (fstat(fd, &st) != 0)
+    {
+        rc = errno;
+        goto out;
+    }
+
+    if (st.st_size == 0)
+    {
+        struct CacheHeader header = {
+            .slot_count = CACHE_SLOTS,
+            .slot_size  = sizeof(struct CacheSlot),
+        };
+        memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+
+        st.st_size = sizeof(header) + (off_t) CACHE_SLOTS * sizeof(struct CacheSlot);
+        if (ftruncate(fd, st.st_size) != 0 ||
+            pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+        {
+            rc = errno ? errno : EIO;
+            goto out;
+        }
+    }
+
+    if ((size_t) st.st_size < sizeof(struct CacheHeader))
+    {
+        rc = EINVAL;
+        goto out;
+    }
+
+    cache->map_size = st.st_size;
+    cache->header   = mmap(NULL, cache->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (cache->header == MAP_FAILED)
+    {
+        cache->header = NULL;
+        rc = errno;
+        goto out;
+    }
+
+    const uint64_t slots = cache->header->slot_count;
+    if (memcmp(cache->header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        cache->header->slot_size != sizeof(struct CacheSlot) ||
+        slots == 0 || (slots & (slots - 1)) != 0 ||
+        (uint64_t) st.st_size != sizeof(struct CacheHeader) + slots * sizeof(struct CacheSlot))
+    {
+        rc = EINVAL;
+        goto out;
+    }
+
+    cache->slots = (struct CacheSlot *) (cache->header + 1);
+    cache->mask  = slots - 1;
+
+out:
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    if (rc != 0)
+    {
+        CacheClose(cache);
+        errno = rc;
+        return NULL;
+    }
+
+    return cache;
+}
+
+void CacheClose(struct DigestCache *cache)
+{
+    if (!cache)
+        return;
+
+    if (cache->header)
+        munmap(cache->header, cache->map_size);
+
+    free(cache);
+}
+
+bool CacheLookup(struct DigestCache *cache, const struct CacheKey *key,
+                 uint8_t *hash256, uint8_t *hash512)
+{
+    const uint64_t   start = SlotIndex(key);
+    struct CacheSlot copy = { 0 };
+
+    for (uint64_t probe = 0; probe < CACHE_MAX_PROBES; probe++)
+    {
+        struct CacheSlot *slot     = &cache->slots[(start + probe) & cache->mask];
+        const uint64_t    sequence = ReadSlotSettled(slot, &copy);
+
+        if (sequence == 0)
+            return false;
+
+        if (sequence == 1 || !SameFile(&copy.key, key))
+            continue;
+
+        if (!SameVersion(&copy.key, key) ||
+            (hash256 && !(copy.flags & CACHE_HAS_256)) ||
+            (hash512 && !(copy.flags & CACHE_HAS_512)))
+            return false;
+
+        if (hash256)
+            memcpy(hash256, copy.hash256, sizeof(copy.hash256));
+        if (hash512)
+            memcpy(hash512, copy.hash512, sizeof(copy.hash512));
+        return true;
+    }
+
+    return false;
+}
+
+void CacheStore(struct DigestCache *cache, const struct CacheKey *key,
+                const uint8_t *hash256, const uint8_t *hash512)
+{
+    const uint64_t   start = SlotIndex(key);
+    struct CacheSlot copy = { 0 };
+
+    for (uint64_t probe = 0; probe < CACHE_MAX_PROBES; probe++)
+    {
+        struct CacheSlot *slot = &cache->slots[(start + probe) & cache->mask];
+        uint64_t          sequence;
+
+        // retried if another writer takes the slot first, it may be someone else's now
+        do
+        {
+            sequence = ReadSlotSettled(slot, &copy);
+            if (sequence == 1 || (sequence != 0 && !SameFile(&copy.key, key)))
+                break;
+        } while (!atomic_compare_exchange_strong_explicit(&slot->sequence, &sequence,
+                                                          sequence + 1, memory_order_acquire,
+                                                          memory_order_relaxed));
+
+        if (sequence == 1 || (sequence != 0 && !SameFile(&copy.key, key)))
+            continue;
+
+        atomic_thread_fence(memory_order_release);
+
+        // digests of the same version of the file are kept, e.g. 256 and then 512
+        const bool keep = sequence != 0 && SameVersion(&copy.key, key);
+
+        slot->key   = *key;
+        slot->flags = keep ? copy.flags : 0;
+        if (hash256)
+        {
+            memcpy(slot->hash256, hash256, sizeof(slot->hash256));
+            slot->flags |= CACHE_HAS_256;
+        }
+        if (hash512)
+        {
+            memcpy(slot->hash512, hash512, sizeof(slot->hash512));
+            slot->flags |= CACHE_HAS_512;
+        }
+
+        atomic_store_explicit(&slot->sequence, sequence + 2, memory_order_release);
+        return;
+    }
+
+    // the neighbourhood of the file is full, it is just not cached
+}
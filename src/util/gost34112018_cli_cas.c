@@ -0,0 +1,213 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    --cas mode of gost34112018_cli: commands of the content-addressable store, see
+    include/gost34112018_cas.h. The digests are always 256-bit, -s does not apply;
+    -b applies to the digests printed and parsed.
+ */
+
+#include "gost34112018_cli.h"
+#include "gost34112018_cas.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "unistd.h"
+#include "fcntl.h"
+
+enum
+{
+    CAS_DIGEST_SIZE = 32,
+};
+
+static int Put(struct GOST34112018_Cas *cas, char **files, const int count)
+{
+    uint8_t digest[CAS_DIGEST_SIZE];
+    char    hex[HASH_HEX_MAX];
+    int     rc = 0;
+
+    // without files the blob is stdin
+    for (int i = 0; i < (count ? count : 1); i++)
+    {
+        const char *path = count ? files[i] : "-";
+        const int   fd   = count ? open(path, O_RDONLY | O_CLOEXEC) : STDIN_FILENO;
+        int         error;
+
+        if (fd < 0)
+        {
+            error = errno;
+        }
+        else
+        {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            error = GOST34112018_CasPutFd(cas, fd, digest);
+            if (fd != STDIN_FILENO)
+                close(fd);
+        }
+
+        if (error != 0)
+        {
+            log_err("%s: %s", path, strerror(error));
+            rc = rc ? rc : error;
+            continue;
+        }
+
+        FormatHash(hex, digest, sizeof(digest));
+        printf("%s  %s\n", hex, path);
+    }
+
+    return rc;
+}
+
+static int Get(struct GOST34112018_Cas *cas, const char *hex)
+{
+    uint8_t digest[CAS_DIGEST_SIZE];
+    int     rc = 0;
+
+    if (!ParseHash(hex, digest, sizeof(digest)))
+    {
+        log_err("Not a 256-bit digest: %s", hex);
+        return EINVAL;
+    }
+
+    const int fd = GOST34112018_CasGet(cas, digest);
+    if (fd < 0)
+    {
+        log_err("%s: %s", hex, strerror(errno));
+        return errno;
+    }
+
+    uint8_t *buffer = malloc(FILE_READ_SIZE);
+    if (!buffer)
+    {
+        close(fd);
+        return ENOMEM;
+    }
+
+    fflush(stdout);
+
+    for (;;)
+    {
+        const ssize_t n = read(fd, buffer, FILE_READ_SIZE);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            rc = n < 0 ? errno : 0;
+            break;
+        }
+
+        for (ssize_t done = 0; done < n;)
+        {
+            const ssize_t written = write(STDOUT_FILENO, buffer + done, n - done);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written < 0)
+            {
+                rc = errno;
+                break;
+            }
+            done += written;
+        }
+
+        if (rc != 0)
+            break;
+    }
+
+    if (rc != 0)
+        log_err("%s: %s", hex, strerror(rc));
+
+    free(buffer);
+    close(fd);
+    return rc;
+}
+
+static int Has(struct GOST34112018_Cas *cas, char **digests, const int count)
+{
+    uint8_t digest[CAS_DIGEST_SIZE];
+    int     rc = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!ParseHash(digests[i], digest, sizeof(digest)))
+        {
+            log_err("Not a 256-bit digest: %s", digests[i]);
+            rc = EINVAL;
+            continue;
+        }
+
+        if (!GOST34112018_CasHas(cas, digest))
+        {
+            printf("%s\n", digests[i]);
+            rc = rc ? rc : ENOENT;
+        }
+    }
+
+    return rc;
+}
+
+static void PrintDamaged(const char *object, int status, void *user_data)
+{
+    (void) user_data;
+    printf("%s: %s\n", object, strerror(status));
+}
+
+static int Fsck(struct GOST34112018_Cas *cas)
+{
+    unsigned long long checked = 0;
+
+    const long long damaged = GOST34112018_CasFsck(cas, JobCount(), PrintDamaged, NULL, &checked);
+    if (damaged < 0)
+    {
+        log_err("fsck failed: %s", strerror(errno));
+        return errno;
+    }
+
+    fprintf(stderr, "%llu objects checked, %lld damaged\n", checked, damaged);
+    return damaged ? EIO : 0;
+}
+
+int RunCas(const char *root, char **args, const int count)
+{
+    int rc;
+
+    if (count == 0)
+    {
+        log_err("--cas needs a command: put, get, has or fsck");
+        return EINVAL;
+    }
+
+    // only put creates the store, a typo in STORE must not look like an empty one
+    struct GOST34112018_Cas *cas = GOST34112018_CasOpen(root, strcmp(args[0], "put") == 0);
+    if (!cas)
+    {
+        log_err("Could not open the store %s: %s", root, strerror(errno));
+        return errno;
+    }
+
+    if (strcmp(args[0], "put") == 0)
+    {
+        rc = Put(cas, args + 1, count - 1);
+    }
+    else if (strcmp(args[0], "get") == 0 && count == 2)
+    {
+        rc = Get(cas, args[1]);
+    }
+    else if (strcmp(args[0], "has") == 0)
+    {
+        rc = Has(cas, args + 1, count - 1);
+    }
+    else if (strcmp(args[0], "fsck") == 0 && count == 1)
+    {
+        rc = Fsck(cas);
+    }
+    else
+    {
+        log_err("Unknown command or wrong arguments: %s", args[0]);
+        rc = EINVAL;
+    }
+
+    GOST34112018_CasClose(cas);
+    fflush(stdout);
+    return rc;
+}
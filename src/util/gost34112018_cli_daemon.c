@@ -0,0 +1,441 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    --daemon mode of gost34112018_cli: a hashing service on a Unix domain socket, see
+    gost34112018_protocol.h for the protocol and include/gost34112018_client.h for the
+    client library.
+
+    Requests are hashed by a GOST34112018_Engine with -j workers. The main thread runs
+    one epoll loop over the listening socket, the clients and the eventfd of the
+    engine: it receives requests and submits them without locks, and when the eventfd
+    fires it polls all of the completed jobs at once and sends their replies. The
+    workers take their whole inbox at a time, so requests of concurrent clients are
+    hashed in batches, and only the main thread ever touches a client. A reply is
+    never waited for: a client which does not read its replies is cut off.
+
+    A client is reference counted: by the main thread while the connection is open and
+    by every request in the engine. Its socket is closed and its shared buffer unmapped
+    when the last reference is released, so a reply never goes to a descriptor which
+    was reused for another connection.
+ */
+
+#define _GNU_SOURCE
+
+#include "gost34112018_cli.h"
+#include "gost34112018_protocol.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "signal.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "poll.h"
+#include "sys/epoll.h"
+#include "sys/mman.h"
+#include "sys/socket.h"
+#include "sys/stat.h"
+#include "sys/un.h"
+
+enum
+{
+    MAX_EVENTS     = 64,
+    LISTEN_BACKLOG = 128,
+};
+
+struct DaemonClient
+{
+    int             socket;
+    const uint8_t  *shared;
+    size_t          shared_size;
+    bool            hello;      // a DAEMON_HELLO has succeeded, even a zero-length one
+    int             refs;
+};
+
+struct DaemonJob
+{
+    struct GOST34112018_Job  job;       // job.user_data points back to this
+    struct DaemonClient     *client;
+    uint64_t                 id;
+};
+
+static struct GOST34112018_Engine *g_engine;
+static int                         g_in_flight;    // jobs submitted and not polled yet
+static volatile sig_atomic_t       g_stop;
+
+static void StopHandler(int signal)
+{
+    (void) signal;
+    g_stop = 1;
+}
+
+static void ClientRelease(struct DaemonClient *client)
+{
+    if (--client->refs != 0)
+        return;
+
+    if (client->shared)
+        munmap((void *) client->shared, client->shared_size);
+
+    close(client->socket);
+    free(client);
+}
+
+static void SendReply(struct DaemonClient *client, const struct DaemonReply *reply)
+{
+    ssize_t sent;
+    do
+    {
+        sent = send(client->socket, reply, sizeof(*reply), MSG_NOSIGNAL | MSG_DONTWAIT);
+    } while (sent < 0 && errno == EINTR);
+
+    // the event loop can not wait for a client, it sees the hang-up and drops it
+    if (sent < 0)
+        shutdown(client->socket, SHUT_RDWR);
+}
+
+/**
+    Sends the replies of all of the completed jobs.
+ */
+static void CompleteJobs(void)
+{
+    struct GOST34112018_Job *completed[MAX_EVENTS];
+    int                      count;
+
+    while ((count = GOST34112018_EnginePoll(g_engine, completed, MAX_EVENTS)) > 0)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            struct DaemonJob  *job   = completed[i]->user_data;
+            struct DaemonReply reply = { .id        = job->id,
+                                         .status    = job->job.status,
+                                         .hash_size = job->job.hash_size };
+
+            if (reply.status == 0)
+                memcpy(reply.hash, job->job.hash, job->job.hash_size);
+
+            SendReply(job->client, &reply);
+
+            if (job->job.fd >= 0)
+                close(job->job.fd);
+
+            ClientRelease(job->client);
+            free(job);
+        }
+
+        g_in_flight -= count;
+    }
+}
+
+/**
+    Checks the type of a request and whether it carries a descriptor: only DAEMON_HELLO
+    (once per connection) and DAEMON_HASH_FD do, DAEMON_HASH_SHARED does not.
+ */
+static bool RequestValid(const struct DaemonClient *client, const struct DaemonRequest *request,
+                         const int fd)
+{
+    switch (request->type)
+    {
+        case DAEMON_HELLO:
+            return fd >= 0 && !client->hello;
+        case DAEMON_HASH_SHARED:
+            return fd < 0;
+        case DAEMON_HASH_FD:
+            return fd >= 0;
+        default:
+            return false;
+    }
+}
+
+/**
+    Receives one request.
+    @return     1 - a request is received, 0 - no more requests for now, -1 - the
+                connection is closed or broken.
+ */
+static int ReceiveRequest(struct DaemonClient *client)
+{
+    union
+    {
+        char           buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    struct DaemonRequest request;
+    struct iovec         iov = { &request, sizeof(request) };
+    struct msghdr        msg = { 0 };
+    int                  fd  = -1;
+
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    ssize_t received;
+    do
+    {
+        received = recvmsg(client->socket, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+
+    if (received < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    if (received == 0)
+        return -1;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+
+    if (received != sizeof(request) || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) ||
+        !RequestValid(client, &request, fd))
+    {
+        struct DaemonReply reply = { .id = received == sizeof(request) ? request.id : 0,
+                                     .status = EPROTO };
+        SendReply(client, &reply);
+        if (fd >= 0)
+            close(fd);
+        return 1;
+    }
+
+    if (request.type == DAEMON_HELLO)
+    {
+        struct DaemonReply reply = { .id = request.id };
+        struct stat        st;
+
+        // only a buffer which can not shrink is safe to map
+        const int seals = fcntl(fd, F_GET_SEALS);
+        if (seals < 0 || !(seals & F_SEAL_SHRINK))
+        {
+            reply.status = EPERM;
+        }
+        else if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < request.length)
+        {
+            reply.status = EINVAL;
+        }
+        else if (request.length)
+        {
+            void *shared = mmap(NULL, request.length, PROT_READ, MAP_SHARED, fd, 0);
+            if (shared == MAP_FAILED)
+            {
+                reply.status = errno;
+            }
+            else
+            {
+                client->shared      = shared;
+                client->shared_size = request.length;
+            }
+        }
+
+        client->hello = reply.status == 0;
+
+        close(fd);
+        SendReply(client, &reply);
+        return 1;
+    }
+
+    // a pipe or a socket which is never closed would block a worker forever
+    struct stat st;
+    if (fd >= 0 && (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)))
+    {
+        struct DaemonReply reply = { .id = request.id, .status = EINVAL };
+        SendReply(client, &reply);
+        close(fd);
+        return 1;
+    }
+
+    // the engine checks the digest size, the range of the shared buffer is checked here
+    if (fd < 0 && (request.offset > client->shared_size ||
+                   request.length > client->shared_size - request.offset))
+    {
+        struct DaemonReply reply = { .id = request.id, .status = EINVAL };
+        SendReply(client, &reply);
+        return 1;
+    }
+
+    struct DaemonJob *job = calloc(1, sizeof(*job));
+    if (!job)
+    {
+        struct DaemonReply reply = { .id = request.id, .status = ENOMEM };
+        SendReply(client, &reply);
+        if (fd >= 0)
+            close(fd);
+        return 1;
+    }
+
+    job->client            = client;
+    job->id                = request.id;
+    job->job.fd            = fd;
+    job->job.hash_size     = (GOST34112018_HashSize_t) request.hash_size;
+    job->job.user_data     = job;
+    if (fd < 0)
+    {
+        job->job.message      = client->shared + request.offset;
+        job->job.message_size = request.length;
+    }
+
+    const int rc = GOST34112018_EngineSubmit(g_engine, &job->job);
+    if (rc != 0)
+    {
+        struct DaemonReply reply = { .id = request.id, .status = rc };
+        SendReply(client, &reply);
+        if (fd >= 0)
+            close(fd);
+        free(job);
+        return 1;
+    }
+
+    client->refs++;
+    g_in_flight++;
+    return 1;
+}
+
+static int Listen(const char *path)
+{
+    struct sockaddr_un address = { 0 };
+
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        log_err("Socket path is too long: %s", path);
+        return -1;
+    }
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    const int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listener < 0)
+    {
+        log_err("Could not create socket: %s", strerror(errno));
+        return -1;
+    }
+
+    // a socket left behind by a previous daemon
+    unlink(path);
+
+    if (bind(listener, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+        listen(listener, LISTEN_BACKLOG) != 0)
+    {
+        log_err("Could not listen on %s: %s", path, strerror(errno));
+        close(listener);
+        return -1;
+    }
+
+    return listener;
+}
+
+static void Accept(const int epoll, const int listener)
+{
+    for (;;)
+    {
+        const int socket = accept4(listener, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if (socket < 0)
+            return;
+
+        struct DaemonClient *client = calloc(1, sizeof(*client));
+        if (!client)
+        {
+            close(socket);
+            continue;
+        }
+
+        client->socket = socket;
+        client->refs   = 1;
+
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = client };
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, socket, &event) != 0)
+            ClientRelease(client);
+    }
+}
+
+int RunDaemon(const char *socket_path)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int                rc = 0;
+
+    const int listener = Listen(socket_path);
+    if (listener < 0)
+        return EIO;
+
+    g_engine = GOST34112018_EngineCreate(JobCount(), GOST34112018_EngineUseEventFd);
+    if (!g_engine)
+    {
+        log_err("Could not create the hashing engine: %s", strerror(errno));
+        close(listener);
+        return EIO;
+    }
+
+    // the listener is marked by NULL, the eventfd by the engine itself
+    const int          epoll  = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event accept = { .events = EPOLLIN, .data.ptr = NULL };
+    struct epoll_event engine = { .events = EPOLLIN, .data.ptr = g_engine };
+    if (epoll < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &accept) != 0 ||
+        epoll_ctl(epoll, EPOLL_CTL_ADD, GOST34112018_EngineEventFd(g_engine), &engine) != 0)
+    {
+        log_err("Could not create epoll: %s", strerror(errno));
+        if (epoll >= 0)
+            close(epoll);
+        GOST34112018_EngineDestroy(g_engine);
+        close(listener);
+        return EIO;
+    }
+
+    struct sigaction action = { .sa_handler = StopHandler };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    while (!g_stop)
+    {
+        const int ready = epoll_wait(epoll, events, MAX_EVENTS, -1);
+        if (ready < 0 && errno != EINTR)
+        {
+            log_err("epoll_wait failed: %s", strerror(errno));
+            rc = EIO;
+            break;
+        }
+
+        for (int i = 0; i < ready; i++)
+        {
+            struct DaemonClient *client = events[i].data.ptr;
+
+            if (!client)
+            {
+                Accept(epoll, listener);
+                continue;
+            }
+
+            if (events[i].data.ptr == g_engine)
+            {
+                CompleteJobs();
+                continue;
+            }
+
+            // drain the socket, requests can be pipelined
+            int received;
+            while ((received = ReceiveRequest(client)) > 0)
+                ;
+
+            if (received < 0)
+            {
+                epoll_ctl(epoll, EPOLL_CTL_DEL, client->socket, NULL);
+                ClientRelease(client);
+            }
+        }
+    }
+
+    // jobs submitted before the stop are still replied to
+    struct pollfd pfd = { .fd = GOST34112018_EngineEventFd(g_engine), .events = POLLIN };
+    while (g_in_flight > 0)
+    {
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR)
+            break;
+        CompleteJobs();
+    }
+
+    GOST34112018_EngineDestroy(g_engine);
+    close(epoll);
+    close(listener);
+    unlink(socket_path);
+
+    return rc;
+}
@@ -0,0 +1,535 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    --delta mode of gost34112018_cli: the rsync algorithm on local files, with
+    Streebog-256 as the strong checksum (see src/lib/gost34112018_delta.c).
+
+        signature BASIS SIG     the signature of the old file
+        delta SIG FILE DELTA    the delta of the new file against the signature
+        patch BASIS DELTA OUT   the new file, from the old one and the delta
+
+    The signature file has a weak checksum and DELTA_STRONG_SIZE bytes of the digest
+    per block. The delta file has the 256-bit digest of the new file, and patch checks
+    it while writing, so a wrong basis or a collision of the truncated digests is
+    caught. The outputs are written into PATH.tmp, which then replaces PATH.
+ */
+
+#include "gost34112018_cli.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "limits.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "sys/mman.h"
+
+enum
+{
+    DELTA_STRONG_SIZE = 16,
+    DELTA_MIN_BLOCK   = 2048,
+    DELTA_MAX_BLOCK   = 1 << 17,
+    DIGEST_SIZE       = 32,
+};
+
+static const char SIGNATURE_MAGIC[8] = "GOSTSG01";
+static const char DELTA_MAGIC[8]     = "GOSTDL01";
+
+// offset of a delta record followed by its literal bytes
+static const uint64_t LITERAL = UINT64_MAX;
+
+struct SignatureHeader
+{
+    char     magic[8];
+    uint64_t basis_size;
+    uint64_t block_size;
+    uint64_t strong_size;
+    uint64_t reserved[4];
+};
+
+struct DeltaHeader
+{
+    char     magic[8];
+    uint64_t basis_size;
+    uint64_t size;              // of the new file
+    uint8_t  hash[DIGEST_SIZE]; // of the new file
+    uint64_t reserved[4];
+};
+
+struct DeltaRecord
+{
+    uint64_t offset;            // in the basis, or LITERAL
+    uint64_t size;
+};
+
+struct Mapping
+{
+    const uint8_t *data;
+    uint64_t       size;
+};
+
+/**
+    State of the delta command: where the records go, and what they add up to.
+ */
+struct DeltaWriter
+{
+    FILE    *fout;
+    uint64_t copied;
+    uint64_t literal;
+};
+
+/**
+    Output of the patch command, hashed while it is written.
+ */
+struct PatchWriter
+{
+    FILE                       *fout;
+    struct GOST34112018_Context ctx;
+    uint8_t                     pending[BLOCK_SIZE];
+    size_t                      pending_size;
+    uint64_t                    size;
+};
+
+static int MapFile(const char *path, struct Mapping *map)
+{
+    struct stat st;
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno;
+
+    map->data = NULL;
+    map->size = 0;
+
+    if (fstat(fd, &st) != 0)
+    {
+        const int rc = errno;
+        close(fd);
+        return rc;
+    }
+
+    if (!S_ISREG(st.st_mode))
+    {
+        close(fd);
+        return EINVAL;
+    }
+
+    // an empty file can not be mapped, and does not need to be
+    if (st.st_size > 0)
+    {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            const int rc = errno;
+            close(fd);
+            return rc;
+        }
+
+        madvise(data, st.st_size, MADV_SEQUENTIAL);
+        map->data = data;
+        map->size = st.st_size;
+    }
+
+    close(fd);
+    return 0;
+}
+
+static void UnmapFile(struct Mapping *map)
+{
+    if (map->size > 0)
+        munmap((void *) map->data, map->size);
+}
+
+static FILE *CreateOutput(const char *path, char *temporary)
+{
+    if (snprintf(temporary, PATH_MAX, "%s.tmp", path) >= PATH_MAX)
+    {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+
+    return fopen(temporary, "wb");
+}
+
+/**
+    Closes the output and puts it into place, or removes it if anything has failed.
+ */
+static int CommitOutput(FILE *fout, const char *temporary, const char *path, int rc)
+{
+    if (fclose(fout) != 0 && rc == 0)
+        rc = errno ? errno : EIO;
+
+    if (rc == 0 && rename(temporary, path) != 0)
+        rc = errno;
+
+    if (rc != 0)
+        unlink(temporary);
+
+    return rc;
+}
+
+static uint64_t BlockSizeFor(const uint64_t size)
+{
+    if (g_opt_block_size > 0)
+        return g_opt_block_size;
+
+    // about the square root of the size, like rsync
+    uint64_t block_size = DELTA_MIN_BLOCK;
+    while (block_size < DELTA_MAX_BLOCK && block_size * block_size < size)
+        block_size <<= 1;
+
+    return block_size;
+}
+
+static int Signature(const char *basis_path, const char *path)
+{
+    struct Mapping                      basis;
+    struct GOST34112018_BlockSignature *blocks = NULL;
+    char                                temporary[PATH_MAX];
+    int                                 rc;
+
+    rc = MapFile(basis_path, &basis);
+    if (rc != 0)
+    {
+        log_err("%s: %s", basis_path, strerror(rc));
+        return rc;
+    }
+
+    struct SignatureHeader header = {
+        .basis_size  = basis.size,
+        .block_size  = BlockSizeFor(basis.size),
+        .strong_size = DELTA_STRONG_SIZE,
+    };
+    memcpy(header.magic, SIGNATURE_MAGIC, sizeof(SIGNATURE_MAGIC));
+
+    const uint64_t count = basis.size / header.block_size + (basis.size % header.block_size != 0);
+
+    blocks = malloc((count ? count : 1) * sizeof(*blocks));
+    if (!blocks)
+    {
+        rc = ENOMEM;
+        goto out;
+    }
+
+    if (GOST34112018_DeltaSignature(basis.data, basis.size, header.block_size,
+                                    header.strong_size, blocks) < 0)
+    {
+        rc = errno;
+        goto out;
+    }
+
+    FILE *fout = CreateOutput(path, temporary);
+    if (!fout)
+    {
+        rc = errno;
+        goto out;
+    }
+
+    bool written = fwrite(&header, sizeof(header), 1, fout) == 1;
+    for (uint64_t i = 0; written && i < count; i++)
+    {
+        written = fwrite(&blocks[i].weak, sizeof(blocks[i].weak), 1, fout) == 1 &&
+                  fwrite(blocks[i].strong, header.strong_size, 1, fout) == 1;
+    }
+
+    rc = CommitOutput(fout, temporary, path, written ? 0 : errno ? errno : EIO);
+
+out:
+    if (rc != 0)
+        log_err("%s: %s", path, strerror(rc));
+
+    free(blocks);
+    UnmapFile(&basis);
+    return rc;
+}
+
+static int LoadSignature(const char *path, struct GOST34112018_Signature *signature,
+                         struct GOST34112018_BlockSignature **blocks_out)
+{
+    struct SignatureHeader header;
+    int                    rc = 0;
+
+    FILE *fin = fopen(path, "rb");
+    if (!fin)
+        return errno;
+
+    *blocks_out = NULL;
+
+    if (fread(&header, sizeof(header), 1, fin) != 1 ||
+        memcmp(header.magic, SIGNATURE_MAGIC, sizeof(SIGNATURE_MAGIC)) != 0 ||
+        header.block_size == 0 || header.strong_size == 0 || header.strong_size > DIGEST_SIZE)
+    {
+        rc = EINVAL;
+        goto out;
+    }
+
+    const uint64_t count = header.basis_size / header.block_size +
+                           (header.basis_size % header.block_size != 0);
+
+    struct GOST34112018_BlockSignature *blocks = calloc(count ? count : 1, sizeof(*blocks));
+    if (!blocks)
+    {
+        rc = ENOMEM;
+        goto out;
+    }
+    *blocks_out = blocks;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (fread(&blocks[i].weak, sizeof(blocks[i].weak), 1, fin) != 1 ||
+            fread(blocks[i].strong, header.strong_size, 1, fin) != 1)
+        {
+            rc = EINVAL;
+            goto out;
+        }
+    }
+
+    signature->basis_size  = header.basis_size;
+    signature->block_size  = header.block_size;
+    signature->strong_size = header.strong_size;
+    signature->blocks      = blocks;
+
+out:
+    fclose(fin);
+    return rc;
+}
+
+static int WriteDeltaOp(const struct GOST34112018_DeltaOp *op, void *user_data)
+{
+    struct DeltaWriter *writer = user_data;
+    struct DeltaRecord  record = { op->literal ? LITERAL : op->offset, op->size };
+
+    if (fwrite(&record, sizeof(record), 1, writer->fout) != 1 ||
+        (op->literal && fwrite(op->literal, op->size, 1, writer->fout) != 1))
+    {
+        return errno ? errno : EIO;
+    }
+
+    if (op->literal)
+        writer->literal += op->size;
+    else
+        writer->copied += op->size;
+
+    return 0;
+}
+
+static int Delta(const char *signature_path, const char *file_path, const char *path)
+{
+    struct GOST34112018_Signature       signature;
+    struct GOST34112018_BlockSignature *blocks = NULL;
+    struct Mapping                      file   = { NULL, 0 };
+    struct DeltaWriter                  writer = { NULL, 0, 0 };
+    char                                temporary[PATH_MAX];
+    const char                         *failed = signature_path;
+    int                                 rc;
+
+    rc = LoadSignature(signature_path, &signature, &blocks);
+    if (rc != 0)
+        goto out;
+
+    failed = file_path;
+    rc = MapFile(file_path, &file);
+    if (rc != 0)
+        goto out;
+
+    struct DeltaHeader header = {
+        .basis_size = signature.basis_size,
+        .size       = file.size,
+    };
+    memcpy(header.magic, DELTA_MAGIC, sizeof(DELTA_MAGIC));
+    GOST34112018_HashBytes(file.data, file.size, GOST34112018_Hash256, header.hash);
+
+    failed = path;
+    writer.fout = CreateOutput(path, temporary);
+    if (!writer.fout)
+    {
+        rc = errno;
+        goto out;
+    }
+
+    rc = fwrite(&header, sizeof(header), 1, writer.fout) == 1 ? 0 : errno ? errno : EIO;
+    if (rc == 0)
+        rc = GOST34112018_DeltaCompute(&signature, file.data, file.size, WriteDeltaOp, &writer);
+
+    rc = CommitOutput(writer.fout, temporary, path, rc);
+
+    if (rc == 0 && g_opt_stats)
+    {
+        fprintf(stderr, "%llu bytes from the basis, %llu literal bytes\n",
+                (unsigned long long) writer.copied, (unsigned long long) writer.literal);
+    }
+
+out:
+    if (rc != 0)
+        log_err("%s: %s", failed, strerror(rc));
+
+    free(blocks);
+    UnmapFile(&file);
+    return rc;
+}
+
+static int PatchWrite(struct PatchWriter *writer, const uint8_t *data, size_t size)
+{
+    if (fwrite(data, 1, size, writer->fout) != size)
+        return errno ? errno : EIO;
+
+    writer->size += size;
+
+    // the context takes whole blocks, the last one can be shorter
+    if (writer->pending_size > 0)
+    {
+        const size_t taken = size < BLOCK_SIZE - writer->pending_size
+                                 ? size
+                                 : BLOCK_SIZE - writer->pending_size;
+
+        memcpy(writer->pending + writer->pending_size, data, taken);
+        writer->pending_size += taken;
+        data += taken;
+        size -= taken;
+
+        if (writer->pending_size < BLOCK_SIZE)
+            return 0;
+
+        GOST34112018_HashBlock(writer->pending, BLOCK_SIZE, &writer->ctx);
+        writer->pending_size = 0;
+    }
+
+    for (; size >= BLOCK_SIZE; data += BLOCK_SIZE, size -= BLOCK_SIZE)
+        GOST34112018_HashBlock(data, BLOCK_SIZE, &writer->ctx);
+
+    memcpy(writer->pending, data, size);
+    writer->pending_size = size;
+    return 0;
+}
+
+static int Patch(const char *basis_path, const char *delta_path, const char *path)
+{
+    struct Mapping     basis  = { NULL, 0 };
+    struct PatchWriter writer = { 0 };
+    struct DeltaHeader header;
+    struct DeltaRecord record;
+    uint8_t            hash[DIGEST_SIZE];
+    char               temporary[PATH_MAX];
+    const char        *failed = basis_path;
+    uint8_t           *buffer = NULL;
+    FILE              *fin    = NULL;
+    int                rc;
+
+    rc = MapFile(basis_path, &basis);
+    if (rc != 0)
+        goto out;
+
+    failed = delta_path;
+    fin    = fopen(delta_path, "rb");
+    buffer = malloc(FILE_READ_SIZE);
+    if (!fin || !buffer)
+    {
+        rc = !fin ? errno : ENOMEM;
+        goto out;
+    }
+
+    if (fread(&header, sizeof(header), 1, fin) != 1 ||
+        memcmp(header.magic, DELTA_MAGIC, sizeof(DELTA_MAGIC)) != 0)
+    {
+        rc = EINVAL;
+        goto out;
+    }
+
+    // a delta against another basis can not be applied
+    if (header.basis_size != basis.size)
+    {
+        failed = basis_path;
+        rc     = EBADMSG;
+        goto out;
+    }
+
+    failed      = path;
+    writer.fout = CreateOutput(path, temporary);
+    if (!writer.fout)
+    {
+        rc = errno;
+        goto out;
+    }
+    GOST34112018_InitContext(&writer.ctx, GOST34112018_Hash256);
+
+    while (rc == 0 && fread(&record, sizeof(record), 1, fin) == 1)
+    {
+        if (record.offset != LITERAL)
+        {
+            failed = delta_path;
+            rc     = record.offset > basis.size || record.size > basis.size - record.offset
+                         ? EINVAL
+                         : PatchWrite(&writer, basis.data + record.offset, record.size);
+            continue;
+        }
+
+        for (uint64_t left = record.size; rc == 0 && left > 0;)
+        {
+            const size_t n = left < FILE_READ_SIZE ? left : FILE_READ_SIZE;
+
+            failed = delta_path;
+            if (fread(buffer, n, 1, fin) != 1)
+            {
+                rc = ferror(fin) ? EIO : EINVAL;
+                break;
+            }
+
+            failed = path;
+            rc     = PatchWrite(&writer, buffer, n);
+            left  -= n;
+        }
+    }
+
+    if (rc == 0 && ferror(fin))
+    {
+        failed = delta_path;
+        rc     = EIO;
+    }
+
+    if (rc == 0)
+    {
+        if (writer.pending_size > 0)
+            GOST34112018_HashBlock(writer.pending, writer.pending_size, &writer.ctx);
+        GOST34112018_HashBlockEnd(&writer.ctx);
+        GOST34112018_GetHashFromContext(&writer.ctx, hash);
+
+        // a truncated delta, a changed basis or a collision of the truncated digests
+        if (writer.size != header.size || memcmp(hash, header.hash, sizeof(hash)) != 0)
+        {
+            failed = path;
+            rc     = EBADMSG;
+        }
+    }
+
+    rc = CommitOutput(writer.fout, temporary, path, rc);
+
+out:
+    if (rc != 0)
+        log_err("%s: %s", failed, strerror(rc));
+
+    if (fin)
+        fclose(fin);
+    free(buffer);
+    UnmapFile(&basis);
+    return rc;
+}
+
+int RunDelta(char **args, const int count)
+{
+    // the blocks of a signature are hashed in batches by -j threads, and -j 1 (the
+    // default) keeps them on this thread instead of falling back to the OpenMP default
+    GOST34112018_SetBatchThreads(JobCount());
+
+    if (count == 3 && strcmp(args[0], "signature") == 0)
+        return Signature(args[1], args[2]);
+
+    if (count == 4 && strcmp(args[0], "delta") == 0)
+        return Delta(args[1], args[2], args[3]);
+
+    if (count == 4 && strcmp(args[0], "patch") == 0)
+        return Patch(args[1], args[2], args[3]);
+
+    log_err("--delta needs a command: 'signature BASIS SIG', 'delta SIG FILE DELTA' or "
+            "'patch BASIS DELTA OUT'");
+    return EINVAL;
+}
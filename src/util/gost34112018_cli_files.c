@@ -0,0 +1,235 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    FILE arguments of gost34112018_cli: every file gets a line 'DIGEST  PATH'. The files
+    are taken one at a time by -j workers; the lines are printed when all of the files
+    are hashed, in the order of the arguments.
+
+    With --index a file is hashed by chunks, see gost34112018_cli_index.c.
+
+    With --cache a file whose device, inode, size, mtime and ctime match an entry of
+    the cache is not read at all. The file is stat'ed again after hashing, and the
+    digest is only stored if the file has not changed while it was read and it was not
+    modified in the last two seconds (a racily clean file, see CacheKeyIsRacy).
+ */
+
+#include "gost34112018_cli.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "stdatomic.h"
+#include "pthread.h"
+#include "unistd.h"
+#include "fcntl.h"
+
+struct FilesWork
+{
+    char              **files;
+    int                 count;
+    struct DigestCache *cache;
+    struct FileResult  *results;
+    _Atomic int         next;
+};
+
+struct FilesWorker
+{
+    struct FilesWork *work;
+    struct Stats      stats;
+    pthread_t         thread;
+};
+
+int HashFile(const char *path, struct DigestCache *cache, struct FileResult *result,
+             struct Stats *stats, uint8_t *buffer)
+{
+    struct stat     before, after;
+    struct CacheKey key, key_after;
+    struct Hasher   hasher;
+    size_t          filled = 0;
+    bool            eof    = false;
+    uint64_t        t0;
+    int             rc     = 0;
+
+    uint8_t *hash256 = g_opt_hash_size != 512 ? result->hash256 : NULL;
+    uint8_t *hash512 = g_opt_hash_size != 256 ? result->hash512 : NULL;
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno;
+
+    if (fstat(fd, &before) != 0)
+    {
+        rc = errno;
+        goto out;
+    }
+
+    if (S_ISDIR(before.st_mode))
+    {
+        rc = EISDIR;
+        goto out;
+    }
+
+    if (g_opt_index)
+    {
+        rc = HashFileIndexed(path, fd, &before, hash256 ? hash256 : hash512, stats);
+        goto out;
+    }
+
+    // pipes and devices have no version to check
+    const bool cacheable = cache && S_ISREG(before.st_mode);
+    if (cacheable)
+    {
+        CacheKeyFromStat(&before, &key);
+        if (!g_opt_rehash && CacheLookup(cache, &key, hash256, hash512))
+        {
+            stats->cache_hits++;
+            goto out;
+        }
+    }
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    HasherInit(&hasher);
+
+    while (!eof)
+    {
+        t0 = StatsNow();
+        const ssize_t n = read(fd, buffer + filled, FILE_READ_SIZE - filled);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            rc = errno;
+            goto out;
+        }
+        StatsAddRead(stats, n, StatsNow() - t0);
+
+        filled += n;
+        eof     = n == 0;
+        if (!eof && filled < FILE_READ_SIZE)
+            continue;
+
+        t0 = StatsNow();
+        HasherUpdate(&hasher, buffer, filled);
+        stats->hash_ns += StatsNow() - t0;
+        filled = 0;
+    }
+
+    HasherEnd(&hasher);
+
+    if (hasher.dual)
+        GOST34112018_GetHashesFromDualContext(&hasher.dual_ctx, hash256, hash512);
+    else
+        GOST34112018_GetHashFromContext(&hasher.ctx, hash256 ? hash256 : hash512);
+
+    if (cacheable && fstat(fd, &after) == 0)
+    {
+        CacheKeyFromStat(&after, &key_after);
+        if (memcmp(&key, &key_after, sizeof(key)) == 0 && !CacheKeyIsRacy(&key_after))
+            CacheStore(cache, &key, hash256, hash512);
+    }
+
+out:
+    close(fd);
+    return rc;
+}
+
+static void *FilesThread(void *arg)
+{
+    struct FilesWorker *worker = arg;
+    struct FilesWork   *work   = worker->work;
+    uint8_t            *buffer = malloc(FILE_READ_SIZE);
+
+    for (;;)
+    {
+        const int i = atomic_fetch_add_explicit(&work->next, 1, memory_order_relaxed);
+        if (i >= work->count)
+            break;
+
+        work->results[i].rc = buffer ? HashFile(work->files[i], work->cache, &work->results[i],
+                                                &worker->stats, buffer)
+                                     : ENOMEM;
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+int FormatResult(char *out, const struct FileResult *result)
+{
+    if (g_opt_hash_size == 256)
+        return FormatHash(out, result->hash256, sizeof(result->hash256));
+    if (g_opt_hash_size == 512)
+        return FormatHash(out, result->hash512, sizeof(result->hash512));
+
+    int length = FormatHash(out, result->hash256, sizeof(result->hash256));
+    out[length++] = ' ';
+    return length + FormatHash(out + length, result->hash512, sizeof(result->hash512));
+}
+
+static void StatsMerge(struct Stats *total, const struct Stats *part)
+{
+    total->bytes         += part->bytes;
+    total->reads         += part->reads;
+    total->read_ns       += part->read_ns;
+    total->hash_ns       += part->hash_ns;
+    total->cache_hits    += part->cache_hits;
+    total->chunks        += part->chunks;
+    total->chunks_reused += part->chunks_reused;
+
+    for (int i = 0; i < READ_SIZE_BUCKETS; i++)
+        total->read_sizes[i] += part->read_sizes[i];
+}
+
+int HashFiles(char **files, const int count, struct DigestCache *cache, struct Stats *stats)
+{
+    static struct FilesWorker workers[MAX_JOBS];
+    struct FilesWork          work = { files, count, cache, NULL, 0 };
+    char                      hex[HASH_HEX_MAX];
+    int                       rc   = 0;
+
+    work.results = calloc(count, sizeof(*work.results));
+    if (!work.results)
+        return ENOMEM;
+
+    int jobs = JobCount();
+    if (jobs > count)
+        jobs = count;
+
+    // the main thread is the worker 0
+    int started = 1;
+    for (; started < jobs; started++)
+    {
+        workers[started].work = &work;
+        if (pthread_create(&workers[started].thread, NULL, FilesThread, &workers[started]) != 0)
+            break;
+    }
+
+    workers[0].work = &work;
+    FilesThread(&workers[0]);
+
+    for (int i = 0; i < started; i++)
+    {
+        if (i > 0)
+            pthread_join(workers[i].thread, NULL);
+        StatsMerge(stats, &workers[i].stats);
+    }
+    stats->files += count;
+
+    for (int i = 0; i < count; i++)
+    {
+        const struct FileResult *result = &work.results[i];
+
+        if (result->rc != 0)
+        {
+            log_err("%s: %s", files[i], strerror(result->rc));
+            rc = rc ? rc : result->rc;
+            continue;
+        }
+
+        FormatResult(hex, result);
+        printf("%s  %s\n", hex, files[i]);
+    }
+
+    free(work.results);
+    return rc;
+}
@@ -0,0 +1,441 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    --records mode of gost34112018_cli: the input is a stream of records (lines,
+    NUL-terminated strings or u32le length-prefixed blobs), every record gets its own
+    digest.
+
+    --cdc is the same mode with content-defined chunks (GOST34112018_ChunkBoundary) as
+    the records, e.g. to deduplicate a backup stream: the boundaries are found by the
+    main thread while the workers hash the chunks of the previous batch.
+
+    The input is read in batches of about BATCH_BYTES. Records of a batch are hashed by
+    a pool of -j workers, which take RECORDS_PER_TAKE records at a time, so short and
+    long records are balanced between the workers without a lock per record. Two
+    batches are used in turns: while the workers hash one of them, the main thread reads
+    the next one and then prints the digests of the previous one, so the output keeps
+    the order of the input.
+ */
+
+#include "gost34112018_cli.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "stdatomic.h"
+#include "pthread.h"
+
+enum
+{
+    BATCH_BYTES      = 1 << 20,
+    RECORDS_PER_TAKE = 64,
+    U32LE_PREFIX     = 4,
+};
+
+struct Record
+{
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct Batch
+{
+    uint8_t       *data;
+    uint64_t       base;              // offset of data in the input
+    size_t         size;              // bytes read into data
+    size_t         capacity;
+    size_t         consumed;          // end of the last complete record
+    struct Record *records;
+    uint8_t       *digests;           // digest_size bytes per record
+    size_t         count;
+    size_t         records_capacity;
+};
+
+struct Pool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  start;
+    pthread_cond_t  done;
+    struct Batch   *batch;
+    uint64_t        generation;       // incremented for every submitted batch
+    int             busy;             // workers still hashing the batch
+    bool            quit;
+    _Atomic size_t  next;             // next record to be taken by a worker
+    pthread_t       threads[MAX_JOBS];
+    int             count;
+};
+
+static size_t g_digest_size;
+
+static size_t DigestSize(void)
+{
+    return g_opt_hash_size == HASH_SIZE_BOTH ? 32 + 64 : (size_t) g_opt_hash_size / 8;
+}
+
+static void HashRecord(const struct Batch *batch, const size_t i)
+{
+    const uint8_t *message = batch->data + batch->records[i].offset;
+    uint8_t       *digest  = batch->digests + i * g_digest_size;
+
+    if (g_opt_hash_size == HASH_SIZE_BOTH)
+        GOST34112018_HashBytesDual(message, batch->records[i].length, digest, digest + 32);
+    else
+        GOST34112018_HashBytes(message, batch->records[i].length,
+                               (GOST34112018_HashSize_t) g_digest_size, digest);
+}
+
+static void HashTakenRecords(const struct Batch *batch, _Atomic size_t *next)
+{
+    for (;;)
+    {
+        const size_t first = atomic_fetch_add_explicit(next, RECORDS_PER_TAKE,
+                                                       memory_order_relaxed);
+        if (first >= batch->count)
+            break;
+
+        const size_t last = first + RECORDS_PER_TAKE < batch->count ?
+                            first + RECORDS_PER_TAKE : batch->count;
+
+        for (size_t i = first; i < last; i++)
+            HashRecord(batch, i);
+    }
+}
+
+static void *WorkerThread(void *arg)
+{
+    struct Pool *pool = arg;
+    uint64_t     seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->quit && pool->generation == seen)
+            pthread_cond_wait(&pool->start, &pool->lock);
+
+        if (pool->quit)
+            break;
+
+        seen = pool->generation;
+        struct Batch *batch = pool->batch;
+        pthread_mutex_unlock(&pool->lock);
+
+        HashTakenRecords(batch, &pool->next);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+static int PoolStart(struct Pool *pool, const int count)
+{
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (pool->count = 0; pool->count < count; pool->count++)
+    {
+        if (pthread_create(&pool->threads[pool->count], NULL, WorkerThread, pool) != 0)
+        {
+            log_err("Could not create worker thread %d", pool->count);
+            return EAGAIN;
+        }
+    }
+
+    return 0;
+}
+
+static void PoolStop(struct Pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->count; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+/**
+    Hands the batch to the workers. Without workers (-j 1) the batch is hashed right
+    away by the calling thread.
+ */
+static void PoolSubmit(struct Pool *pool, struct Batch *batch)
+{
+    if (pool->count == 0)
+    {
+        for (size_t i = 0; i < batch->count; i++)
+            HashRecord(batch, i);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->batch = batch;
+    pool->busy  = pool->count;
+    atomic_store_explicit(&pool->next, 0, memory_order_relaxed);
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void PoolWait(struct Pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy != 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static int BatchReserveData(struct Batch *batch, const size_t capacity)
+{
+    if (batch->capacity >= capacity)
+        return 0;
+
+    uint8_t *data = realloc(batch->data, capacity);
+    if (!data)
+        return ENOMEM;
+
+    batch->data     = data;
+    batch->capacity = capacity;
+    return 0;
+}
+
+static int BatchAddRecord(struct Batch *batch, const uint64_t offset, const uint64_t length)
+{
+    if (batch->count == batch->records_capacity)
+    {
+        const size_t capacity = batch->records_capacity ? 2 * batch->records_capacity : 4096;
+
+        struct Record *records = realloc(batch->records, capacity * sizeof(*records));
+        if (!records)
+            return ENOMEM;
+        batch->records = records;
+
+        uint8_t *digests = realloc(batch->digests, capacity * g_digest_size);
+        if (!digests)
+            return ENOMEM;
+        batch->digests = digests;
+
+        batch->records_capacity = capacity;
+    }
+
+    batch->records[batch->count].offset = offset;
+    batch->records[batch->count].length = length;
+    batch->count++;
+    return 0;
+}
+
+/**
+    Splits the unparsed part of the batch into records. At the end of the input the
+    last unterminated line (string) is a record too, while an incomplete u32le record
+    is an error.
+ */
+static int BatchParse(struct Batch *batch, const bool eof)
+{
+    int rc = 0;
+
+    while (rc == 0 && batch->consumed < batch->size)
+    {
+        const size_t   offset = batch->consumed;
+        const size_t   left   = batch->size - offset;
+        const uint8_t *data   = batch->data + offset;
+
+        if (g_opt_records == RECORDS_U32LE)
+        {
+            if (left < U32LE_PREFIX)
+                break;
+
+            const uint64_t length = (uint64_t) data[0]       | (uint64_t) data[1] << 8 |
+                                    (uint64_t) data[2] << 16 | (uint64_t) data[3] << 24;
+            if (left - U32LE_PREFIX < length)
+                break;
+
+            rc = BatchAddRecord(batch, offset + U32LE_PREFIX, length);
+            batch->consumed += U32LE_PREFIX + length;
+        }
+        else if (g_opt_records == RECORDS_CDC)
+        {
+            const uint64_t length = GOST34112018_ChunkBoundary(&g_chunker, data, left);
+            if (length == left && left < g_chunker.max_size && !eof)
+                break;
+
+            rc = BatchAddRecord(batch, offset, length);
+            batch->consumed += length;
+        }
+        else
+        {
+            const uint8_t *end = memchr(data, g_opt_records == RECORDS_LINES ? '\n' : '\0', left);
+            if (!end && !eof)
+                break;
+
+            const size_t length = end ? (size_t) (end - data) : left;
+            rc = BatchAddRecord(batch, offset, length);
+            batch->consumed += end ? length + 1 : length;
+        }
+    }
+
+    if (rc == 0 && eof && batch->consumed != batch->size)
+    {
+        log_err("Truncated record at the end of the input");
+        rc = EINVAL;
+    }
+
+    return rc;
+}
+
+/**
+    Reads the next batch: the incomplete record left at the end of the previous batch,
+    then about BATCH_BYTES more. The buffer grows only if a single record does not fit
+    into it.
+ */
+static int BatchFill(struct Batch *batch, const struct Batch *prev, FILE *fin,
+                     struct Stats *stats, bool *eof)
+{
+    const size_t carry = prev->size - prev->consumed;
+    int          rc    = BatchReserveData(batch, carry > BATCH_BYTES ? 2 * carry : BATCH_BYTES);
+
+    batch->base     = prev->base + prev->consumed;
+    batch->size     = carry;
+    batch->consumed = 0;
+    batch->count    = 0;
+
+    if (rc != 0)
+        return rc;
+
+    if (carry)
+        memcpy(batch->data, prev->data + prev->consumed, carry);
+
+    while (rc == 0 && !*eof && (batch->count == 0 || batch->size < BATCH_BYTES))
+    {
+        if (batch->size == batch->capacity)
+        {
+            rc = BatchReserveData(batch, 2 * batch->capacity);
+            if (rc != 0)
+                break;
+        }
+
+        const ssize_t read = ReadInput(fin, batch->data + batch->size,
+                                       batch->capacity - batch->size, stats);
+        if (read < 0)
+        {
+            log_err("An error occurred while trying to read data");
+            return EIO;
+        }
+
+        *eof = (size_t) read < batch->capacity - batch->size;
+
+        batch->size += read;
+        rc = BatchParse(batch, *eof);
+    }
+
+    if (rc == ENOMEM)
+        log_err("Out of memory");
+
+    return rc;
+}
+
+static void BatchPrint(const struct Batch *batch)
+{
+    char line[2 * 21 + HASH_HEX_MAX + 1];
+
+    for (size_t i = 0; i < batch->count; i++)
+    {
+        const uint8_t *digest = batch->digests + i * g_digest_size;
+        int            length = 0;
+
+        if (g_opt_records == RECORDS_CDC)
+            length = sprintf(line, "%llu %llu ",
+                             (unsigned long long) (batch->base + batch->records[i].offset),
+                             (unsigned long long) batch->records[i].length);
+
+        if (g_opt_hash_size == HASH_SIZE_BOTH)
+        {
+            length += FormatHash(line + length, digest, 32);
+            line[length++] = ' ';
+            length += FormatHash(line + length, digest + 32, 64);
+        }
+        else
+        {
+            length += FormatHash(line + length, digest, g_digest_size);
+        }
+
+        line[length++] = '\n';
+        fwrite(line, 1, length, stdout);
+    }
+}
+
+static void BatchFree(struct Batch *batch)
+{
+    free(batch->data);
+    free(batch->records);
+    free(batch->digests);
+}
+
+int HashRecords(FILE *fin, struct Stats *stats)
+{
+    static char  output[1 << 20];
+    struct Batch batches[2] = { 0 };
+    struct Pool  pool       = { 0 };
+    bool         eof        = false;
+    int          current    = 0;
+    int          rc;
+
+    g_digest_size = DigestSize();
+    setvbuf(stdout, output, _IOFBF, sizeof(output));
+
+    rc = PoolStart(&pool, JobCount() > 1 ? JobCount() : 0);
+
+    if (rc == 0)
+        rc = BatchFill(&batches[current], &batches[1], fin, stats, &eof);
+
+    if (rc == 0)
+    {
+        const uint64_t t0 = StatsNow();
+        PoolSubmit(&pool, &batches[current]);
+        stats->hash_ns += StatsNow() - t0;
+    }
+
+    while (rc == 0 && batches[current].count != 0)
+    {
+        struct Batch *hashed = &batches[current];
+        struct Batch *next   = &batches[1 - current];
+
+        // read the next batch while the workers hash the current one
+        if (!eof)
+            rc = BatchFill(next, hashed, fin, stats, &eof);
+        else
+            next->count = 0;
+
+        // hash time is the time the main thread is blocked by hashing: the whole
+        // hashing with -j 1, only the waiting for the workers otherwise
+        const uint64_t t0 = StatsNow();
+        PoolWait(&pool);
+
+        if (rc == 0 && next->count != 0)
+            PoolSubmit(&pool, next);
+        stats->hash_ns += StatsNow() - t0;
+
+        // and print the current one while the workers hash the next one
+        BatchPrint(hashed);
+        stats->records += hashed->count;
+
+        current = 1 - current;
+    }
+
+    PoolWait(&pool);
+    PoolStop(&pool);
+
+    fflush(stdout);
+
+    BatchFree(&batches[0]);
+    BatchFree(&batches[1]);
+
+    return rc;
+}
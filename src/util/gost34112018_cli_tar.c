@@ -0,0 +1,400 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    --tar mode of gost34112018_cli: the input is a tar archive (ustar, with pax and GNU
+    long name extensions), every regular file of it is hashed without extraction.
+
+    The archive is read in INTERNAL_BUFFER_SIZE chunks with ReadInput, which only returns
+    less at the end of the input, so every chunk starts at a multiple of TAR_RECORD
+    (512) bytes of the archive. Headers never cross a chunk boundary, and the data of a
+    member is passed to HashBlock straight from the chunk, in blocks which are multiples
+    of BLOCK_SIZE everywhere except at the end of the member. The same chunks are hashed
+    as a whole for the digest of the archive.
+ */
+
+#include "gost34112018_cli.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+
+enum
+{
+    TAR_RECORD    = 512,
+    TAR_PATH_MAX  = 4096,
+    TAR_META_MAX  = 1 << 20, // pax headers and GNU long names larger than that are rejected
+};
+
+typedef enum
+{
+    TAR_HEADER,
+    TAR_DATA,   // data of a member
+    TAR_META,   // data of a pax header or a GNU long name, describes the next member
+    TAR_END,    // after the end-of-archive marker
+} TarState_t;
+
+/**
+    Offsets and sizes of the fields of a ustar header.
+ */
+enum
+{
+    TAR_NAME_OFFSET     = 0,   TAR_NAME_SIZE     = 100,
+    TAR_SIZE_OFFSET     = 124, TAR_SIZE_SIZE     = 12,
+    TAR_CHKSUM_OFFSET   = 148, TAR_CHKSUM_SIZE   = 8,
+    TAR_TYPE_OFFSET     = 156,
+    TAR_MAGIC_OFFSET    = 257,
+    TAR_PREFIX_OFFSET   = 345, TAR_PREFIX_SIZE   = 155,
+};
+
+struct TarReader
+{
+    TarState_t    state;
+    char          type;                     // type flag of the current member
+    uint64_t      left;                     // data bytes of the current member to come
+    uint64_t      padding;                  // bytes up to the next header
+    char          path[TAR_PATH_MAX + 1];   // path of the current member
+    char          next_path[TAR_PATH_MAX + 1]; // path of the next member from pax/GNU
+    uint64_t      next_size;                // size of the next member from pax
+    bool          has_next_path;
+    bool          has_next_size;
+    char         *meta;
+    uint64_t      meta_size;
+    struct Hasher member;
+};
+
+static uint64_t ParseOctal(const uint8_t *field, const int size)
+{
+    uint64_t value = 0;
+
+    // GNU base-256 encoding of large sizes
+    if (field[0] & 0x80)
+    {
+        value = field[0] & 0x3f;
+        for (int i = 1; i < size; i++)
+            value = value << 8 | field[i];
+        return value;
+    }
+
+    for (int i = 0; i < size && field[i] >= '0' && field[i] <= '7'; i++)
+        value = value << 3 | (uint64_t) (field[i] - '0');
+
+    return value;
+}
+
+static bool IsZeroRecord(const uint8_t *header)
+{
+    for (int i = 0; i < TAR_RECORD; i++)
+    {
+        if (header[i])
+            return false;
+    }
+    return true;
+}
+
+static bool ChecksumValid(const uint8_t *header)
+{
+    uint64_t sum = 0;
+
+    // the checksum field itself is counted as spaces
+    for (int i = 0; i < TAR_RECORD; i++)
+    {
+        const bool in_checksum = i >= TAR_CHKSUM_OFFSET && i < TAR_CHKSUM_OFFSET + TAR_CHKSUM_SIZE;
+        sum += in_checksum ? ' ' : header[i];
+    }
+
+    // skip leading spaces, some writers pad the field from the left
+    int start = TAR_CHKSUM_OFFSET;
+    while (start < TAR_CHKSUM_OFFSET + TAR_CHKSUM_SIZE && header[start] == ' ')
+        start++;
+
+    return ParseOctal(header + start, TAR_CHKSUM_OFFSET + TAR_CHKSUM_SIZE - start) == sum;
+}
+
+/**
+    Copies a field, which is NUL-terminated only if it is shorter than 'size'.
+ */
+static size_t CopyField(char *out, const uint8_t *field, const size_t size)
+{
+    const uint8_t *end    = memchr(field, '\0', size);
+    const size_t   length = end ? (size_t) (end - field) : size;
+
+    memcpy(out, field, length);
+    out[length] = '\0';
+    return length;
+}
+
+/**
+    Parses "LENGTH key=value\n" records of a pax extended header, only 'path' and 'size'
+    are of interest.
+ */
+static int ParsePax(struct TarReader *tar)
+{
+    uint64_t offset = 0;
+
+    while (offset < tar->meta_size)
+    {
+        char          *record = tar->meta + offset;
+        char          *end;
+        const uint64_t length = strtoull(record, &end, 10);
+
+        // the length is checked against what is left before record + length is formed
+        if (*end != ' ' || length > tar->meta_size - offset ||
+            (uint64_t) (end - record) + 1 >= length || record[length - 1] != '\n')
+        {
+            log_err("Malformed pax header");
+            return EINVAL;
+        }
+
+        char          *key          = end + 1;
+        char          *equals       = memchr(key, '=', record + length - key);
+        const uint64_t value_length = equals ? (uint64_t) (record + length - 1 - (equals + 1)) : 0;
+
+        if (!equals)
+        {
+            log_err("Malformed pax header");
+            return EINVAL;
+        }
+
+        if (equals - key == 4 && memcmp(key, "path", 4) == 0)
+        {
+            if (value_length > TAR_PATH_MAX)
+            {
+                log_err("Path of a member is too long");
+                return ENAMETOOLONG;
+            }
+            memcpy(tar->next_path, equals + 1, value_length);
+            tar->next_path[value_length] = '\0';
+            tar->has_next_path = true;
+        }
+        else if (equals - key == 4 && memcmp(key, "size", 4) == 0)
+        {
+            tar->next_size     = strtoull(equals + 1, NULL, 10);
+            tar->has_next_size = true;
+        }
+
+        offset += length;
+    }
+
+    return 0;
+}
+
+static int FinishMeta(struct TarReader *tar)
+{
+    tar->meta[tar->meta_size] = '\0';
+
+    if (tar->type == 'x')
+        return ParsePax(tar);
+
+    if (tar->type == 'L')
+    {
+        // GNU long name, the data is the NUL-terminated name
+        const size_t length = strnlen(tar->meta, tar->meta_size);
+        if (length > TAR_PATH_MAX)
+        {
+            log_err("Path of a member is too long");
+            return ENAMETOOLONG;
+        }
+        memcpy(tar->next_path, tar->meta, length);
+        tar->next_path[length] = '\0';
+        tar->has_next_path = true;
+    }
+
+    // global pax headers ('g') and GNU long link names ('K') do not change the path
+    return 0;
+}
+
+static void FinishMember(struct TarReader *tar)
+{
+    char hex[HASH_HEX_MAX];
+
+    HasherEnd(&tar->member);
+    HasherFormat(&tar->member, hex);
+    printf("%s  %s\n", hex, tar->path);
+}
+
+static int ParseHeader(struct TarReader *tar, const uint8_t *header)
+{
+    if (IsZeroRecord(header))
+    {
+        tar->state = TAR_END;
+        return 0;
+    }
+
+    if (!ChecksumValid(header))
+    {
+        log_err("Invalid header checksum, not a tar archive or it is corrupted");
+        return EINVAL;
+    }
+
+    tar->type    = header[TAR_TYPE_OFFSET];
+    tar->left    = ParseOctal(header + TAR_SIZE_OFFSET, TAR_SIZE_SIZE);
+    tar->padding = (TAR_RECORD - tar->left % TAR_RECORD) % TAR_RECORD;
+
+    if (tar->type == 'x' || tar->type == 'g' || tar->type == 'L' || tar->type == 'K')
+    {
+        if (tar->left > TAR_META_MAX)
+        {
+            log_err("Extended header is too large");
+            return EINVAL;
+        }
+
+        char *meta = realloc(tar->meta, tar->left + 1);
+        if (!meta)
+        {
+            log_err("Out of memory");
+            return ENOMEM;
+        }
+
+        tar->meta      = meta;
+        tar->meta_size = 0;
+        tar->state     = TAR_META;
+        return 0;
+    }
+
+    if (tar->has_next_size)
+    {
+        tar->left    = tar->next_size;
+        tar->padding = (TAR_RECORD - tar->left % TAR_RECORD) % TAR_RECORD;
+    }
+
+    if (tar->has_next_path)
+    {
+        strcpy(tar->path, tar->next_path);
+    }
+    else
+    {
+        size_t length = 0;
+
+        // POSIX ustar splits long paths into a prefix and a name (the old GNU format,
+        // "ustar  ", keeps other fields there)
+        if (memcmp(header + TAR_MAGIC_OFFSET, "ustar", 6) == 0 && header[TAR_PREFIX_OFFSET])
+        {
+            length = CopyField(tar->path, header + TAR_PREFIX_OFFSET, TAR_PREFIX_SIZE);
+            tar->path[length++] = '/';
+        }
+        CopyField(tar->path + length, header + TAR_NAME_OFFSET, TAR_NAME_SIZE);
+    }
+
+    tar->has_next_path = false;
+    tar->has_next_size = false;
+
+    // hard links, symbolic links, directories and devices have no data to hash
+    if (tar->type == '0' || tar->type == '\0' || tar->type == '7')
+    {
+        HasherInit(&tar->member);
+        if (tar->left == 0)
+            FinishMember(tar);
+    }
+
+    tar->state = tar->left ? TAR_DATA : TAR_HEADER;
+    return 0;
+}
+
+/**
+    Processes one chunk of the archive.
+ */
+static int TarProcess(struct TarReader *tar, const uint8_t *chunk, const uint64_t size)
+{
+    uint64_t offset = 0;
+    int      rc     = 0;
+
+    while (rc == 0 && offset < size && tar->state != TAR_END)
+    {
+        if (tar->left == 0 && tar->padding != 0)
+        {
+            const uint64_t skip = size - offset < tar->padding ? size - offset : tar->padding;
+            tar->padding -= skip;
+            offset       += skip;
+            continue;
+        }
+
+        if (tar->state == TAR_HEADER || tar->left == 0)
+        {
+            if (tar->state == TAR_META)
+            {
+                rc = FinishMeta(tar);
+                tar->state = TAR_HEADER;
+                continue;
+            }
+
+            if (size - offset < TAR_RECORD)
+            {
+                log_err("Truncated tar header");
+                return EINVAL;
+            }
+
+            rc = ParseHeader(tar, chunk + offset);
+            offset += TAR_RECORD;
+            continue;
+        }
+
+        const uint64_t n = size - offset < tar->left ? size - offset : tar->left;
+
+        if (tar->state == TAR_META)
+        {
+            memcpy(tar->meta + tar->meta_size, chunk + offset, n);
+            tar->meta_size += n;
+        }
+        else if (tar->type == '0' || tar->type == '\0' || tar->type == '7')
+        {
+            HasherUpdate(&tar->member, chunk + offset, n);
+            if (n == tar->left)
+                FinishMember(tar);
+        }
+
+        tar->left -= n;
+        offset    += n;
+
+        if (tar->left == 0 && tar->state == TAR_DATA)
+            tar->state = TAR_HEADER;
+    }
+
+    return rc;
+}
+
+int HashTar(FILE *fin, const char *name, struct Stats *stats)
+{
+    static uint8_t          chunk[INTERNAL_BUFFER_SIZE];
+    static struct TarReader tar;
+    struct Hasher           archive;
+    char                    hex[HASH_HEX_MAX];
+    int                     rc = 0;
+
+    HasherInit(&archive);
+
+    while (rc == 0)
+    {
+        const ssize_t size = ReadInput(fin, chunk, sizeof(chunk), stats);
+        if (size < 0)
+        {
+            log_err("An error occurred while trying to read data");
+            rc = EIO;
+            break;
+        }
+
+        const uint64_t t1 = StatsNow();
+        HasherUpdate(&archive, chunk, size);
+        rc = TarProcess(&tar, chunk, size);
+        stats->hash_ns += StatsNow() - t1;
+
+        if ((size_t) size < sizeof(chunk))
+            break;
+    }
+
+    // a missing end-of-archive marker is tolerated, like GNU tar does
+    if (rc == 0 && tar.state != TAR_END && (tar.state != TAR_HEADER || tar.padding))
+    {
+        log_err("Truncated tar archive");
+        rc = EINVAL;
+    }
+
+    if (rc == 0)
+    {
+        HasherEnd(&archive);
+        HasherFormat(&archive, hex);
+        printf("%s  %s\n", hex, name);
+    }
+
+    free(tar.meta);
+    return rc;
+}
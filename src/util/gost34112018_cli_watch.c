@@ -0,0 +1,924 @@
+// Copyright 2025, Anufriev Ilia, anufriewwi@rambler.ru
+// SPDX-License-Identifier: BSD-3-Clause-No-Military-License OR GPL-3.0-or-later
+
+/**
+    --watch mode of gost34112018_cli: a continuous integrity monitor of a directory tree.
+
+    Every directory of the tree gets an inotify watch, and the files of the tree are
+    hashed once at the start. After that a file is only hashed again when it has been
+    modified, closed after writing or moved into the tree, and not before it has been
+    left alone for --debounce milliseconds, so a file rewritten several times in a row
+    is hashed once. Every write pushes the deadline out. Writes through a shared
+    mapping are not reported by inotify and go unnoticed.
+
+    The digests are kept in a table owned by the main thread. Files whose deadlines
+    have passed are hashed by -j workers, at most IN_FLIGHT_PER_WORKER files per worker
+    at a time; the rest wait in the table, where further changes of a file merge into
+    the rehash already pending. A result is dropped if the file has changed again while
+    it was hashed.
+
+    SIGUSR1 prints the table as 'DIGEST  PATH' lines, sorted by path. SIGUSR2 prints the
+    changes since the previous SIGUSR2 (or the start): '+ DIGEST  PATH' for an added,
+    '~ DIGEST  PATH' for a changed and '- PATH' for a removed file. Files waiting to be
+    hashed are left for the next diff. If the inotify queue overflows, the whole tree is
+    scanned and hashed again.
+ */
+
+#define _GNU_SOURCE
+
+#include "gost34112018_cli.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "limits.h"
+#include "signal.h"
+#include "pthread.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "dirent.h"
+#include "poll.h"
+#include "time.h"
+#include "sys/eventfd.h"
+#include "sys/inotify.h"
+#include "sys/signalfd.h"
+
+enum
+{
+    IN_FLIGHT_PER_WORKER = 4,
+    TABLE_MIN_BUCKETS    = 1024,
+    EVENT_BUFFER_SIZE    = 64 * 1024,
+};
+
+static const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE |
+                                   IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR |
+                                   IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+typedef enum
+{
+    ENTRY_IDLE,     // the digest is up to date, or the file is gone
+    ENTRY_DIRTY,    // changed, waiting for its deadline in the dirty list
+    ENTRY_HASHING,  // given to a worker
+} EntryState_t;
+
+struct WatchEntry
+{
+    struct WatchEntry *next;        // in a bucket
+    struct WatchEntry *dirty_prev;
+    struct WatchEntry *dirty_next;
+    uint64_t           deadline_ns;
+    uint32_t           generation;  // bumped by every change, older results are dropped
+    uint32_t           scan;        // the last scan which has seen the file
+    EntryState_t       state;
+    bool               present;     // 'current' is the digest of an existing file
+    bool               reported;    // 'baseline' is the digest of the previous diff
+    bool               adopt;       // found by the first scan, its digest is the baseline
+    struct FileResult  current;
+    struct FileResult  baseline;
+    char               path[];
+};
+
+struct WatchJob
+{
+    struct WatchJob   *next;
+    uint32_t           generation;
+    struct FileResult  result;
+    char               path[];
+};
+
+struct WatchQueue
+{
+    pthread_mutex_t  lock;
+    pthread_cond_t   ready;
+    struct WatchJob *head;
+    struct WatchJob *tail;
+    struct WatchJob *done;
+    bool             quit;
+    int              eventfd;       // written when a job is done
+};
+
+struct Monitor
+{
+    const char         *root;
+    int                 inotify;
+    int                 root_wd;
+    char              **watches;    // paths of the watched directories by descriptor
+    int                 watch_count;
+    size_t              directories;
+    struct WatchEntry **buckets;
+    size_t              mask;
+    size_t              files;      // entries, including removed files not reported yet
+    struct WatchEntry  *dirty_head; // sorted by deadline
+    struct WatchEntry  *dirty_tail;
+    uint32_t            scan;
+    int                 in_flight;
+    int                 max_in_flight;
+    bool                ready;      // the first scan is hashed
+};
+
+static struct WatchQueue g_queue = {
+    .lock    = PTHREAD_MUTEX_INITIALIZER,
+    .ready   = PTHREAD_COND_INITIALIZER,
+    .eventfd = -1,
+};
+
+static uint64_t Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t PathHash(const char *path)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    for (; *path; path++)
+        h = (h ^ (uint8_t) *path) * 0x100000001b3ull;
+
+    return h;
+}
+
+static struct WatchEntry **FindSlot(struct Monitor *m, const char *path)
+{
+    struct WatchEntry **slot = &m->buckets[PathHash(path) & m->mask];
+
+    while (*slot && strcmp((*slot)->path, path) != 0)
+        slot = &(*slot)->next;
+
+    return slot;
+}
+
+static void Grow(struct Monitor *m)
+{
+    const size_t        count   = (m->mask + 1) * 2;
+    struct WatchEntry **buckets = calloc(count, sizeof(*buckets));
+
+    // a crowded table is still correct, only slower
+    if (!buckets)
+        return;
+
+    for (size_t i = 0; i <= m->mask; i++)
+    {
+        while (m->buckets[i])
+        {
+            struct WatchEntry *entry = m->buckets[i];
+            const size_t       index = PathHash(entry->path) & (count - 1);
+
+            m->buckets[i]  = entry->next;
+            entry->next    = buckets[index];
+            buckets[index] = entry;
+        }
+    }
+
+    free(m->buckets);
+    m->buckets = buckets;
+    m->mask    = count - 1;
+}
+
+static void DirtyUnlink(struct Monitor *m, struct WatchEntry *entry)
+{
+    if (entry->dirty_prev)
+        entry->dirty_prev->dirty_next = entry->dirty_next;
+    else
+        m->dirty_head = entry->dirty_next;
+
+    if (entry->dirty_next)
+        entry->dirty_next->dirty_prev = entry->dirty_prev;
+    else
+        m->dirty_tail = entry->dirty_prev;
+
+    entry->dirty_prev = entry->dirty_next = NULL;
+}
+
+/**
+    Puts an entry at the end of the dirty list. The debounce time is the same for all
+    of the entries (only the first scan goes without it, before any event), so the
+    list stays sorted by deadline.
+ */
+static void DirtyAppend(struct Monitor *m, struct WatchEntry *entry, const uint64_t delay_ns)
+{
+    if (entry->state == ENTRY_DIRTY)
+        DirtyUnlink(m, entry);
+
+    entry->state       = ENTRY_DIRTY;
+    entry->deadline_ns = Now() + delay_ns;
+    entry->dirty_prev  = m->dirty_tail;
+    entry->dirty_next  = NULL;
+
+    if (m->dirty_tail)
+        m->dirty_tail->dirty_next = entry;
+    else
+        m->dirty_head = entry;
+    m->dirty_tail = entry;
+}
+
+/**
+    Schedules a rehash of a file, adding it to the table if it is new.
+ */
+static void Touch(struct Monitor *m, const char *path, const bool adopt)
+{
+    struct WatchEntry **slot  = FindSlot(m, path);
+    struct WatchEntry  *entry = *slot;
+
+    if (!entry)
+    {
+        const size_t length = strlen(path) + 1;
+
+        entry = calloc(1, sizeof(*entry) + length);
+        if (!entry)
+        {
+            log_err("%s: %s", path, strerror(ENOMEM));
+            return;
+        }
+
+        memcpy(entry->path, path, length);
+        entry->adopt = adopt;
+        *slot        = entry;
+
+        if (++m->files > m->mask + 1)
+            Grow(m);
+    }
+
+    entry->generation++;
+    entry->scan = m->scan;
+    DirtyAppend(m, entry, adopt ? 0 : (uint64_t) g_opt_debounce_ms * 1000000ull);
+}
+
+/**
+    Forgets a file. A file which has been reported by a diff stays in the table until
+    the next diff reports it as removed.
+ */
+static void Remove(struct Monitor *m, struct WatchEntry **slot)
+{
+    struct WatchEntry *entry = *slot;
+
+    if (entry->state == ENTRY_DIRTY)
+        DirtyUnlink(m, entry);
+
+    entry->generation++;
+    entry->state   = ENTRY_IDLE;
+    entry->present = false;
+    entry->adopt   = false;
+
+    if (!entry->reported)
+    {
+        *slot = entry->next;
+        free(entry);
+        m->files--;
+    }
+}
+
+static void RemovePath(struct Monitor *m, const char *path)
+{
+    struct WatchEntry **slot = FindSlot(m, path);
+
+    if (*slot)
+        Remove(m, slot);
+}
+
+/**
+    Forgets every file for which 'keep' is false.
+ */
+static void RemoveIf(struct Monitor *m, bool (*keep)(const struct Monitor *,
+                                                     const struct WatchEntry *, const void *),
+                     const void *arg)
+{
+    for (size_t i = 0; i <= m->mask; i++)
+    {
+        struct WatchEntry **slot = &m->buckets[i];
+
+        while (*slot)
+        {
+            struct WatchEntry *entry = *slot;
+
+            if ((entry->present || entry->state != ENTRY_IDLE) && !keep(m, entry, arg))
+                Remove(m, slot);
+
+            // the entry is either still in the slot, or has been unlinked from it
+            if (*slot == entry)
+                slot = &entry->next;
+        }
+    }
+}
+
+static bool IsUnder(const char *path, const char *directory)
+{
+    const size_t length = strlen(directory);
+
+    return strncmp(path, directory, length) == 0 && path[length] == '/';
+}
+
+static bool OutsideDirectory(const struct Monitor *m, const struct WatchEntry *entry,
+                             const void *directory)
+{
+    (void) m;
+    return !IsUnder(entry->path, directory);
+}
+
+static bool SeenByScan(const struct Monitor *m, const struct WatchEntry *entry,
+                       const void *arg)
+{
+    (void) arg;
+    return entry->scan == m->scan;
+}
+
+static int AddWatch(struct Monitor *m, const char *path)
+{
+    const int wd = inotify_add_watch(m->inotify, path, WATCH_MASK);
+    if (wd < 0)
+    {
+        log_err("Could not watch %s: %s", path, strerror(errno));
+        return wd;
+    }
+
+    if (wd >= m->watch_count)
+    {
+        const int count   = wd < 64 ? 128 : 2 * wd;
+        char    **watches = realloc(m->watches, count * sizeof(*watches));
+        if (!watches)
+        {
+            inotify_rm_watch(m->inotify, wd);
+            log_err("Could not watch %s: %s", path, strerror(ENOMEM));
+            return -1;
+        }
+
+        memset(watches + m->watch_count, 0, (count - m->watch_count) * sizeof(*watches));
+        m->watches     = watches;
+        m->watch_count = count;
+    }
+
+    // a directory moved within the tree keeps its descriptor
+    if (m->watches[wd])
+        free(m->watches[wd]);
+    else
+        m->directories++;
+
+    m->watches[wd] = strdup(path);
+    return wd;
+}
+
+static void ForgetWatch(struct Monitor *m, const int wd)
+{
+    if (wd < 0 || wd >= m->watch_count || !m->watches[wd])
+        return;
+
+    free(m->watches[wd]);
+    m->watches[wd] = NULL;
+    m->directories--;
+}
+
+static void RemoveWatchesUnder(struct Monitor *m, const char *directory)
+{
+    for (int wd = 0; wd < m->watch_count; wd++)
+    {
+        if (m->watches[wd] && (strcmp(m->watches[wd], directory) == 0 ||
+                               IsUnder(m->watches[wd], directory)))
+        {
+            inotify_rm_watch(m->inotify, wd);
+            ForgetWatch(m, wd);
+        }
+    }
+}
+
+/**
+    Watches a directory and everything below it, and schedules all of its files. The
+    watch is added before the directory is read, so a file created in the meantime is
+    either read or reported.
+ */
+static void Scan(struct Monitor *m, const char *directory, const bool adopt)
+{
+    char path[PATH_MAX];
+
+    if (AddWatch(m, directory) < 0)
+        return;
+
+    DIR *dir = opendir(directory);
+    if (!dir)
+    {
+        log_err("Could not read %s: %s", directory, strerror(errno));
+        return;
+    }
+
+    for (struct dirent *item; (item = readdir(dir));)
+    {
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0)
+            continue;
+
+        if (snprintf(path, sizeof(path), "%s/%s", directory, item->d_name) >= (int) sizeof(path))
+        {
+            log_err("%s/%s: %s", directory, item->d_name, strerror(ENAMETOOLONG));
+            continue;
+        }
+
+        unsigned char type = item->d_type;
+        if (type == DT_UNKNOWN)
+        {
+            struct stat st;
+            if (fstatat(dirfd(dir), item->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                continue;
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+
+        // symbolic links are not followed, their targets may be outside the tree
+        if (type == DT_DIR)
+            Scan(m, path, adopt);
+        else if (type == DT_REG)
+            Touch(m, path, adopt);
+    }
+
+    closedir(dir);
+}
+
+static void Rescan(struct Monitor *m)
+{
+    log_err("Events have been lost, scanning %s again", m->root);
+
+    m->scan++;
+    Scan(m, m->root, false);
+    RemoveIf(m, SeenByScan, NULL);
+}
+
+static void HandleEvent(struct Monitor *m, const struct inotify_event *event)
+{
+    char path[PATH_MAX];
+
+    if (event->mask & IN_Q_OVERFLOW)
+    {
+        Rescan(m);
+        return;
+    }
+
+    if (event->mask & IN_IGNORED)
+    {
+        if (event->wd == m->root_wd)
+            log_err("%s is gone, only the digests are left", m->root);
+        ForgetWatch(m, event->wd);
+        return;
+    }
+
+    if (event->wd < 0 || event->wd >= m->watch_count || !m->watches[event->wd] || !event->len)
+        return;
+
+    if (snprintf(path, sizeof(path), "%s/%s", m->watches[event->wd], event->name) >=
+        (int) sizeof(path))
+        return;
+
+    if (event->mask & IN_ISDIR)
+    {
+        if (event->mask & (IN_CREATE | IN_MOVED_TO))
+        {
+            Scan(m, path, false);
+        }
+        else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+        {
+            // a directory moved out of the tree reports nothing about its files
+            RemoveIf(m, OutsideDirectory, path);
+            RemoveWatchesUnder(m, path);
+        }
+        return;
+    }
+
+    if (event->mask & IN_CLOSE_WRITE)
+    {
+        Touch(m, path, false);
+    }
+    else if (event->mask & IN_MOVED_TO)
+    {
+        struct stat st;
+        if (lstat(path, &st) == 0 && S_ISREG(st.st_mode))
+            Touch(m, path, false);
+    }
+    else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+    {
+        RemovePath(m, path);
+    }
+    else if (event->mask & IN_MODIFY)
+    {
+        struct WatchEntry *entry = *FindSlot(m, path);
+
+        // truncate, fallocate and hole punching are not followed by IN_CLOSE_WRITE; a
+        // result being computed is dropped, the file has changed under the worker
+        if (entry)
+        {
+            if (entry->state == ENTRY_HASHING)
+                entry->generation++;
+            DirtyAppend(m, entry, (uint64_t) g_opt_debounce_ms * 1000000ull);
+        }
+    }
+}
+
+static int ReadEvents(struct Monitor *m)
+{
+    static uint8_t buffer[EVENT_BUFFER_SIZE]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;)
+    {
+        const ssize_t n = read(m->inotify, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return errno == EAGAIN ? 0 : errno;
+
+        for (ssize_t i = 0; i < n;)
+        {
+            const struct inotify_event *event = (const struct inotify_event *) (buffer + i);
+            HandleEvent(m, event);
+            i += sizeof(*event) + event->len;
+        }
+    }
+}
+
+static void *WorkerThread(void *arg)
+{
+    struct DigestCache *cache  = arg;
+    struct Stats        stats  = { 0 };
+    uint8_t            *buffer = malloc(FILE_READ_SIZE);
+
+    for (;;)
+    {
+        pthread_mutex_lock(&g_queue.lock);
+        while (!g_queue.head && !g_queue.quit)
+            pthread_cond_wait(&g_queue.ready, &g_queue.lock);
+
+        struct WatchJob *job = g_queue.head;
+        if (job)
+        {
+            g_queue.head = job->next;
+            if (!g_queue.head)
+                g_queue.tail = NULL;
+        }
+        pthread_mutex_unlock(&g_queue.lock);
+
+        // queued jobs are dropped on quit, nobody waits for them
+        if (!job)
+            break;
+
+        job->result.rc = buffer ? HashFile(job->path, cache, &job->result, &stats, buffer)
+                                : ENOMEM;
+
+        pthread_mutex_lock(&g_queue.lock);
+        job->next    = g_queue.done;
+        g_queue.done = job;
+        pthread_mutex_unlock(&g_queue.lock);
+
+        const uint64_t one = 1;
+        while (write(g_queue.eventfd, &one, sizeof(one)) < 0 && errno == EINTR)
+            ;
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+/**
+    Gives the files whose deadlines have passed to the workers.
+    @return     milliseconds until the next deadline, or -1 if there is nothing to wait for.
+ */
+static int Dispatch(struct Monitor *m)
+{
+    const uint64_t now = Now();
+
+    while (m->dirty_head && m->in_flight < m->max_in_flight)
+    {
+        struct WatchEntry *entry = m->dirty_head;
+
+        if (entry->deadline_ns > now)
+            return (int) ((entry->deadline_ns - now + 999999) / 1000000);
+
+        const size_t     length = strlen(entry->path) + 1;
+        struct WatchJob *job    = calloc(1, sizeof(*job) + length);
+        if (!job)
+            return 1000; // maybe later
+
+        DirtyUnlink(m, entry);
+        entry->state = ENTRY_HASHING;
+
+        memcpy(job->path, entry->path, length);
+        job->generation = entry->generation;
+
+        pthread_mutex_lock(&g_queue.lock);
+        if (g_queue.tail)
+            g_queue.tail->next = job;
+        else
+            g_queue.head = job;
+        g_queue.tail = job;
+        pthread_cond_signal(&g_queue.ready);
+        pthread_mutex_unlock(&g_queue.lock);
+
+        m->in_flight++;
+    }
+
+    return -1;
+}
+
+static void Complete(struct Monitor *m)
+{
+    uint64_t value;
+    while (read(g_queue.eventfd, &value, sizeof(value)) < 0 && errno == EINTR)
+        ;
+
+    pthread_mutex_lock(&g_queue.lock);
+    struct WatchJob *job = g_queue.done;
+    g_queue.done = NULL;
+    pthread_mutex_unlock(&g_queue.lock);
+
+    while (job)
+    {
+        struct WatchJob    *next  = job->next;
+        struct WatchEntry **slot  = FindSlot(m, job->path);
+        struct WatchEntry  *entry = *slot;
+
+        m->in_flight--;
+
+        if (entry && entry->state == ENTRY_HASHING && entry->generation == job->generation)
+        {
+            entry->state = ENTRY_IDLE;
+
+            if (job->result.rc == 0)
+            {
+                entry->current = job->result;
+                entry->present = true;
+
+                if (entry->adopt)
+                {
+                    entry->baseline = entry->current;
+                    entry->reported = true;
+                    entry->adopt    = false;
+                }
+            }
+            else if (job->result.rc == ENOENT)
+            {
+                // deleted before its event has been read
+                Remove(m, slot);
+            }
+            else
+            {
+                log_err("%s: %s", job->path, strerror(job->result.rc));
+            }
+        }
+
+        free(job);
+        job = next;
+    }
+}
+
+static int ComparePaths(const void *lhs, const void *rhs)
+{
+    return strcmp((*(struct WatchEntry *const *) lhs)->path,
+                  (*(struct WatchEntry *const *) rhs)->path);
+}
+
+/**
+    @return     all of the entries, sorted by path, or NULL if they could not be
+                allocated.
+ */
+static struct WatchEntry **SortedEntries(const struct Monitor *m)
+{
+    struct WatchEntry **sorted = malloc((m->files ? m->files : 1) * sizeof(*sorted));
+    size_t              count  = 0;
+
+    if (!sorted)
+    {
+        log_err("Could not sort %zu files: %s", m->files, strerror(ENOMEM));
+        return NULL;
+    }
+
+    for (size_t i = 0; i <= m->mask; i++)
+    {
+        for (struct WatchEntry *entry = m->buckets[i]; entry; entry = entry->next)
+            sorted[count++] = entry;
+    }
+
+    qsort(sorted, count, sizeof(*sorted), ComparePaths);
+    return sorted;
+}
+
+static void Dump(const struct Monitor *m)
+{
+    struct WatchEntry **sorted = SortedEntries(m);
+    char                hex[HASH_HEX_MAX];
+
+    if (!sorted)
+        return;
+
+    for (size_t i = 0; i < m->files; i++)
+    {
+        if (!sorted[i]->present)
+            continue;
+
+        FormatResult(hex, &sorted[i]->current);
+        printf("%s  %s\n", hex, sorted[i]->path);
+    }
+
+    fflush(stdout);
+    free(sorted);
+}
+
+static void Diff(struct Monitor *m)
+{
+    struct WatchEntry **sorted = SortedEntries(m);
+    const size_t        count  = m->files;
+    char                hex[HASH_HEX_MAX];
+
+    if (!sorted)
+        return;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        struct WatchEntry *entry = sorted[i];
+
+        // the digest is about to change, the next diff has it
+        if (entry->state != ENTRY_IDLE)
+            continue;
+
+        if (!entry->present)
+        {
+            // a file which could not be hashed is not reported at all
+            if (entry->reported)
+            {
+                printf("- %s\n", entry->path);
+                entry->reported = false;
+                RemovePath(m, entry->path);
+            }
+            continue;
+        }
+
+        if (entry->reported && memcmp(&entry->current, &entry->baseline,
+                                      sizeof(entry->current)) == 0)
+            continue;
+
+        FormatResult(hex, &entry->current);
+        printf("%c %s  %s\n", entry->reported ? '~' : '+', hex, entry->path);
+
+        entry->baseline = entry->current;
+        entry->reported = true;
+    }
+
+    fflush(stdout);
+    free(sorted);
+}
+
+static void FreeMonitor(struct Monitor *m)
+{
+    for (size_t i = 0; m->buckets && i <= m->mask; i++)
+    {
+        while (m->buckets[i])
+        {
+            struct WatchEntry *next = m->buckets[i]->next;
+            free(m->buckets[i]);
+            m->buckets[i] = next;
+        }
+    }
+
+    for (int wd = 0; wd < m->watch_count; wd++)
+        free(m->watches[wd]);
+
+    free(m->buckets);
+    free(m->watches);
+
+    if (m->inotify >= 0)
+        close(m->inotify);
+}
+
+int RunWatch(const char *root, struct DigestCache *cache)
+{
+    pthread_t      workers[MAX_JOBS];
+    struct Monitor m       = { .inotify = -1 };
+    char           path[PATH_MAX];
+    sigset_t       signals;
+    int            count   = 0;
+    int            rc      = 0;
+    bool           stop    = false;
+
+    // paths are printed the way they are given, without a trailing slash
+    size_t length = strlen(root);
+    while (length > 1 && root[length - 1] == '/')
+        length--;
+    if (length >= sizeof(path))
+        return ENAMETOOLONG;
+    memcpy(path, root, length);
+    path[length] = '\0';
+
+    m.root          = path;
+    m.max_in_flight = JobCount() * IN_FLIGHT_PER_WORKER;
+    m.mask          = TABLE_MIN_BUCKETS - 1;
+    m.buckets       = calloc(TABLE_MIN_BUCKETS, sizeof(*m.buckets));
+    m.inotify       = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    g_queue.eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    // the signals are taken by the main loop, the workers inherit the mask
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    const int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    if (!m.buckets || m.inotify < 0 || g_queue.eventfd < 0 || signal_fd < 0)
+    {
+        log_err("Could not set up the monitor: %s", strerror(errno ? errno : ENOMEM));
+        rc = EIO;
+        goto out;
+    }
+
+    m.root_wd = AddWatch(&m, m.root);
+    if (m.root_wd < 0)
+    {
+        rc = ENOENT;
+        goto out;
+    }
+
+    for (; count < JobCount(); count++)
+    {
+        if (pthread_create(&workers[count], NULL, WorkerThread, cache) != 0)
+        {
+            log_err("Could not create worker thread %d", count);
+            rc   = EAGAIN;
+            stop = true;
+            break;
+        }
+    }
+
+    Scan(&m, m.root, true);
+
+    while (!stop)
+    {
+        struct pollfd fds[] = {
+            { .fd = m.inotify,       .events = POLLIN },
+            { .fd = g_queue.eventfd, .events = POLLIN },
+            { .fd = signal_fd,       .events = POLLIN },
+        };
+
+        const int timeout = Dispatch(&m);
+
+        if (!m.ready && !m.dirty_head && m.in_flight == 0)
+        {
+            fprintf(stderr, "Watching %zu files in %zu directories\n", m.files, m.directories);
+            m.ready = true;
+        }
+
+        if (poll(fds, 3, timeout) < 0 && errno != EINTR)
+        {
+            log_err("poll failed: %s", strerror(errno));
+            rc = EIO;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            rc = ReadEvents(&m);
+            if (rc != 0)
+            {
+                log_err("Could not read events: %s", strerror(rc));
+                break;
+            }
+        }
+
+        if (fds[1].revents & POLLIN)
+            Complete(&m);
+
+        struct signalfd_siginfo info;
+        while (read(signal_fd, &info, sizeof(info)) == sizeof(info))
+        {
+            if (info.ssi_signo == SIGUSR1)
+                Dump(&m);
+            else if (info.ssi_signo == SIGUSR2)
+                Diff(&m);
+            else
+                stop = true;
+        }
+    }
+
+out:
+    pthread_mutex_lock(&g_queue.lock);
+    g_queue.quit = true;
+    pthread_cond_broadcast(&g_queue.ready);
+    pthread_mutex_unlock(&g_queue.lock);
+
+    for (int i = 0; i < count; i++)
+        pthread_join(workers[i], NULL);
+
+    while (g_queue.head)
+    {
+        struct WatchJob *next = g_queue.head->next;
+        free(g_queue.head);
+        g_queue.head = next;
+    }
+    while (g_queue.done)
+    {
+        struct WatchJob *next = g_queue.done->next;
+        free(g_queue.done);
+        g_queue.done = next;
+    }
+
+    if (signal_fd >= 0)
+        close(signal_fd);
+    if (g_queue.eventfd >= 0)
+        close(g_queue.eventfd);
+
+    FreeMonitor(&m);
+    return rc;
+}